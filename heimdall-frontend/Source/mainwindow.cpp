@@ -122,8 +122,8 @@ bool MainWindow::ReadPit(QFile *file)
 	file->read(reinterpret_cast<char *>(buffer), file->size());
 	file->close();
 
-	bool success = currentPitData.Unpack(buffer);
-	delete buffer;
+	bool success = currentPitData.Unpack(buffer, file->size()) == PitData::kUnpackSucceeded;
+	delete [] buffer;
 
 	if (!success)
 		currentPitData.Clear();
@@ -1054,15 +1054,15 @@ void MainWindow::HandleHeimdallStdout(void)
 	if (output.lastIndexOf(uploadingExp) > -1)
 		flashLabel->setText(uploadingExp.cap().left(uploadingExp.cap().length() - 1));
 
-	QRegExp percentExp("[\b\n][0-9]+%");
+	// Progress lines start with a carriage return (or are whole lines when verbose) and lead with the partition's
+	// percentage, padded to three characters. Transfers without a progress report backspace over the last percentage.
+	QRegExp percentExp("[\b\r\n] *([0-9]+)%");
 	if (output.lastIndexOf(percentExp) > -1)
-	{
-		QString percentString = percentExp.cap();
-		flashProgressBar->setValue(percentString.mid(1, percentString.length() - 2).toInt());
-	}
+		flashProgressBar->setValue(percentExp.cap(1).toInt());
 
-	output.remove(QChar('\b'));
-	output.replace(QChar('%'), QString("%\n"));
+	// Heimdall rewrites the progress line in place, here each update gets a line of its own.
+	output.replace(QChar('\r'), QChar('\n'));
+	output.replace(QRegExp("\b+"), QString("\n"));
 
 	if (heimdallState == MainWindow::kHeimdallStateFlashing)
 	{
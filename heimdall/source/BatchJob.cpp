@@ -0,0 +1,270 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Heimdall
+#include "BatchJob.h"
+#include "Heimdall.h"
+#include "Interface.h"
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	kMaxJobLineLength = 1024
+};
+
+// Splits a line on whitespace, double quotes keep a token together. Returns false if a quote isn't closed.
+static bool tokenise(const char *line, vector<string>& tokens)
+{
+	while (*line != '\0')
+	{
+		while (*line == ' ' || *line == '\t')
+			line++;
+
+		if (*line == '\0')
+			break;
+
+		string token;
+
+		if (*line == '"')
+		{
+			const char *end = strchr(line + 1, '"');
+
+			if (!end)
+				return (false);
+
+			token.assign(line + 1, end - line - 1);
+			line = end + 1;
+		}
+		else
+		{
+			const char *end = line + strcspn(line, " \t");
+
+			token.assign(line, end - line);
+			line = end;
+		}
+
+		tokens.push_back(token);
+	}
+
+	return (true);
+}
+
+static bool isAbsolutePath(const string& filename)
+{
+#ifdef OS_WINDOWS
+	if (filename.length() >= 2 && filename[1] == ':')
+		return (true);
+
+	if (filename[0] == '\\')
+		return (true);
+#endif
+
+	return (filename[0] == '/');
+}
+
+// Parses a non-negative number, returns -1 if text isn't one.
+static int parseNumber(const char *text)
+{
+	char *end;
+	long value = strtol(text, &end, 10);
+
+	return ((end != text && *end == '\0' && value >= 0 && value <= 0xFFFF) ? static_cast<int>(value) : -1);
+}
+
+bool BatchJob::ParseLine(const vector<string>& tokens, const string& directory, const char *path, int lineNumber)
+{
+	const string& keyword = tokens[0];
+
+	if (keyword == "device" && tokens.size() == 2)
+	{
+		string::size_type separator = tokens[1].find(':');
+		BatchDevice device;
+
+		device.busNumber = (separator != string::npos) ? parseNumber(tokens[1].substr(0, separator).c_str()) : -1;
+		device.portNumber = (separator != string::npos) ? parseNumber(tokens[1].substr(separator + 1).c_str()) : -1;
+
+		if (device.busNumber < 0 || device.portNumber < 0)
+		{
+			Interface::PrintError("Expected <bus>:<port> on line %d of job \"%s\"\n", lineNumber, path);
+			return (false);
+		}
+
+		for (unsigned int i = 0; i < devices.size(); i++)
+		{
+			if (devices[i].busNumber == device.busNumber && devices[i].portNumber == device.portNumber)
+			{
+				Interface::PrintError("Device %s is listed twice in job \"%s\"\n", tokens[1].c_str(), path);
+				return (false);
+			}
+		}
+
+		devices.push_back(device);
+		return (true);
+	}
+
+	if ((keyword == "pit" && tokens.size() == 2) || (keyword == "image" && (tokens.size() == 3 || tokens.size() == 4)))
+	{
+		string key;
+		const string& filename = (keyword == "pit") ? tokens[1] : tokens[2];
+
+		if (keyword == "pit")
+			key = Interface::GetPitArgument();
+		else if (parseNumber(tokens[1].c_str()) >= 0)
+			key = "-" + tokens[1];
+		else
+			key = tokens[1];
+
+		if (key[0] == '-' && key != Interface::GetPitArgument() && parseNumber(key.c_str() + 1) < 0)
+		{
+			Interface::PrintError("Invalid partition \"%s\" on line %d of job \"%s\"\n", tokens[1].c_str(), lineNumber, path);
+			return (false);
+		}
+
+		if (imageMap.find(key) != imageMap.end())
+		{
+			Interface::PrintError("%s is flashed twice in job \"%s\"\n", (keyword == "pit") ? "The PIT" : tokens[1].c_str(), path);
+			return (false);
+		}
+
+		// Images are always read from files, they're opened and checked before any device is touched.
+		if (filename == "-")
+		{
+			Interface::PrintError("Images can't be read from stdin on line %d of job \"%s\"\n", lineNumber, path);
+			return (false);
+		}
+
+		imageMap[key] = (isAbsolutePath(filename)) ? filename : directory + filename;
+
+		if (tokens.size() == 4 && !manifest.Add(tokens[3], imageMap[key]))
+		{
+			Interface::PrintError("Unrecognised digest on line %d of job \"%s\"\n", lineNumber, path);
+			return (false);
+		}
+
+		return (true);
+	}
+
+	if (keyword == "option" && tokens.size() == 2)
+	{
+		string argument = "-" + tokens[1];
+		const Action& flashAction = Interface::actions[Interface::kActionFlash];
+
+		bool known = argument == Interface::commonValuelessArguments[Interface::kCommonValuelessArgNoReboot];
+
+		for (unsigned int i = 0; i < flashAction.valuelessArgumentCount && !known; i++)
+			known = argument == flashAction.valuelessArguments[i];
+
+		if (!known)
+		{
+			Interface::PrintError("Unknown option \"%s\" on line %d of job \"%s\"\n", tokens[1].c_str(), lineNumber, path);
+			return (false);
+		}
+
+		optionMap[argument] = "";
+		return (true);
+	}
+
+	Interface::PrintError("Unrecognised line %d of job \"%s\"\n", lineNumber, path);
+	return (false);
+}
+
+bool BatchJob::Load(const char *path)
+{
+	FILE *file = fopen(path, "r");
+
+	if (!file)
+	{
+		Interface::PrintError("Failed to open job \"%s\"\n", path);
+		return (false);
+	}
+
+	string directory = path;
+	string::size_type separator = directory.find_last_of("/\\");
+	directory = (separator == string::npos) ? "" : directory.substr(0, separator + 1);
+
+	char line[kMaxJobLineLength];
+	int lineNumber = 0;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+
+		// Strip the line ending and skip blank lines and comments.
+		unsigned int length = strlen(line);
+
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+
+		vector<string> tokens;
+
+		if (!tokenise(line, tokens))
+		{
+			Interface::PrintError("Unterminated quote on line %d of job \"%s\"\n", lineNumber, path);
+			fclose(file);
+			return (false);
+		}
+
+		if (tokens.empty() || tokens[0][0] == '#')
+			continue;
+
+		if (!ParseLine(tokens, directory, path, lineNumber))
+		{
+			fclose(file);
+			return (false);
+		}
+	}
+
+	fclose(file);
+
+	if (imageMap.empty() || (imageMap.size() == 1 && imageMap.begin()->first == Interface::GetPitArgument()
+		&& !HasOption(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgRepartition])))
+	{
+		Interface::PrintError("Job \"%s\" doesn't flash any images\n", path);
+		return (false);
+	}
+
+	if (HasOption(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgRepartition])
+		&& imageMap.find(Interface::GetPitArgument()) == imageMap.end())
+	{
+		Interface::PrintError("Job \"%s\" repartitions but doesn't specify a PIT\n", path);
+		return (false);
+	}
+
+	// Without devices, whichever device is found first is flashed as usual.
+	if (devices.empty())
+	{
+		BatchDevice device;
+		device.busNumber = -1;
+		device.portNumber = -1;
+
+		devices.push_back(device);
+	}
+
+	return (true);
+}
@@ -0,0 +1,96 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef BATCHJOB_H
+#define BATCHJOB_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "ImageManifest.h"
+
+namespace Heimdall
+{
+	struct BatchDevice
+	{
+		// -1 when the job doesn't list devices, the first supported device found is flashed.
+		int busNumber;
+		int portNumber;
+	};
+
+	// The same images flashed to one or more devices, read from a job file. Each line is one of:
+	//
+	//   device <bus>:<port>                        a device to flash, by where it's plugged in
+	//   pit <filename>                             a local PIT, needed to repartition
+	//   image <partition> <filename> [<digest>]    partition is a PIT partition name or identifier, the digest an MD5
+	//                                              or SHA-256 the image must match
+	//   option <name>                              repartition, refresh-pit, skip-size-check, expand-sparse,
+	//                                              skip-unchanged, resume or no-reboot
+	//
+	// Blank lines and lines starting with '#' are ignored. Filenames are relative to the job file and may be quoted.
+	class BatchJob
+	{
+		private:
+
+			std::vector<BatchDevice> devices;
+
+			// Keyed like flash arguments, "-pit" and "-<identifier>", except partition names which have no leading '-'.
+			std::map<std::string, std::string> imageMap;
+
+			// Flash and common valueless arguments, e.g. "-repartition".
+			std::map<std::string, std::string> optionMap;
+
+			ImageManifest manifest;
+
+			bool ParseLine(const std::vector<std::string>& tokens, const std::string& directory, const char *path, int lineNumber);
+
+		public:
+
+			bool Load(const char *path);
+
+			const std::vector<BatchDevice>& GetDevices(void) const
+			{
+				return (devices);
+			}
+
+			const std::map<std::string, std::string>& GetImageMap(void) const
+			{
+				return (imageMap);
+			}
+
+			bool HasOption(const std::string& argument) const
+			{
+				return (optionMap.find(argument) != optionMap.end());
+			}
+
+			// Digests listed by image lines, empty (no algorithms) if there weren't any.
+			const ImageManifest& GetManifest(void) const
+			{
+				return (manifest);
+			}
+	};
+}
+
+#endif
@@ -38,6 +38,11 @@ namespace Heimdall
 
 		private:
 
+			typedef libpit::WireField<FileTransferPacket::kDataSize, unsigned int> ChipTypeField;
+			typedef libpit::WireField<ChipTypeField::kEnd, unsigned int> ChipIdField;
+
+			WIRE_STATIC_ASSERT(ChipIdField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int chipType;
 			unsigned int chipId;
 
@@ -63,8 +68,8 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, chipType);
-				PackInteger(FileTransferPacket::kDataSize + 4, chipId);
+				PackField<ChipTypeField>(chipType);
+				PackField<ChipIdField>(chipId);
 			}
 	};
 }
@@ -24,6 +24,8 @@
 // C Standard Library
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // libusb
 #include <libusb.h>
@@ -40,18 +42,24 @@
 #include "EndPhoneFileTransferPacket.h"
 #include "EndPitFileTransferPacket.h"
 #include "EndSessionPacket.h"
+#include "FileSource.h"
 #include "FileTransferPacket.h"
+#include "FlashMetrics.h"
 #include "FlashPartFileTransferPacket.h"
 #include "FlashPartPitFilePacket.h"
+#include "FlashProgress.h"
 #include "InboundPacket.h"
 #include "Interface.h"
+#include "JsonEvent.h"
 #include "OutboundPacket.h"
 #include "PitFilePacket.h"
 #include "PitFileResponse.h"
+#include "Probes.h"
 #include "ReceiveFilePartPacket.h"
 #include "ResponsePacket.h"
 #include "SendFilePartPacket.h"
 #include "SendFilePartResponse.h"
+#include "SimulatedDevice.h"
 
 // Future versions of libusb will use usb_interface instead of interface.
 #define usb_interface interface
@@ -71,9 +79,7 @@ enum
 	kMaxSequenceLength = 800
 };
 
-#if GTP7510
-
-static void LogLibusbResult(int iLibusbErrorValue)
+static const char *GetLibusbErrorName(int iLibusbErrorValue)
 {
 	char const * psz = 0;
 	switch (iLibusbErrorValue)
@@ -94,7 +100,30 @@ static void LogLibusbResult(int iLibusbErrorValue)
 	case LIBUSB_ERROR_OTHER: psz = "LIBUSB_ERROR_OTHER"; break;
 	default: psz = "*unknown libusb error code*"; break;
 	}
-	Interface::Print(psz);
+	return (psz);
+}
+
+// Every failed bulk transfer is an event, including those that are retried. attempt is 0 for the first try.
+static void ReportLibusbError(const char *operation, int result, int attempt)
+{
+	JsonEvent event("usb_error");
+	event.Add("operation", operation);
+	event.Add("code", static_cast<long long>(result));
+	event.Add("name", GetLibusbErrorName(result));
+	event.Add("attempt", static_cast<long long>(attempt));
+	event.Emit();
+
+	FlashMetrics::CountLibusbError(GetLibusbErrorName(result));
+}
+
+#if GTP7510
+
+static void LogLibusbResult(int iLibusbErrorValue)
+{
+	Interface::Print(GetLibusbErrorName(iLibusbErrorValue));
+
+	if (iLibusbErrorValue < 0)
+		FlashMetrics::CountLibusbError(GetLibusbErrorName(iLibusbErrorValue));
 }
 
 static void LogControlTransferResult(int rc)
@@ -118,6 +147,7 @@ static void LogControlTransferResult(int rc)
 bool BridgeManager::ResetInterface()
 {
 	Interface::Print("Clearing halts.\n");
+	HEIMDALL_PROBE1(reset_interface_step, "CLEAR_HALT");
 	{
 		//	In theory, we could clear any halt condition on the default control pipe too.
 		//	But since we're successfully talking to the device now, that's probably unnecessary.
@@ -170,6 +200,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 89
 	Interface::Print("CLEAR_COMM_FEATURE 1 . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "CLEAR_COMM_FEATURE");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_OUT // host-to-device
@@ -192,6 +223,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 91
 	Interface::Print("GET_COMM_FEATURE . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "GET_COMM_FEATURE");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_IN // device-to-host
@@ -214,6 +246,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 93
 	Interface::Print("SET_COMM_FEATURE . . .");
+	HEIMDALL_PROBE1(reset_interface_step, "SET_COMM_FEATURE");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_OUT // host-to-device
@@ -236,6 +269,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 95
 	Interface::Print("SET_CONTROL_LINE_STATE . . .");
+	HEIMDALL_PROBE1(reset_interface_step, "SET_CONTROL_LINE_STATE");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_OUT // host-to-device
@@ -258,6 +292,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 97
 	Interface::Print("GET_LINE_CODING . . .");
+	HEIMDALL_PROBE1(reset_interface_step, "GET_LINE_CODING");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_IN // device-to-host
@@ -296,6 +331,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 100
 	Interface::Print("GET_LINE_CODING . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "GET_LINE_CODING");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_IN // device-to-host
@@ -317,6 +353,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 102
 	Interface::Print("INTERRUPT . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "INTERRUPT");
 	{
 		//	Ensure we're listening for interrupts on comm
 		bWantOutstanding_intr_comm = true;
@@ -325,6 +362,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 103
 	Interface::Print("sync control request 32 . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "CONTROL_REQUEST_32");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_OUT // host-to-device
@@ -347,6 +385,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 105
 	Interface::Print("sync control request 34 0x0003 . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "CONTROL_REQUEST_34_3");
 	{
 		uint8_t bmRequestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE;
 		uint8_t bRequest = 34; // ???
@@ -363,6 +402,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 105
 	Interface::Print("sync control request 34 0x0002 . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "CONTROL_REQUEST_34_2");
 	{
 		uint8_t bmRequestType = LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE;
 		uint8_t bRequest = 34; // ???
@@ -379,6 +419,7 @@ bool BridgeManager::ResetInterface()
 
 	//	odin3_1.85_win7_vm_recoveryflash.pcap frame 109 (almost the same as 103)
 	Interface::Print("sync control request 32 . . . ");
+	HEIMDALL_PROBE1(reset_interface_step, "CONTROL_REQUEST_32");
 	{
 		uint8_t bmRequestType =
 			  LIBUSB_ENDPOINT_OUT // host-to-device
@@ -415,6 +456,7 @@ bool BridgeManager::ResetInterface()
 		::usleep(1000);
 	}
 
+	HEIMDALL_PROBE0(reset_interface_done);
 	return true;
 }
 
@@ -559,6 +601,7 @@ extern "C" void ExtC_OnAsyncTransferComplete_Bulk_In(libusb_transfer * transfer)
 void BridgeManager::OnAsyncTransferComplete_Bulk_In(libusb_transfer * transfer)
 {
 	//Interface::Print("OnAsyncTransferComplete_Bulk_In received %d bytes\n", transfer->actual_length);
+	HEIMDALL_PROBE2(bulk_in_complete, transfer->actual_length, transfer->status);
 
 	//	Append the data.
 	assert(transfer->actual_length <= buffer_bulk_in_z - buffer_bulk_in_e);
@@ -915,10 +958,34 @@ BridgeManager::BridgeManager(bool verbose, int communicationDelay)
 	this->verbose = verbose;
 	this->communicationDelay = communicationDelay;
 
+	const char *pipelineDepth = getenv("HEIMDALL_PIT_PIPELINE_DEPTH");
+	pitPipelineDepth = (pipelineDepth) ? atoi(pipelineDepth) : 1;
+
+	if (pitPipelineDepth < 1)
+		pitPipelineDepth = 1;
+	else if (pitPipelineDepth > kPitTransferPipelineDepth)
+		pitPipelineDepth = kPitTransferPipelineDepth;
+
+	const char *quickCheck = getenv("HEIMDALL_PIT_CACHE_QUICK_CHECK");
+	pitCacheQuickCheck = quickCheck && atoi(quickCheck) != 0;
+
 	libusbContext = nullptr;
 	deviceHandle = nullptr;
 	heimdallDevice = nullptr;
 
+	vendorId = -1;
+	productId = -1;
+	deviceRevision = -1;
+	deviceType = -1;
+
+	selectedBusNumber = -1;
+	selectedPortNumber = -1;
+
+	simulatedDevice = nullptr;
+
+	fileTransferPartSize = SendFilePartPacket::kDefaultPacketSize;
+	fileTransferSequenceLength = kMaxSequenceLength;
+
 #if GTP7510
 
 	bInterfaceNumber_comm = -1;
@@ -1000,6 +1067,32 @@ BridgeManager::~BridgeManager()
 		libusb_exit(libusbContext);
 }
 
+void BridgeManager::RecordDeviceIdentity(const libusb_device_descriptor *deviceDescriptor)
+{
+	vendorId = deviceDescriptor->idVendor;
+	productId = deviceDescriptor->idProduct;
+	deviceRevision = deviceDescriptor->bcdDevice;
+
+	serialNumber.clear();
+
+	if (deviceDescriptor->iSerialNumber != 0)
+	{
+		unsigned char stringBuffer[128];
+
+		int length = libusb_get_string_descriptor_ascii(deviceHandle, deviceDescriptor->iSerialNumber, stringBuffer, 128);
+		if (length > 0)
+			serialNumber.assign(reinterpret_cast<const char *>(stringBuffer), length);
+	}
+}
+
+bool BridgeManager::IsAtSelectedLocation(libusb_device *device) const
+{
+	if (selectedBusNumber >= 0 && libusb_get_bus_number(device) != selectedBusNumber)
+		return (false);
+
+	return (selectedPortNumber < 0 || libusb_get_port_number(device) == selectedPortNumber);
+}
+
 bool BridgeManager::DetectDevice(void)
 {
 	// Initialise libusb-1.0
@@ -1010,35 +1103,60 @@ bool BridgeManager::DetectDevice(void)
 		return (false);
 	}
 
-	// Get handle to Galaxy S device
 	struct libusb_device **devices;
 	int deviceCount = libusb_get_device_list(libusbContext, &devices);
+	bool detected = false;
 
 	for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
 	{
+		if (!IsAtSelectedLocation(devices[deviceIndex]))
+			continue;
+
 		libusb_device_descriptor descriptor;
 		libusb_get_device_descriptor(devices[deviceIndex], &descriptor);
 
-		for (int i = 0; i < BridgeManager::kSupportedDeviceCount; i++)
-		{
-			if (descriptor.idVendor == supportedDevices[i].vendorId && descriptor.idProduct == supportedDevices[i].productId)
-			{
-				libusb_free_device_list(devices, deviceCount);
+		bool supported = false;
 
-				Interface::Print("Device detected\n");
-				return (true);
-			}
-		}
+		for (int i = 0; i < BridgeManager::kSupportedDeviceCount && !supported; i++)
+			supported = descriptor.idVendor == supportedDevices[i].vendorId && descriptor.idProduct == supportedDevices[i].productId;
+
+		if (!supported)
+			continue;
+
+		detected = true;
+
+		// Verbose output lists every device, batch jobs select them by where they're plugged in.
+		if (!verbose)
+			break;
+
+		Interface::Print("Device detected on bus %d, port %d\n", libusb_get_bus_number(devices[deviceIndex]),
+			libusb_get_port_number(devices[deviceIndex]));
 	}
 
 	libusb_free_device_list(devices, deviceCount);
 
-	Interface::PrintDeviceDetectionFailed();
-	return (false);
+	if (!detected)
+	{
+		Interface::PrintDeviceDetectionFailed();
+		return (false);
+	}
+
+	if (!verbose)
+		Interface::Print("Device detected\n");
+
+	return (true);
 }
 
 int BridgeManager::Initialise(void)
 {
+	Interface::PrintPhaseEvent("initialise");
+
+	if (simulatedDevice)
+	{
+		Interface::Print("Using a simulated device, nothing is sent over USB.\n\n");
+		return (BridgeManager::kInitialiseSucceeded);
+	}
+
 #if GTP7510
 
 	int result = 0;
@@ -1067,6 +1185,9 @@ int BridgeManager::Initialise(void)
 
 		for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
 		{
+			if (!IsAtSelectedLocation(devices[deviceIndex]))
+				continue;
+
 			libusb_device_descriptor descriptor;
 			libusb_get_device_descriptor(devices[deviceIndex], &descriptor);
 
@@ -1132,6 +1253,8 @@ int BridgeManager::Initialise(void)
 		Interface::Print("OK\n");
 	}
 
+	RecordDeviceIdentity(&deviceDescriptor);
+
 	if (verbose)
 	{
 		uint8_t stringBuffer[128];
@@ -1398,6 +1521,9 @@ int BridgeManager::Initialise(void)
 
 	for (int deviceIndex = 0; deviceIndex < deviceCount; deviceIndex++)
 	{
+		if (!IsAtSelectedLocation(devices[deviceIndex]))
+			continue;
+
 		libusb_device_descriptor descriptor;
 		libusb_get_device_descriptor(devices[deviceIndex], &descriptor);
 
@@ -1438,6 +1564,8 @@ int BridgeManager::Initialise(void)
 		return (BridgeManager::kInitialiseFailed);
 	}
 
+	RecordDeviceIdentity(&deviceDescriptor);
+
 	if (verbose)
 	{
 		uint8_t stringBuffer[128];
@@ -1584,6 +1712,7 @@ int BridgeManager::Initialise(void)
 bool BridgeManager::BeginSession(void)
 {
 	Interface::Print("Beginning session...\n");
+	Interface::PrintPhaseEvent("begin_session");
 
 	SetupSessionPacket beginSessionPacket(SetupSessionPacket::kBeginSession);
 
@@ -1619,7 +1748,7 @@ bool BridgeManager::BeginSession(void)
 	if (!ReceivePacket(&setupSessionResponse))
 		return (false);
 
-	int deviceType = setupSessionResponse.GetUnknown();
+	deviceType = setupSessionResponse.GetUnknown();
 
 	/* TODO: Work out what this value is...
 	 * it has been either 180 or 0 for Galaxy S phones,
@@ -1643,6 +1772,7 @@ bool BridgeManager::BeginSession(void)
 bool BridgeManager::EndSession(bool reboot)
 {
 	Interface::Print("Ending session...\n");
+	Interface::PrintPhaseEvent("end_session");
 
 	EndSessionPacket *endSessionPacket = new EndSessionPacket(EndSessionPacket::kRequestEndSession);
 	bool success = SendPacket(endSessionPacket);
@@ -1669,6 +1799,7 @@ bool BridgeManager::EndSession(bool reboot)
 	if (reboot)
 	{
 		Interface::Print("Rebooting device...\n");
+		Interface::PrintPhaseEvent("reboot");
 
 		EndSessionPacket *rebootDevicePacket = new EndSessionPacket(EndSessionPacket::kRequestRebootDevice);
 		bool success = SendPacket(rebootDevicePacket);
@@ -1700,20 +1831,32 @@ bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, bool retry)
 {
 	packet->Pack();
 
+	// libusb doesn't write to the buffer of an outbound transfer.
+	unsigned char *transferData = const_cast<unsigned char *>(packet->GetTransferData(sendStaging));
+	int transferSize = packet->GetTransferSize();
+
+	if (simulatedDevice)
+		return (simulatedDevice->HandleTransfer(transferData, transferSize));
+
+	HEIMDALL_PROBE1(send_packet_begin, transferSize);
+
 #if GTP7510
 	//if (verbose)
-	//	Interface::Print("Sending packet of %d bytes.\n", packet->GetSize());
+	//	Interface::Print("Sending packet of %d bytes.\n", transferSize);
 
 	int dataTransferred;
-	int result = libusb_bulk_transfer(deviceHandle, bEndpointAddress_data_out, packet->GetData(), packet->GetSize(),
+	int result = libusb_bulk_transfer(deviceHandle, bEndpointAddress_data_out, transferData, transferSize,
 		&dataTransferred, timeout);
 #else // of if GTP7510
 
 	int dataTransferred;
-	int result = libusb_bulk_transfer(deviceHandle, outEndpoint, packet->GetData(), packet->GetSize(),
+	int result = libusb_bulk_transfer(deviceHandle, outEndpoint, transferData, transferSize,
 		&dataTransferred, timeout);
 #endif // of else of if GTP7510
 
+	if (result < 0)
+		ReportLibusbError("send", result, 0);
+
 	if (result < 0 && retry)
 	{
 		// max(250, communicationDelay)
@@ -1728,20 +1871,24 @@ bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, bool retry)
 			if (verbose)
 				Interface::PrintErrorSameLine(" Retrying...\n");
 
+			FlashMetrics::CountRetry("send");
+
 			// Wait longer each retry
 			Sleep(retryDelay * (i + 1));
 
 #if GTP7510
-			result = libusb_bulk_transfer(deviceHandle, bEndpointAddress_data_out, packet->GetData(), packet->GetSize(),
+			result = libusb_bulk_transfer(deviceHandle, bEndpointAddress_data_out, transferData, transferSize,
 				&dataTransferred, timeout);
 #else // of if GTP7510
-			result = libusb_bulk_transfer(deviceHandle, outEndpoint, packet->GetData(), packet->GetSize(),
+			result = libusb_bulk_transfer(deviceHandle, outEndpoint, transferData, transferSize,
 				&dataTransferred, timeout);
 #endif // of else of if GTP7510
 
 			if (result >= 0)
 				break;
 
+			ReportLibusbError("send", result, i + 1);
+
 			if (verbose)
 				Interface::PrintError("libusb error %d whilst sending packet.", result);
 		}
@@ -1753,7 +1900,9 @@ bool BridgeManager::SendPacket(OutboundPacket *packet, int timeout, bool retry)
 	if (communicationDelay != 0)
 		Sleep(communicationDelay);
 
-	if (result < 0 || dataTransferred != packet->GetSize())
+	HEIMDALL_PROBE3(send_packet_end, transferSize, dataTransferred, result);
+
+	if (result < 0 || dataTransferred != transferSize)
 		return (false);
 
 	return (true);
@@ -1824,6 +1973,19 @@ void BridgeManager::ClearReceivedData()
 
 bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry)
 {
+	if (simulatedDevice)
+	{
+		int receivedSize = simulatedDevice->ReadResponse(packet->GetData(), packet->GetSize());
+
+		if (receivedSize != packet->GetSize() && (!packet->IsSizeVariable() || receivedSize == 0))
+			return (false);
+
+		packet->SetReceivedSize(receivedSize);
+		return (packet->Unpack());
+	}
+
+	HEIMDALL_PROBE1(receive_packet_begin, packet->GetSize());
+
 #if GTP7510
 	//if (verbose)
 	//	Interface::Print("Hoping to receive a packet of %d bytes.\n", packet->GetSize());
@@ -1837,6 +1999,8 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry
 
 	dataTransferred = ReceiveData(packet->GetData(), minLength, maxLength, timeout);
 
+	HEIMDALL_PROBE3(receive_packet_end, maxLength, dataTransferred, 0);
+
 	if (dataTransferred != packet->GetSize() && !packet->IsSizeVariable())
 		return (false);
 
@@ -1849,6 +2013,9 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry
 	int result = libusb_bulk_transfer(deviceHandle, inEndpoint, packet->GetData(), packet->GetSize(),
 		&dataTransferred, timeout);
 
+	if (result < 0)
+		ReportLibusbError("receive", result, 0);
+
 	if (result < 0 && retry)
 	{
 		// max(250, communicationDelay)
@@ -1863,6 +2030,8 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry
 			if (verbose)
 				Interface::PrintErrorSameLine(" Retrying...\n");
 
+			FlashMetrics::CountRetry("receive");
+
 			// Wait longer each retry
 			Sleep(retryDelay * (i + 1));
 
@@ -1872,6 +2041,8 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry
 			if (result >= 0)
 				break;
 
+			ReportLibusbError("receive", result, i + 1);
+
 			if (verbose)
 				Interface::PrintError("libusb error %d whilst receiving packet.", result);
 		}
@@ -1883,6 +2054,8 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry
 	if (communicationDelay != 0)
 		Sleep(communicationDelay);
 
+	HEIMDALL_PROBE3(receive_packet_end, packet->GetSize(), dataTransferred, result);
+
 	if (result < 0 || (dataTransferred != packet->GetSize() && !packet->IsSizeVariable()))
 		return (false);
 
@@ -1893,6 +2066,94 @@ bool BridgeManager::ReceivePacket(InboundPacket *packet, int timeout, bool retry
 	return (packet->Unpack());
 }
 
+bool BridgeManager::ReceiveFilePart(unsigned char *destination, int size, int timeout, bool retry)
+{
+	if (simulatedDevice)
+		return (simulatedDevice->ReadResponse(destination, size) == size);
+
+#if GTP7510
+
+	// Receives aren't retried here, the bulk in endpoint always has a transfer outstanding and a part that's late is left
+	// for the caller to drain.
+	(void)retry;
+
+	int dataTransferred = ReceiveData(destination, size, size, timeout);
+
+	if (communicationDelay != 0)
+		Sleep(communicationDelay);
+
+	return (dataTransferred == size);
+
+#else // of if GTP7510
+
+	int dataTransferred;
+	int result = libusb_bulk_transfer(deviceHandle, inEndpoint, destination, size, &dataTransferred, timeout);
+
+	if (result < 0)
+		ReportLibusbError("receive", result, 0);
+
+	if (result < 0 && retry)
+	{
+		// max(250, communicationDelay)
+		int retryDelay = (communicationDelay > 250) ? communicationDelay : 250;
+
+		for (int i = 0; i < 5; i++)
+		{
+			FlashMetrics::CountRetry("receive");
+
+			// Wait longer each retry
+			Sleep(retryDelay * (i + 1));
+
+			result = libusb_bulk_transfer(deviceHandle, inEndpoint, destination, size, &dataTransferred, timeout);
+
+			if (result >= 0)
+				break;
+
+			ReportLibusbError("receive", result, i + 1);
+		}
+	}
+
+	if (communicationDelay != 0)
+		Sleep(communicationDelay);
+
+	return (result >= 0 && dataTransferred == size);
+
+#endif // of else of if GTP7510
+}
+
+// Reads and discards replies to part requests still outstanding after a failure, so they aren't taken as the response
+// to whatever is sent next. Stops at the first reply that doesn't arrive.
+void BridgeManager::DrainFileParts(int count)
+{
+	unsigned char part[ReceiveFilePartPacket::kDataSize];
+
+	for (int i = 0; i < count; i++)
+	{
+		if (simulatedDevice)
+		{
+			if (simulatedDevice->ReadResponse(part, sizeof(part)) == 0)
+				break;
+		}
+		else
+		{
+#if GTP7510
+			if (ReceiveData(part, 1, sizeof(part), 1000) <= 0)
+				break;
+#else // of if GTP7510
+			int dataTransferred;
+
+			if (libusb_bulk_transfer(deviceHandle, inEndpoint, part, sizeof(part), &dataTransferred, 1000) < 0)
+				break;
+#endif // of else of if GTP7510
+		}
+	}
+
+#if GTP7510
+	if (!simulatedDevice)
+		ClearReceivedData();
+#endif // of if GTP7510
+}
+
 bool BridgeManager::RequestDeviceInfo(unsigned int request, int *result)
 {
 	SetupSessionPacket beginSessionPacket(request);
@@ -1919,9 +2180,13 @@ bool BridgeManager::RequestDeviceInfo(unsigned int request, int *result)
 
 bool BridgeManager::SendPitFile(FILE *file)
 {
-	fseek(file, 0, SEEK_END);
-	long fileSize = ftell(file);
-	rewind(file);
+	long long fileSize = FileSource::GetFileSize(file);
+
+	if (fileSize <= 0)
+	{
+		Interface::PrintError("Failed to read PIT file!\n");
+		return (false);
+	}
 
 	// Start file transfer
 	PitFilePacket *pitFilePacket = new PitFilePacket(PitFilePacket::kRequestFlash);
@@ -1945,7 +2210,7 @@ bool BridgeManager::SendPitFile(FILE *file)
 	}
 
 	// Transfer file size
-	FlashPartPitFilePacket *flashPartPitFilePacket = new FlashPartPitFilePacket(fileSize);
+	FlashPartPitFilePacket *flashPartPitFilePacket = new FlashPartPitFilePacket(static_cast<unsigned int>(fileSize));
 	success = SendPacket(flashPartPitFilePacket);
 	delete flashPartPitFilePacket;
 
@@ -1966,9 +2231,19 @@ bool BridgeManager::SendPitFile(FILE *file)
 	}
 
 	// Flash pit file
-	SendFilePartPacket *sendFilePartPacket = new SendFilePartPacket(file, fileSize);
-	success = SendPacket(sendFilePartPacket);
-	delete sendFilePartPacket;
+	unsigned char *pitBuffer = new unsigned char[fileSize];
+	unsigned int pitBytesRead = FileSource::ReadAt(file, 0, pitBuffer, static_cast<unsigned int>(fileSize));
+
+	if (pitBytesRead != static_cast<unsigned int>(fileSize))
+	{
+		Interface::PrintError("Failed to read PIT file!\n");
+		delete [] pitBuffer;
+		return (false);
+	}
+
+	SendFilePartPacket sendFilePartPacket(pitBuffer, pitBytesRead, static_cast<unsigned int>(fileSize));
+	success = SendPacket(&sendFilePartPacket);
+	delete [] pitBuffer;
 
 	if (!success)
 	{
@@ -2010,10 +2285,13 @@ bool BridgeManager::SendPitFile(FILE *file)
 	return (true);
 }
 
-int BridgeManager::ReceivePitFile(unsigned char **pitBuffer)
+int BridgeManager::ReceivePitFile(unsigned char **pitBuffer, const unsigned char *cachedPit, int cachedPitSize, bool *cacheMatched)
 {
 	*pitBuffer = nullptr;
 
+	if (cacheMatched)
+		*cacheMatched = false;
+
 	bool success;
 
 	// Start file transfer
@@ -2032,7 +2310,7 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer)
 	int fileSize = pitFileResponse->GetFileSize();
 	delete pitFileResponse;
 
-	if (!success)
+	if (!success || fileSize <= 0)
 	{
 		Interface::PrintError("Failed to receive PIT file size!\n");
 		return (0);
@@ -2043,40 +2321,72 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer)
 		transferCount++;
 
 	unsigned char *buffer = new unsigned char[fileSize];
-	int offset = 0;
 
 	// NOTE: The PIT file appears to always be padded out to exactly 4 kilobytes.
+
+#if GTP7510
+	// The bulk in endpoint always has a transfer outstanding, so part requests can be pipelined when asked for. Each part
+	// is received straight into its slot in the buffer, so the round trip is paid once per batch rather than per part.
+	int pipelineDepth = pitPipelineDepth;
+#else // of if GTP7510
+	// Without an outstanding transfer on the in endpoint the device can't respond whilst we're still sending.
+	int pipelineDepth = 1;
+#endif // of else of if GTP7510
+
+	// PITs are padded to a fixed size, so the size alone says little. By default the whole PIT is downloaded and compared
+	// with the cached copy. The quick check only compares the first part (the header and the first few entries) and
+	// skips the rest of the transfer if it matches, so later entries in the cached copy may be stale.
+	bool compareCache = pitCacheQuickCheck && cachedPit != nullptr && cachedPitSize == fileSize;
+	bool useCache = false;
+
+	DumpPartPitFilePacket requestPacket(0);
+	int requestedCount = 0;
+
 	for (int i = 0; i < transferCount; i++)
 	{
-		DumpPartPitFilePacket *requestPacket = new DumpPartPitFilePacket(i);
-		success = SendPacket(requestPacket);
-		delete requestPacket;
-
-		if (!success)
+		while (requestedCount < transferCount && requestedCount - i < ((compareCache) ? 1 : pipelineDepth))
 		{
-			Interface::PrintError("Failed to request PIT file part #%d!\n", i);
-			delete [] buffer;
-			return (0);
+			requestPacket.SetPartIndex(requestedCount);
+
+			if (!SendPacket(&requestPacket))
+			{
+				Interface::PrintError("Failed to request PIT file part #%d!\n", requestedCount);
+				DrainFileParts(requestedCount - i);
+				delete [] buffer;
+				return (0);
+			}
+
+			requestedCount++;
 		}
 
-		ReceiveFilePartPacket *receiveFilePartPacket = new ReceiveFilePartPacket();
-		success = ReceivePacket(receiveFilePartPacket);
+		int offset = i * ReceiveFilePartPacket::kDataSize;
+		int partSize = (fileSize - offset < ReceiveFilePartPacket::kDataSize) ? fileSize - offset : ReceiveFilePartPacket::kDataSize;
 
-		if (!success)
+		if (!ReceiveFilePart(buffer + offset, partSize))
 		{
 			Interface::PrintError("Failed to receive PIT file part #%d!\n", i);
-			delete receiveFilePartPacket;
+
+			// The part may still turn up late, along with those requested after it.
+			DrainFileParts(requestedCount - i);
 			delete [] buffer;
 			return (0);
 		}
 
-		// Copy the whole packet data into the buffer.
-		memcpy(buffer + offset, receiveFilePartPacket->GetData(), receiveFilePartPacket->GetReceivedSize());
-		offset += receiveFilePartPacket->GetReceivedSize();
+		if (compareCache)
+		{
+			useCache = memcmp(buffer, cachedPit, partSize) == 0;
+			compareCache = false;
 
-		delete receiveFilePartPacket;
+			if (useCache)
+				break;
+		}
 	}
 
+	if (useCache)
+		memcpy(buffer, cachedPit, fileSize);
+	else if (!pitCacheQuickCheck && cachedPit != nullptr && cachedPitSize == fileSize)
+		useCache = memcmp(buffer, cachedPit, fileSize) == 0;
+
 	// End file transfer
 	pitFilePacket = new PitFilePacket(PitFilePacket::kRequestEndTransfer);
 	success = SendPacket(pitFilePacket);
@@ -2100,11 +2410,83 @@ int BridgeManager::ReceivePitFile(unsigned char **pitBuffer)
 		return (0);
 	}
 
+	if (cacheMatched)
+		*cacheMatched = useCache;
+
 	*pitBuffer = buffer;
 	return (fileSize);
 }
 
-bool BridgeManager::SendFile(FILE *file, int destination, int fileIdentifier)
+bool BridgeManager::SendFilePart(SendFilePartPacket *sendFilePartPacket, int filePartIndex, FilePartStatistics *statistics)
+{
+	// The packet borrows the part's buffer, which isn't refilled until the part is acknowledged, so a retransmission always
+	// resends exactly this part.
+	for (int attempt = 0; attempt <= kMaxFilePartRetransmissions; attempt++)
+	{
+		if (attempt > 0)
+		{
+			if (attempt == 1)
+				statistics->retransmittedParts++;
+
+			statistics->retransmissions++;
+			FlashMetrics::CountRetry("file_part");
+
+			if (verbose)
+				Interface::PrintDebug("Retransmitting file part #%d (%d of %d)\n", filePartIndex, attempt, kMaxFilePartRetransmissions);
+		}
+
+		if (!SendPacket(sendFilePartPacket))
+		{
+			statistics->sendFailures++;
+			continue;
+		}
+
+		SendFilePartResponse sendFilePartResponse;
+
+		if (!ReceivePacket(&sendFilePartResponse))
+		{
+			statistics->receiveFailures++;
+			continue;
+		}
+
+		int receivedPartIndex = sendFilePartResponse.GetPartIndex();
+
+		if (verbose)
+		{
+			const unsigned char *data = sendFilePartResponse.GetData();
+			Interface::PrintDebug("File Part #%d... Response: %X  %X  %X  %X  %X  %X  %X  %X \n", filePartIndex,
+				data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
+		}
+
+		// The device has acknowledged some other part, resending this one won't bring it back in step.
+		if (receivedPartIndex != filePartIndex)
+		{
+			Interface::PrintErrorSameLine("\n");
+			Interface::PrintError("Expected file part index: %d Received: %d\n", filePartIndex, receivedPartIndex);
+			return (false);
+		}
+
+		return (true);
+	}
+
+	Interface::PrintErrorSameLine("\n");
+	Interface::PrintError("File part #%d wasn't acknowledged after %d retransmissions!\n", filePartIndex,
+		kMaxFilePartRetransmissions);
+
+	return (false);
+}
+
+void BridgeManager::PrintFilePartStatistics(const FilePartStatistics& statistics) const
+{
+	if (!verbose)
+		return;
+
+	Interface::Print("File parts retransmitted: %u (%u retransmissions), send failures: %u, receive failures: %u\n",
+		statistics.retransmittedParts, statistics.retransmissions, statistics.sendFailures, statistics.receiveFailures);
+}
+
+bool BridgeManager::SendFile(FileSource *source, int destination, int fileIdentifier, TransferObserver *observer,
+	FlashProgress *progress)
 {
 	if (destination != EndFileTransferPacket::kDestinationModem && destination != EndFileTransferPacket::kDestinationPhone)
 	{
@@ -2128,9 +2510,7 @@ bool BridgeManager::SendFile(FILE *file, int destination, int fileIdentifier)
 		return (false);
 	}
 
-	fseek(file, 0, SEEK_END);
-	long fileSize = ftell(file);
-	rewind(file);
+	long long fileSize = source->GetSize();
 
 	ResponsePacket *fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
 	success = ReceivePacket(fileTransferResponse);
@@ -2142,146 +2522,102 @@ bool BridgeManager::SendFile(FILE *file, int destination, int fileIdentifier)
 		return (false);
 	}
 
-	int sequenceCount = fileSize / (kMaxSequenceLength * SendFilePartPacket::kDefaultPacketSize);
-	int lastSequenceSize = kMaxSequenceLength;
-	int partialPacketLength = fileSize % SendFilePartPacket::kDefaultPacketSize;
-	if  (fileSize % (kMaxSequenceLength * SendFilePartPacket::kDefaultPacketSize) != 0)
+	int filePartSize = fileTransferPartSize;
+	int maxSequenceLength = fileTransferSequenceLength;
+	long long maxSequenceBytes = static_cast<long long>(maxSequenceLength) * filePartSize;
+
+	int sequenceCount = static_cast<int>(fileSize / maxSequenceBytes);
+	int lastSequenceSize = maxSequenceLength;
+	int partialPacketLength = static_cast<int>(fileSize % filePartSize);
+	if  (fileSize % maxSequenceBytes != 0)
 	{
 		sequenceCount++;
 
-		int lastSequenceBytes = fileSize % (kMaxSequenceLength * SendFilePartPacket::kDefaultPacketSize);
-		lastSequenceSize = lastSequenceBytes / SendFilePartPacket::kDefaultPacketSize;
+		int lastSequenceBytes = static_cast<int>(fileSize % maxSequenceBytes);
+		lastSequenceSize = lastSequenceBytes / filePartSize;
 		if (partialPacketLength != 0)
 			lastSequenceSize++;
 	}
 
-	long bytesTransferred = 0;
+	// Each part is read into partBuffer and sent from there, the packet only borrows it.
+	unsigned char *partBuffer = new unsigned char[filePartSize];
+
+	FilePartStatistics statistics;
+	memset(&statistics, 0, sizeof(statistics));
+
+	long long bytesTransferred = 0;
 	int currentPercent;
 	int previousPercent = 0;
-	Interface::Print("0%%");
+
+	if (!progress)
+		Interface::Print("0%%");
 
 	for (int sequenceIndex = 0; sequenceIndex < sequenceCount; sequenceIndex++)
 	{
 		// Min(lastSequenceSize, 131072)
 		bool isLastSequence = sequenceIndex == sequenceCount - 1;
-		int sequenceSize = (isLastSequence) ? lastSequenceSize : kMaxSequenceLength;
+		int sequenceSize = (isLastSequence) ? lastSequenceSize : maxSequenceLength;
 
-		FlashPartFileTransferPacket *beginFileTransferPacket = new FlashPartFileTransferPacket(0, 2 * sequenceSize);
-		success = SendPacket(beginFileTransferPacket);
-		delete beginFileTransferPacket;
+		HEIMDALL_PROBE3(file_sequence_begin, fileIdentifier, sequenceIndex, sequenceSize);
+
+		// Control packets and responses in this loop are stack allocated, only file parts touch the heap.
+		FlashPartFileTransferPacket beginFileTransferPacket(0, 2 * sequenceSize);
+		success = SendPacket(&beginFileTransferPacket);
 
 		if (!success)
 		{
 			Interface::PrintErrorSameLine("\n");
 			Interface::PrintError("Failed to begin file transfer sequence!\n");
+			delete [] partBuffer;
 			return (false);
 		}
 
-		fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-		bool success = ReceivePacket(fileTransferResponse);
-		delete fileTransferResponse;
+		ResponsePacket beginFileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+		success = ReceivePacket(&beginFileTransferResponse);
 
 		if (!success)
 		{
 			Interface::PrintErrorSameLine("\n");
 			Interface::PrintError("Failed to confirm beginning of file transfer sequence!\n");
+			delete [] partBuffer;
 			return (false);
 		}
 
-		SendFilePartPacket *sendFilePartPacket;
-		SendFilePartResponse *sendFilePartResponse;
-
 		for (int filePartIndex = 0; filePartIndex < sequenceSize; filePartIndex++)
 		{
-			// Send
-			sendFilePartPacket = new SendFilePartPacket(file);
-			success = SendPacket(sendFilePartPacket);
-			delete sendFilePartPacket;
+			unsigned int expectedPartSize = (fileSize - bytesTransferred < filePartSize)
+				? static_cast<unsigned int>(fileSize - bytesTransferred) : filePartSize;
 
-			if (!success)
+			unsigned int partSize = source->Read(partBuffer, expectedPartSize);
+
+			if (partSize != expectedPartSize)
 			{
 				Interface::PrintErrorSameLine("\n");
-				Interface::PrintError("Failed to send file part packet!\n");
+				Interface::PrintError("Failed to read file part!\n");
+				delete [] partBuffer;
 				return (false);
 			}
 
-			// Response
-			sendFilePartResponse = new SendFilePartResponse();
-			success = ReceivePacket(sendFilePartResponse);
-			int receivedPartIndex = sendFilePartResponse->GetPartIndex();
-
-			if (verbose)
-			{
-				const unsigned char *data = sendFilePartResponse->GetData();
-				Interface::Print("File Part #%d... Response: %X  %X  %X  %X  %X  %X  %X  %X \n", filePartIndex,
-					data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
-			}
-
-			delete sendFilePartResponse;
-
-			if (!success)
-			{
-				Interface::PrintErrorSameLine("\n");
-				Interface::PrintError("Failed to receive file part response!\n");
-
-				for (int retry = 0; retry < 4; retry++)
-				{
-					Interface::PrintErrorSameLine("\n");
-					Interface::PrintError("Retrying...");
-
-					// Send
-					sendFilePartPacket = new SendFilePartPacket(file);
-					success = SendPacket(sendFilePartPacket);
-					delete sendFilePartPacket;
-
-					if (!success)
-					{
-						Interface::PrintErrorSameLine("\n");
-						Interface::PrintError("Failed to send file part packet!\n");
-						return (false);
-					}
+			SendFilePartPacket sendFilePartPacket(partBuffer, partSize, filePartSize);
 
-					// Response
-					sendFilePartResponse = new SendFilePartResponse();
-					success = ReceivePacket(sendFilePartResponse);
-					int receivedPartIndex = sendFilePartResponse->GetPartIndex();
-
-					if (verbose)
-					{
-						const unsigned char *data = sendFilePartResponse->GetData();
-						Interface::Print("File Part #%d... Response: %X  %X  %X  %X  %X  %X  %X  %X \n", filePartIndex,
-							data[0], data[1], data[2], data[3], data[4], data[5], data[6], data[7]);
-					}
-
-					delete sendFilePartResponse;
-
-					if (receivedPartIndex != filePartIndex)
-					{
-						Interface::PrintErrorSameLine("\n");
-						Interface::PrintError("Expected file part index: %d Received: %d\n", filePartIndex, receivedPartIndex);
-						return (false);
-					}
-
-					if (success)
-						break;
-				}
-
-				if (!success)
-					return (false);
-			}
-
-			if (receivedPartIndex != filePartIndex)
+			if (!SendFilePart(&sendFilePartPacket, filePartIndex, &statistics))
 			{
-				Interface::PrintErrorSameLine("\n");
-				Interface::PrintError("Expected file part index: %d Received: %d\n", filePartIndex, receivedPartIndex);
+				PrintFilePartStatistics(statistics);
+				delete [] partBuffer;
 				return (false);
 			}
 
-			bytesTransferred += SendFilePartPacket::kDefaultPacketSize;
+			bytesTransferred += filePartSize;
 			if (bytesTransferred > fileSize)
 				bytesTransferred = fileSize;
 
-			currentPercent = (int)(100.0f * ((float)bytesTransferred / (float)fileSize));
+			if (progress)
+			{
+				progress->Update(bytesTransferred);
+				continue;
+			}
+
+			currentPercent = static_cast<int>(100 * bytesTransferred / fileSize);
 
 			if (currentPercent != previousPercent)
 			{
@@ -2305,48 +2641,57 @@ bool BridgeManager::SendFile(FILE *file, int destination, int fileIdentifier)
 
 		if (destination == EndFileTransferPacket::kDestinationPhone)
 		{
-			EndPhoneFileTransferPacket *endPhoneFileTransferPacket = new EndPhoneFileTransferPacket(
-				(isLastSequence) ? partialPacketLength : 0, lastFullPacketIndex, 0, 0, fileIdentifier, isLastSequence);
+			EndPhoneFileTransferPacket endPhoneFileTransferPacket((isLastSequence) ? partialPacketLength : 0, lastFullPacketIndex, 0, 0,
+				fileIdentifier, isLastSequence);
 
-			success = SendPacket(endPhoneFileTransferPacket, 3000);
-			delete endPhoneFileTransferPacket;
+			success = SendPacket(&endPhoneFileTransferPacket, 3000);
 
 			if (!success)
 			{
 				Interface::PrintErrorSameLine("\n");
 				Interface::PrintError("Failed to end phone file transfer sequence!\n");
+				delete [] partBuffer;
 				return (false);
 			}
 		}
 		else // destination == EndFileTransferPacket::kDestinationModem
 		{
-			EndModemFileTransferPacket *endModemFileTransferPacket = new EndModemFileTransferPacket(
-				(isLastSequence) ? partialPacketLength : 0, lastFullPacketIndex, 0, 0, isLastSequence);
+			EndModemFileTransferPacket endModemFileTransferPacket((isLastSequence) ? partialPacketLength : 0, lastFullPacketIndex, 0, 0,
+				isLastSequence);
 
-			success = SendPacket(endModemFileTransferPacket, 3000);
-			delete endModemFileTransferPacket;
+			success = SendPacket(&endModemFileTransferPacket, 3000);
 
 			if (!success)
 			{
 				Interface::PrintErrorSameLine("\n");
 				Interface::PrintError("Failed to end modem file transfer sequence!\n");
+				delete [] partBuffer;
 				return (false);
 			}
 		}
 
-		fileTransferResponse = new ResponsePacket(ResponsePacket::kResponseTypeFileTransfer);
-		success = ReceivePacket(fileTransferResponse, 30000);
-		delete fileTransferResponse;
+		ResponsePacket endFileTransferResponse(ResponsePacket::kResponseTypeFileTransfer);
+		success = ReceivePacket(&endFileTransferResponse, 30000);
 
 		if (!success)
 		{
 			Interface::PrintErrorSameLine("\n");
 			Interface::PrintError("Failed to confirm end of file transfer sequence!\n");
+			delete [] partBuffer;
 			return (false);
 		}
+
+		HEIMDALL_PROBE3(file_sequence_end, fileIdentifier, sequenceIndex, bytesTransferred);
+
+		if (observer)
+			observer->OnSequenceCompleted(sequenceIndex, sequenceCount, bytesTransferred);
 	}
 
-	if (!verbose)
+	delete [] partBuffer;
+
+	PrintFilePartStatistics(statistics);
+
+	if (!verbose && !progress)
 		Interface::Print("\n");
 
 	return (true);
@@ -2387,9 +2732,8 @@ bool BridgeManager::ReceiveDump(int chipType, int chipId, FILE *file)
 
 	for (unsigned int i = 0; i < transferCount; i++)
 	{
-		DumpPartFileTransferPacket *dumpPartPacket = new DumpPartFileTransferPacket(i);
-		success = SendPacket(dumpPartPacket);
-		delete dumpPartPacket;
+		DumpPartFileTransferPacket dumpPartPacket(i);
+		success = SendPacket(&dumpPartPacket);
 
 		if (!success)
 		{
@@ -2398,19 +2742,16 @@ bool BridgeManager::ReceiveDump(int chipType, int chipId, FILE *file)
 			return (false);
 		}
 
-		ReceiveFilePartPacket *receiveFilePartPacket = new ReceiveFilePartPacket();
-		success = ReceivePacket(receiveFilePartPacket);
+		ReceiveFilePartPacket receiveFilePartPacket;
+		success = ReceivePacket(&receiveFilePartPacket);
 
 		if (!success)
 		{
 			Interface::PrintError("Failed to receive dump part #%d!\n", i);
 			continue;
-			delete receiveFilePartPacket;
-			delete [] buffer;
-			return (true);
 		}
 
-		if (bufferOffset + receiveFilePartPacket->GetReceivedSize() > kDumpBufferSize * ReceiveFilePartPacket::kDataSize)
+		if (bufferOffset + receiveFilePartPacket.GetReceivedSize() > kDumpBufferSize * ReceiveFilePartPacket::kDataSize)
 		{
 			// Write the buffer to the output file
 			fwrite(buffer, 1, bufferOffset, file);
@@ -2418,10 +2759,8 @@ bool BridgeManager::ReceiveDump(int chipType, int chipId, FILE *file)
 		}
 
 		// Copy the packet data into pitFile.
-		memcpy(buffer + bufferOffset, receiveFilePartPacket->GetData(), receiveFilePartPacket->GetReceivedSize());
-		bufferOffset += receiveFilePartPacket->GetReceivedSize();
-
-		delete receiveFilePartPacket;
+		memcpy(buffer + bufferOffset, receiveFilePartPacket.GetData(), receiveFilePartPacket.GetReceivedSize());
+		bufferOffset += receiveFilePartPacket.GetReceivedSize();
 	}
 
 	if (bufferOffset != 0)
@@ -32,12 +32,17 @@
 #else // of if GTP7510
 #endif // of else of if GTP7510
 
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
 // Heimdall
 #include "Heimdall.h"
 
 struct libusb_context;
 struct libusb_device;
 struct libusb_device_handle;
+struct libusb_device_descriptor;
 #if GTP7510
 struct libusb_transfer;
 #else // of if GTP7510
@@ -45,8 +50,24 @@ struct libusb_transfer;
 
 namespace Heimdall
 {
+	class FileSource;
 	class InboundPacket;
 	class OutboundPacket;
+	class SendFilePartPacket;
+	class FlashProgress;
+	class SimulatedDevice;
+
+	// Told about each file transfer sequence SendFile() completes, i.e. once the device has confirmed its end.
+	class TransferObserver
+	{
+		public:
+
+			virtual ~TransferObserver()
+			{
+			}
+
+			virtual void OnSequenceCompleted(unsigned int sequenceIndex, unsigned int sequenceCount, long long bytesTransferred) = 0;
+	};
 
 	class DeviceIdentifier
 	{
@@ -71,7 +92,13 @@ namespace Heimdall
 				kSupportedDeviceCount		= 3,
 
 				kCommunicationDelayDefault	= 0,
-				kDumpBufferSize				= 4096
+				kDumpBufferSize				= 4096,
+
+				// Most PIT part requests HEIMDALL_PIT_PIPELINE_DEPTH may allow outstanding at once.
+				kPitTransferPipelineDepth	= 16,
+
+				// Times a file part is resent before the flash is abandoned.
+				kMaxFilePartRetransmissions	= 4
 			};
 
 			enum
@@ -95,6 +122,15 @@ namespace Heimdall
 
 		private:
 
+			// Counted per SendFile() and reported in verbose output.
+			struct FilePartStatistics
+			{
+				unsigned int retransmittedParts;
+				unsigned int retransmissions;
+				unsigned int sendFailures;
+				unsigned int receiveFailures;
+			};
+
 			static const DeviceIdentifier supportedDevices[kSupportedDeviceCount];
 
 			bool verbose;
@@ -103,6 +139,17 @@ namespace Heimdall
 			libusb_device_handle *deviceHandle;
 			libusb_device *heimdallDevice;
 
+			// Identity of the connected device, used to key per-device state kept on the host.
+			int vendorId;
+			int productId;
+			int deviceRevision;
+			int deviceType;
+			std::string serialNumber;
+
+			// Where the device to use must be plugged in, -1 for any bus or port.
+			int selectedBusNumber;
+			int selectedPortNumber;
+
 #if GTP7510
 
 			int bInterfaceNumber_comm;
@@ -140,16 +187,43 @@ namespace Heimdall
 
 			int communicationDelay;
 
+			// PIT part requests outstanding at once. Only one unless HEIMDALL_PIT_PIPELINE_DEPTH asks for more, as devices
+			// haven't been shown to accept queued requests.
+			int pitPipelineDepth;
+
+			// Whether a cached PIT is trusted once its first part matches. Off unless HEIMDALL_PIT_CACHE_QUICK_CHECK is set,
+			// as later entries aren't checked and ending the dump early hasn't been tested on devices.
+			bool pitCacheQuickCheck;
+
+			// When set, packets are exchanged with it rather than over USB.
+			SimulatedDevice *simulatedDevice;
+
+			// Bytes per file part and parts per sequence. Devices expect the defaults, only the benchmark changes them.
+			int fileTransferPartSize;
+			int fileTransferSequenceLength;
+
+			// Reused by SendPacket() for packets whose segments need to be coalesced.
+			std::vector<unsigned char> sendStaging;
+
 #ifdef OS_LINUX
 
 			bool detachedDriver;
 
 #endif
 
+			bool ReceiveFilePart(unsigned char *destination, int size, int timeout = 3000, bool retry = true);
+			void DrainFileParts(int count);
+
+			bool SendFilePart(SendFilePartPacket *sendFilePartPacket, int filePartIndex, FilePartStatistics *statistics);
+			void PrintFilePartStatistics(const FilePartStatistics& statistics) const;
+
 			bool CheckProtocol(void);
 			bool InitialiseProtocol(void);
 			bool ResetInterface();
 
+			void RecordDeviceIdentity(const libusb_device_descriptor *deviceDescriptor);
+			bool IsAtSelectedLocation(libusb_device *device) const;
+
 #if GTP7510
 
 			void StartAsyncTransfers();
@@ -192,16 +266,67 @@ namespace Heimdall
 			bool RequestDeviceInfo(unsigned int request, int *result);
 
 			bool SendPitFile(FILE *file);
-			int ReceivePitFile(unsigned char **pitBuffer);
-
-			bool SendFile(FILE *file, int destination, int fileIdentifier = -1);
+			// When cachedPit is given *cacheMatched is set if it's identical to the device's PIT. With the quick check the
+			// download stops once the first part matches and the cached copy is returned in *pitBuffer.
+			int ReceivePitFile(unsigned char **pitBuffer, const unsigned char *cachedPit = nullptr, int cachedPitSize = 0,
+				bool *cacheMatched = nullptr);
+
+			// Progress is reported to progress if given, otherwise a percentage is printed.
+			bool SendFile(FileSource *source, int destination, int fileIdentifier = -1, TransferObserver *observer = nullptr,
+				FlashProgress *progress = nullptr);
 			bool ReceiveDump(int chipType, int chipId, FILE *file);
 
+			// Must be set before Initialise().
+			void SetSimulatedDevice(SimulatedDevice *simulatedDevice)
+			{
+				this->simulatedDevice = simulatedDevice;
+			}
+
+			// Must be set before DetectDevice() or Initialise(), otherwise the first supported device found is used.
+			void SetDeviceLocation(int busNumber, int portNumber)
+			{
+				selectedBusNumber = busNumber;
+				selectedPortNumber = portNumber;
+			}
+
+			void SetFileTransferGeometry(int partSize, int sequenceLength)
+			{
+				fileTransferPartSize = partSize;
+				fileTransferSequenceLength = sequenceLength;
+			}
+
 			bool IsVerbose(void) const
 			{
 				return (verbose);
 			}
 
+			int GetVendorId(void) const
+			{
+				return (vendorId);
+			}
+
+			int GetProductId(void) const
+			{
+				return (productId);
+			}
+
+			int GetDeviceRevision(void) const
+			{
+				return (deviceRevision);
+			}
+
+			// Only valid once a session has begun, -1 otherwise.
+			int GetDeviceType(void) const
+			{
+				return (deviceType);
+			}
+
+			// Empty if the device doesn't report a serial number.
+			const std::string& GetSerialNumber(void) const
+			{
+				return (serialNumber);
+			}
+
 #if GTP7510
 			//	These are public just so they can be called from some extern "C" code.
 			void OnAsyncTransferComplete_Bulk_In(libusb_transfer * transfer);
@@ -40,18 +40,23 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::WireField<0, unsigned int> ControlTypeField;
+
 			enum
 			{
-				kDataSize = 4
+				kPacketSize = 1024,
+				kDataSize = ControlTypeField::kEnd
 			};
 
+			WIRE_STATIC_ASSERT(kPacketSize <= static_cast<unsigned int>(Packet::kInlineCapacity), ControlPacketIsInline);
+
 		private:
 
 			unsigned int controlType;
 
 		public:
 
-			ControlPacket(unsigned int controlType) : OutboundPacket(1024)
+			ControlPacket(unsigned int controlType) : OutboundPacket(kPacketSize)
 			{
 				this->controlType = controlType;
 			}
@@ -63,7 +68,7 @@ namespace Heimdall
 
 			virtual void Pack(void)
 			{
-				PackInteger(0, controlType);
+				PackField<ControlTypeField>(controlType);
 			}
 	};
 }
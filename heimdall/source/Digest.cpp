@@ -0,0 +1,62 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Digest.h"
+
+using namespace Heimdall;
+
+bool Digest::Parse(const char *text, unsigned int size, unsigned char *digest)
+{
+	for (unsigned int i = 0; i < size * 2; i++)
+	{
+		char c = text[i];
+		int value;
+
+		if (c >= '0' && c <= '9')
+			value = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			value = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			value = c - 'A' + 10;
+		else
+			return (false);
+
+		if (i % 2 == 0)
+			digest[i / 2] = value << 4;
+		else
+			digest[i / 2] |= value;
+	}
+
+	return (true);
+}
+
+void Digest::Format(const unsigned char *digest, unsigned int size, char *text)
+{
+	for (unsigned int i = 0; i < size; i++)
+		sprintf(text + i * 2, "%02x", digest[i]);
+
+	text[size * 2] = '\0';
+}
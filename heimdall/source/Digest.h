@@ -0,0 +1,41 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef DIGEST_H
+#define DIGEST_H
+
+namespace Heimdall
+{
+	// Conversion between binary digests and the hex text used by md5sum/sha256sum style files.
+	class Digest
+	{
+		public:
+
+			// Parses size * 2 hex digits, returns false if text doesn't start with that many.
+			static bool Parse(const char *text, unsigned int size, unsigned char *digest);
+
+			// text must have room for size * 2 + 1 characters.
+			static void Format(const unsigned char *digest, unsigned int size, char *text);
+	};
+}
+
+#endif
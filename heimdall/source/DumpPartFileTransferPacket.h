@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<FileTransferPacket::kDataSize, unsigned int> PartIndexField;
+
+			WIRE_STATIC_ASSERT(PartIndexField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int partIndex;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, partIndex);
+				PackField<PartIndexField>(partIndex);
 			}
 	};
 }
@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<PitFilePacket::kDataSize, unsigned int> PartIndexField;
+
+			WIRE_STATIC_ASSERT(PartIndexField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int partIndex;
 
 		public:
@@ -44,11 +48,16 @@ namespace Heimdall
 				return (partIndex);
 			}
 
+			void SetPartIndex(unsigned int partIndex)
+			{
+				this->partIndex = partIndex;
+			}
+
 			void Pack(void)
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, partIndex);
+				PackField<PartIndexField>(partIndex);
 			}
 	};
 }
@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<ResponsePacket::kDataSize, unsigned int> DumpSizeField;
+
+			WIRE_STATIC_ASSERT(DumpSizeField::kEnd <= static_cast<unsigned int>(ResponsePacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int dumpSize;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				dumpSize = UnpackInteger(ResponsePacket::kDataSize);
+				dumpSize = UnpackField<DumpSizeField>();
 				
 				return (true);
 			}
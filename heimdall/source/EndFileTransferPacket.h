@@ -38,9 +38,15 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::WireField<FileTransferPacket::kDataSize, unsigned int> DestinationField;
+			typedef libpit::WireField<DestinationField::kEnd, unsigned short> PartialPacketLengthField;
+			typedef libpit::WireField<PartialPacketLengthField::kEnd, unsigned int> LastFullPacketIndexField;
+			typedef libpit::WireField<LastFullPacketIndexField::kEnd, unsigned short> Unknown1Field;
+			typedef libpit::WireField<Unknown1Field::kEnd, unsigned int> Unknown2Field;
+
 			enum
 			{
-				kDataSize = FileTransferPacket::kDataSize + 16
+				kDataSize = Unknown2Field::kEnd
 			};
 
 		private:
@@ -108,11 +114,11 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackInteger(FileTransferPacket::kDataSize, destination);
-				PackShort(FileTransferPacket::kDataSize + 4, partialPacketLength);
-				PackInteger(FileTransferPacket::kDataSize + 6, lastFullPacketIndex);
-				PackShort(FileTransferPacket::kDataSize + 10, unknown1);
-				PackInteger(FileTransferPacket::kDataSize + 12, unknown2);
+				PackField<DestinationField>(destination);
+				PackField<PartialPacketLengthField>(partialPacketLength);
+				PackField<LastFullPacketIndexField>(lastFullPacketIndex);
+				PackField<Unknown1Field>(unknown1);
+				PackField<Unknown2Field>(unknown2);
 			}
 	};
 }
@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<EndFileTransferPacket::kDataSize, unsigned int> EndOfFileField;
+
+			WIRE_STATIC_ASSERT(EndOfFileField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int endOfFile;
 
 		public:
@@ -51,7 +55,7 @@ namespace Heimdall
 			{
 				EndFileTransferPacket::Pack();
 
-				PackInteger(EndFileTransferPacket::kDataSize, endOfFile);
+				PackField<EndOfFileField>(endOfFile);
 			}
 	};
 }
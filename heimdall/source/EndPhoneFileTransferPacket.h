@@ -52,6 +52,11 @@ namespace Heimdall
 
 		private:
 
+			typedef libpit::WireField<EndFileTransferPacket::kDataSize, unsigned int> FileIdentifierField;
+			typedef libpit::WireField<FileIdentifierField::kEnd, unsigned int> EndOfFileField;
+
+			WIRE_STATIC_ASSERT(EndOfFileField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int fileIdentifier;
 			unsigned int endOfFile;
 
@@ -80,8 +85,8 @@ namespace Heimdall
 			{
 				EndFileTransferPacket::Pack();
 
-				PackInteger(EndFileTransferPacket::kDataSize, fileIdentifier);
-				PackInteger(EndFileTransferPacket::kDataSize + 4, endOfFile);
+				PackField<FileIdentifierField>(fileIdentifier);
+				PackField<EndOfFileField>(endOfFile);
 			}
 	};
 }
@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<PitFilePacket::kDataSize, unsigned int> FileSizeField;
+
+			WIRE_STATIC_ASSERT(FileSizeField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int fileSize;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, fileSize);
+				PackField<FileSizeField>(fileSize);
 			}
 	};
 }
@@ -38,6 +38,10 @@ namespace Heimdall
 
 		private:
 
+			typedef libpit::WireField<ControlPacket::kDataSize, unsigned int> RequestField;
+
+			WIRE_STATIC_ASSERT(RequestField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int request;
 
 		public:
@@ -56,7 +60,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				PackField<RequestField>(request);
 			}
 	};
 }
@@ -0,0 +1,149 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Heimdall
+#include "FileSource.h"
+#include "Heimdall.h"
+
+using namespace Heimdall;
+
+bool FileSource::Seek(FILE *file, long long offset)
+{
+#ifdef OS_WINDOWS
+	return (_fseeki64(file, offset, SEEK_SET) == 0);
+#else
+	return (fseeko(file, offset, SEEK_SET) == 0);
+#endif
+}
+
+long long FileSource::GetFileSize(FILE *file)
+{
+#ifdef OS_WINDOWS
+	struct _stati64 fileStat;
+
+	if (_fstati64(_fileno(file), &fileStat) != 0)
+		return (-1);
+#else
+	struct stat fileStat;
+
+	if (fstat(fileno(file), &fileStat) != 0)
+		return (-1);
+#endif
+
+	return (static_cast<long long>(fileStat.st_size));
+}
+
+long long FileSource::GetModificationTime(FILE *file)
+{
+#ifdef OS_WINDOWS
+	struct _stati64 fileStat;
+
+	if (_fstati64(_fileno(file), &fileStat) != 0)
+		return (-1);
+#else
+	struct stat fileStat;
+
+	if (fstat(fileno(file), &fileStat) != 0)
+		return (-1);
+#endif
+
+	return (static_cast<long long>(fileStat.st_mtime));
+}
+
+bool FileSource::IsStream(FILE *file)
+{
+#ifdef OS_WINDOWS
+	struct _stati64 fileStat;
+
+	if (_fstati64(_fileno(file), &fileStat) != 0)
+		return (false);
+
+	return ((fileStat.st_mode & _S_IFREG) == 0);
+#else
+	struct stat fileStat;
+
+	if (fstat(fileno(file), &fileStat) != 0)
+		return (false);
+
+	// Block devices can be seeked, but fstat reports no size for them.
+	return (!S_ISREG(fileStat.st_mode));
+#endif
+}
+
+unsigned int FileSource::ReadAt(FILE *file, long long offset, unsigned char *buffer, unsigned int size)
+{
+#ifdef OS_WINDOWS
+	// No pread, fall back to the stream. Callers on Windows don't share a FILE between threads.
+	if (!Seek(file, offset))
+		return (0);
+
+	return (fread(buffer, 1, size, file));
+#else
+	int descriptor = fileno(file);
+	unsigned int bytesRead = 0;
+
+	while (bytesRead < size)
+	{
+		ssize_t result = pread(descriptor, buffer + bytesRead, size - bytesRead, static_cast<off_t>(offset + bytesRead));
+
+		if (result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		if (result == 0)
+			break;
+
+		bytesRead += static_cast<unsigned int>(result);
+	}
+
+	return (bytesRead);
+#endif
+}
+
+FileRegionSource::FileRegionSource(FILE *file, long long offset, long long size)
+{
+	this->file = file;
+	this->offset = offset;
+	this->size = size;
+
+	position = 0;
+}
+
+unsigned int FileRegionSource::Read(unsigned char *buffer, unsigned int size)
+{
+	if (static_cast<long long>(size) > this->size - position)
+		size = static_cast<unsigned int>(this->size - position);
+
+	unsigned int bytesRead = ReadAt(file, offset + position, buffer, size);
+	position += bytesRead;
+
+	return (bytesRead);
+}
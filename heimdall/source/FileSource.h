@@ -0,0 +1,86 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef FILESOURCE_H
+#define FILESOURCE_H
+
+// C Standard Library
+#include <stdio.h>
+
+namespace Heimdall
+{
+	// Supplies the bytes SendFile transfers. Sources are read once, front to back.
+	class FileSource
+	{
+		public:
+
+			virtual ~FileSource()
+			{
+			}
+
+			// Number of bytes Read() produces in total.
+			virtual long long GetSize(void) const = 0;
+
+			// Reads up to size bytes into buffer and returns how many were read. Less than size is only returned at the
+			// end of the source or when reading fails.
+			virtual unsigned int Read(unsigned char *buffer, unsigned int size) = 0;
+
+			// 64-bit file helpers, long is only 32-bit on Windows.
+			static bool Seek(FILE *file, long long offset);
+			static long long GetFileSize(FILE *file);
+
+			// Seconds since the epoch, or -1 if it's unknown.
+			static long long GetModificationTime(FILE *file);
+
+			// Reads from an absolute offset without using the stream's position, so any number of regions of one file
+			// can be read in any order. Returns the number of bytes read.
+			static unsigned int ReadAt(FILE *file, long long offset, unsigned char *buffer, unsigned int size);
+
+			// True for pipes, FIFOs and the like, which can only be read once from front to back and have no size.
+			static bool IsStream(FILE *file);
+	};
+
+	// A byte range within an open file, either the whole file or a member of a package.
+	class FileRegionSource : public FileSource
+	{
+		private:
+
+			FILE *file;
+
+			long long offset;
+			long long size;
+			long long position;
+
+		public:
+
+			FileRegionSource(FILE *file, long long offset, long long size);
+
+			long long GetSize(void) const
+			{
+				return (size);
+			}
+
+			unsigned int Read(unsigned char *buffer, unsigned int size);
+	};
+}
+
+#endif
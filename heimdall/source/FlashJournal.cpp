@@ -0,0 +1,224 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+#include <string.h>
+
+// Heimdall
+#include "Digest.h"
+#include "FlashJournal.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitCache.h"
+
+using namespace std;
+using namespace Heimdall;
+
+static const char *kJournalSignature = "heimdall-journal 2";
+
+FlashJournal::FlashJournal(const BridgeManager *bridgeManager)
+{
+	directory = PitCache::GetCacheDirectory("journal");
+	key = PitCache::GetDeviceKey(bridgeManager);
+
+	currentEntry = entries.end();
+
+	Load();
+}
+
+string FlashJournal::GetPath(void) const
+{
+#ifdef OS_WINDOWS
+	return (directory + "\\" + key + ".journal");
+#else
+	return (directory + "/" + key + ".journal");
+#endif
+}
+
+void FlashJournal::Load(void)
+{
+	if (!IsAvailable())
+		return;
+
+	FILE *file = fopen(GetPath().c_str(), "r");
+
+	if (!file)
+		return;
+
+	char line[160];
+
+	if (!fgets(line, sizeof(line), file) || strncmp(line, kJournalSignature, strlen(kJournalSignature)) != 0)
+	{
+		fclose(file);
+		return;
+	}
+
+	// One line per partition: <identifier> <size> <offset> <modification time> <MD5, or - if the image wasn't hashed>
+	// <completed sequences> <sequence count>. Anything malformed is ignored, it only costs a re-flash.
+	while (fgets(line, sizeof(line), file))
+	{
+		unsigned int partitionIdentifier;
+		JournalEntry entry;
+		char digestText[Md5::kDigestSize * 2 + 1];
+
+		if (sscanf(line, "%u %lld %lld %lld %32s %u %u", &partitionIdentifier, &entry.image.size, &entry.image.offset,
+			&entry.image.modificationTime, digestText, &entry.completedSequences, &entry.sequenceCount) != 7)
+		{
+			continue;
+		}
+
+		entry.image.hasDigest = strcmp(digestText, "-") != 0;
+
+		if (entry.image.hasDigest && (strlen(digestText) != Md5::kDigestSize * 2
+			|| !Digest::Parse(digestText, Md5::kDigestSize, entry.image.digest)))
+		{
+			continue;
+		}
+
+		entries[partitionIdentifier] = entry;
+	}
+
+	fclose(file);
+}
+
+bool FlashJournal::Save(void) const
+{
+	if (!IsAvailable())
+		return (false);
+
+	if (!PitCache::MakeDirectory(directory))
+	{
+		Interface::Print("WARNING: Failed to create flash journal directory \"%s\"\n", directory.c_str());
+		return (false);
+	}
+
+	// Written to a temporary file and moved into place, the same as the ledger, a connection dropping mid-write must not
+	// take the journal with it.
+	string path = GetPath();
+	string temporaryPath = path + ".tmp";
+
+	FILE *file = fopen(temporaryPath.c_str(), "w");
+
+	if (!file)
+	{
+		Interface::Print("WARNING: Failed to write flash journal \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	bool success = fprintf(file, "%s\n", kJournalSignature) > 0;
+
+	for (map<unsigned int, JournalEntry>::const_iterator it = entries.begin(); it != entries.end() && success; it++)
+	{
+		const JournalEntry& entry = it->second;
+		char digestText[Md5::kDigestSize * 2 + 1] = "-";
+
+		if (entry.image.hasDigest)
+			Digest::Format(entry.image.digest, Md5::kDigestSize, digestText);
+
+		success = fprintf(file, "%u %lld %lld %lld %s %u %u\n", it->first, entry.image.size, entry.image.offset,
+			entry.image.modificationTime, digestText, entry.completedSequences, entry.sequenceCount) > 0;
+	}
+
+	success = fclose(file) == 0 && success;
+
+#ifdef OS_WINDOWS
+	if (success)
+		remove(path.c_str());
+#endif
+
+	if (!success || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		Interface::Print("WARNING: Failed to write flash journal \"%s\"\n", path.c_str());
+		remove(temporaryPath.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+bool FlashJournal::GetProgress(unsigned int partitionIdentifier, const JournalImage& image, unsigned int *completedSequences,
+	unsigned int *sequenceCount) const
+{
+	map<unsigned int, JournalEntry>::const_iterator it = entries.find(partitionIdentifier);
+
+	if (it == entries.end())
+		return (false);
+
+	const JournalImage& journalImage = it->second.image;
+
+	// Without a modification time there's nothing to tell a rebuilt image apart by. The size and modification time are
+	// checked first, there's no point comparing digests of images that have obviously changed.
+	if (image.modificationTime < 0 || journalImage.size != image.size || journalImage.offset != image.offset
+		|| journalImage.modificationTime != image.modificationTime)
+	{
+		return (false);
+	}
+
+	// A file can be rewritten without its size or modification time changing, only the digest says it's the same image.
+	if (!image.hasDigest || !journalImage.hasDigest || memcmp(journalImage.digest, image.digest, Md5::kDigestSize) != 0)
+		return (false);
+
+	*completedSequences = it->second.completedSequences;
+	*sequenceCount = it->second.sequenceCount;
+
+	return (true);
+}
+
+void FlashJournal::BeginPartition(unsigned int partitionIdentifier, const JournalImage& image)
+{
+	JournalEntry entry;
+
+	entry.image = image;
+	entry.completedSequences = 0;
+	entry.sequenceCount = 0;
+
+	entries[partitionIdentifier] = entry;
+	currentEntry = entries.find(partitionIdentifier);
+
+	Save();
+}
+
+void FlashJournal::EndPartition(void)
+{
+	currentEntry = entries.end();
+}
+
+void FlashJournal::OnSequenceCompleted(unsigned int sequenceIndex, unsigned int sequenceCount, long long /*bytesTransferred*/)
+{
+	if (currentEntry == entries.end())
+		return;
+
+	currentEntry->second.completedSequences = sequenceIndex + 1;
+	currentEntry->second.sequenceCount = sequenceCount;
+
+	Save();
+}
+
+void FlashJournal::Clear(void)
+{
+	entries.clear();
+	currentEntry = entries.end();
+
+	if (IsAvailable())
+		remove(GetPath().c_str());
+}
@@ -0,0 +1,104 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef FLASHJOURNAL_H
+#define FLASHJOURNAL_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+
+// Heimdall
+#include "BridgeManager.h"
+#include "Md5.h"
+
+namespace Heimdall
+{
+	// Identifies the image a partition is flashed from, it's compared against the image given when resuming so a rebuilt
+	// image is never mistaken for the one that was interrupted. The size and modification time are only a cheap first
+	// check, the MD5 must match too.
+	struct JournalImage
+	{
+		long long size;
+		long long offset;
+		long long modificationTime;
+
+		bool hasDigest;
+		unsigned char digest[Md5::kDigestSize];
+	};
+
+	// Per device journal of the flash in progress, stored alongside the ledger and PIT cache. Every sequence the device
+	// confirms is recorded, so after a dropped connection --resume knows which partitions were completely flashed and
+	// how far the interrupted one got. The journal is removed once a flash completes.
+	class FlashJournal : public TransferObserver
+	{
+		private:
+
+			struct JournalEntry
+			{
+				JournalImage image;
+
+				unsigned int completedSequences;
+				unsigned int sequenceCount;
+			};
+
+			std::string directory;
+			std::string key;
+
+			std::map<unsigned int, JournalEntry> entries;
+
+			// Partition the sequences being reported belong to.
+			std::map<unsigned int, JournalEntry>::iterator currentEntry;
+
+			std::string GetPath(void) const;
+
+			void Load(void);
+			bool Save(void) const;
+
+			FlashJournal(const FlashJournal&);
+			FlashJournal& operator=(const FlashJournal&);
+
+		public:
+
+			FlashJournal(const BridgeManager *bridgeManager);
+
+			bool IsAvailable(void) const
+			{
+				return (!key.empty() && !directory.empty());
+			}
+
+			// Returns false if the journal has nothing for the partition or it was being flashed from a different image. An
+			// image without an MD5, given or journalled, is always treated as different.
+			bool GetProgress(unsigned int partitionIdentifier, const JournalImage& image, unsigned int *completedSequences,
+				unsigned int *sequenceCount) const;
+
+			void BeginPartition(unsigned int partitionIdentifier, const JournalImage& image);
+			void EndPartition(void);
+
+			void OnSequenceCompleted(unsigned int sequenceIndex, unsigned int sequenceCount, long long bytesTransferred);
+
+			// Forgets everything, removing the journal file.
+			void Clear(void);
+	};
+}
+
+#endif
@@ -0,0 +1,185 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Heimdall
+#include "BridgeManager.h"
+#include "Digest.h"
+#include "FlashLedger.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitCache.h"
+
+using namespace std;
+using namespace Heimdall;
+
+static const char *kLedgerSignature = "heimdall-ledger 1";
+
+FlashLedger::FlashLedger(const BridgeManager *bridgeManager)
+{
+	const char *overrideDirectory = getenv("HEIMDALL_FLASH_LEDGER");
+
+	if (overrideDirectory && *overrideDirectory)
+		directory = overrideDirectory;
+	else
+		directory = PitCache::GetCacheDirectory("ledger");
+
+	key = PitCache::GetDeviceKey(bridgeManager);
+
+	Load();
+}
+
+string FlashLedger::GetPath(void) const
+{
+#ifdef OS_WINDOWS
+	return (directory + "\\" + key + ".ledger");
+#else
+	return (directory + "/" + key + ".ledger");
+#endif
+}
+
+void FlashLedger::Load(void)
+{
+	if (!IsAvailable())
+		return;
+
+	FILE *file = fopen(GetPath().c_str(), "r");
+
+	if (!file)
+		return;
+
+	char line[128];
+
+	if (!fgets(line, sizeof(line), file) || strncmp(line, kLedgerSignature, strlen(kLedgerSignature)) != 0)
+	{
+		fclose(file);
+		return;
+	}
+
+	// One line per partition: <identifier> <size> <MD5>. Anything malformed is ignored, it only costs a re-flash.
+	while (fgets(line, sizeof(line), file))
+	{
+		unsigned int partitionIdentifier;
+		long long size;
+		char digestText[Md5::kDigestSize * 2 + 1];
+
+		LedgerEntry entry;
+
+		if (sscanf(line, "%u %lld %32s", &partitionIdentifier, &size, digestText) != 3 || strlen(digestText) != Md5::kDigestSize * 2
+			|| !Digest::Parse(digestText, Md5::kDigestSize, entry.digest))
+		{
+			continue;
+		}
+
+		entry.size = size;
+		entries[partitionIdentifier] = entry;
+	}
+
+	fclose(file);
+}
+
+bool FlashLedger::Save(void) const
+{
+	if (!IsAvailable())
+		return (false);
+
+	if (!PitCache::MakeDirectory(directory))
+	{
+		Interface::Print("WARNING: Failed to create flash ledger directory \"%s\"\n", directory.c_str());
+		return (false);
+	}
+
+	// Written to a temporary file and moved into place, the same as PIT cache entries.
+	string path = GetPath();
+	string temporaryPath = path + ".tmp";
+
+	FILE *file = fopen(temporaryPath.c_str(), "w");
+
+	if (!file)
+	{
+		Interface::Print("WARNING: Failed to write flash ledger \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	bool success = fprintf(file, "%s\n", kLedgerSignature) > 0;
+
+	for (map<unsigned int, LedgerEntry>::const_iterator it = entries.begin(); it != entries.end() && success; it++)
+	{
+		char digestText[Md5::kDigestSize * 2 + 1];
+		Digest::Format(it->second.digest, Md5::kDigestSize, digestText);
+
+		success = fprintf(file, "%u %lld %s\n", it->first, it->second.size, digestText) > 0;
+	}
+
+	success = fclose(file) == 0 && success;
+
+#ifdef OS_WINDOWS
+	if (success)
+		remove(path.c_str());
+#endif
+
+	if (!success || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		Interface::Print("WARNING: Failed to write flash ledger \"%s\"\n", path.c_str());
+		remove(temporaryPath.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+bool FlashLedger::Matches(unsigned int partitionIdentifier, long long size, const unsigned char *digest) const
+{
+	map<unsigned int, LedgerEntry>::const_iterator it = entries.find(partitionIdentifier);
+
+	return (it != entries.end() && it->second.size == size && memcmp(it->second.digest, digest, Md5::kDigestSize) == 0);
+}
+
+void FlashLedger::Record(unsigned int partitionIdentifier, long long size, const unsigned char *digest)
+{
+	LedgerEntry entry;
+
+	entry.size = size;
+	memcpy(entry.digest, digest, Md5::kDigestSize);
+
+	entries[partitionIdentifier] = entry;
+	Save();
+}
+
+void FlashLedger::Forget(unsigned int partitionIdentifier)
+{
+	if (entries.erase(partitionIdentifier) > 0)
+		Save();
+}
+
+void FlashLedger::Clear(void)
+{
+	if (entries.empty())
+		return;
+
+	entries.clear();
+	Save();
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef FLASHLEDGER_H
+#define FLASHLEDGER_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+
+// Heimdall
+#include "Md5.h"
+
+namespace Heimdall
+{
+	class BridgeManager;
+
+	// Per device record of the image last flashed successfully to each partition, kept alongside the PIT cache and keyed
+	// by the same device identity. A partition's record is dropped before it's flashed and only written back once the
+	// flash succeeds, so an interrupted or failed flash never leaves a record behind. Images flashed by other tools
+	// can't be seen, which is why skipping is opt-in.
+	class FlashLedger
+	{
+		private:
+
+			struct LedgerEntry
+			{
+				long long size;
+				unsigned char digest[Md5::kDigestSize];
+			};
+
+			std::string directory;
+			std::string key;
+
+			std::map<unsigned int, LedgerEntry> entries;
+
+			std::string GetPath(void) const;
+
+			void Load(void);
+			bool Save(void) const;
+
+		public:
+
+			FlashLedger(const BridgeManager *bridgeManager);
+
+			bool IsAvailable(void) const
+			{
+				return (!key.empty() && !directory.empty());
+			}
+
+			bool Matches(unsigned int partitionIdentifier, long long size, const unsigned char *digest) const;
+
+			void Record(unsigned int partitionIdentifier, long long size, const unsigned char *digest);
+			void Forget(unsigned int partitionIdentifier);
+
+			// Repartitioning can move everything, so nothing recorded before it can be trusted.
+			void Clear(void);
+	};
+}
+
+#endif
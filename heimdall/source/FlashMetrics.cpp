@@ -0,0 +1,410 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Heimdall
+#include "FlashMetrics.h"
+#include "Heimdall.h"
+#include "HostUsage.h"
+#include "Interface.h"
+
+#ifndef OS_WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#endif
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	kMaxMetricsLineLength = 1024
+};
+
+struct MetricFamily
+{
+	const char *name;
+	const char *type;
+	const char *help;
+};
+
+static const MetricFamily metricFamilies[] = {
+	{ "heimdall_sessions_total", "counter", "Jobs run against a device, by action and result." },
+	{ "heimdall_failures_total", "counter", "Failed jobs, by action and the phase they failed in." },
+	{ "heimdall_phase_duration_seconds", "histogram", "Time spent in each phase of a job." },
+	{ "heimdall_flashed_bytes_total", "counter", "Bytes transferred, by partition." },
+	{ "heimdall_flash_seconds_total", "counter", "Time spent transferring, by partition." },
+	{ "heimdall_retries_total", "counter", "Packets and file parts sent or received again, by operation." },
+	{ "heimdall_libusb_errors_total", "counter", "Failed libusb calls, by error." },
+	{ "heimdall_last_job_timestamp_seconds", "gauge", "When the last job ended." },
+	{ "heimdall_last_job_success", "gauge", "1 if the last job succeeded, otherwise 0." }
+};
+
+static const double phaseDurationBuckets[] = { 0.1, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0, 120.0, 300.0, 600.0 };
+
+string FlashMetrics::path;
+string FlashMetrics::action;
+
+vector<string> FlashMetrics::seriesOrder;
+map<string, double> FlashMetrics::counters;
+map<string, double> FlashMetrics::gauges;
+
+string FlashMetrics::currentPhase;
+long long FlashMetrics::phaseStartTime = 0;
+
+static string formatLabel(const char *name, const string& value)
+{
+	string label = name;
+	label += "=\"";
+
+	for (unsigned int i = 0; i < value.length(); i++)
+	{
+		if (value[i] == '\\' || value[i] == '"')
+			label += '\\';
+
+		if (value[i] == '\n')
+			label += "\\n";
+		else
+			label += value[i];
+	}
+
+	return (label + "\"");
+}
+
+static string formatSeries(const char *name, const string& labels)
+{
+	return ((labels.empty()) ? string(name) : string(name) + "{" + labels + "}");
+}
+
+#ifdef OS_WINDOWS
+typedef HANDLE LockHandle;
+#else
+typedef int LockHandle;
+#endif
+
+// The metrics file itself is replaced rather than rewritten, so the lock is held on a file of its own.
+static bool lockFile(const string& lockPath, LockHandle *lock)
+{
+#ifdef OS_WINDOWS
+	// Opened without sharing, another process holding it is waited on for up to 10 seconds.
+	for (int i = 0; i < 100; i++)
+	{
+		*lock = CreateFileA(lockPath.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+			nullptr);
+
+		if (*lock != INVALID_HANDLE_VALUE)
+			return (true);
+
+		if (GetLastError() != ERROR_SHARING_VIOLATION)
+			return (false);
+
+		Sleep(100);
+	}
+
+	return (false);
+#else
+	*lock = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if (*lock < 0)
+		return (false);
+
+	while (flock(*lock, LOCK_EX) != 0)
+	{
+		if (errno != EINTR)
+		{
+			close(*lock);
+			return (false);
+		}
+	}
+
+	return (true);
+#endif
+}
+
+static void unlockFile(LockHandle lock)
+{
+#ifdef OS_WINDOWS
+	CloseHandle(lock);
+#else
+	close(lock);
+#endif
+}
+
+static bool isFamilySeries(const MetricFamily& family, const string& series)
+{
+	string name = series.substr(0, series.find('{'));
+
+	if (name == family.name)
+		return (true);
+
+	if (strcmp(family.type, "histogram") != 0)
+		return (false);
+
+	return (name == string(family.name) + "_bucket" || name == string(family.name) + "_sum" || name == string(family.name) + "_count");
+}
+
+void FlashMetrics::Start(const char *path, const char *action)
+{
+	FlashMetrics::path = path;
+	FlashMetrics::action = action;
+
+	// Registered after Interface's log writer was constructed, so this runs before the writer is stopped.
+	atexit(Finish);
+}
+
+void FlashMetrics::Finish(void)
+{
+	if (!currentPhase.empty())
+		EndJob(false);
+	else if (!counters.empty())
+		Write();
+}
+
+void FlashMetrics::Add(const string& series, double value)
+{
+	if (counters.find(series) == counters.end())
+		seriesOrder.push_back(series);
+
+	counters[series] += value;
+}
+
+void FlashMetrics::EndPhase(void)
+{
+	if (currentPhase.empty())
+		return;
+
+	double seconds = (HostUsage::GetWallTime() - phaseStartTime) / 1000000.0;
+	string phaseLabel = formatLabel("phase", currentPhase);
+
+	// Every bucket is written, even those that are still zero.
+	for (unsigned int i = 0; i < sizeof(phaseDurationBuckets) / sizeof(phaseDurationBuckets[0]); i++)
+	{
+		char bucket[32];
+		sprintf(bucket, "%g", phaseDurationBuckets[i]);
+
+		Add(formatSeries("heimdall_phase_duration_seconds_bucket", phaseLabel + "," + formatLabel("le", bucket)),
+			(seconds <= phaseDurationBuckets[i]) ? 1.0 : 0.0);
+	}
+
+	Add(formatSeries("heimdall_phase_duration_seconds_bucket", phaseLabel + "," + formatLabel("le", "+Inf")), 1.0);
+	Add(formatSeries("heimdall_phase_duration_seconds_sum", phaseLabel), seconds);
+	Add(formatSeries("heimdall_phase_duration_seconds_count", phaseLabel), 1.0);
+}
+
+void FlashMetrics::BeginPhase(const char *phase)
+{
+	if (!IsEnabled())
+		return;
+
+	EndPhase();
+
+	currentPhase = phase;
+	phaseStartTime = HostUsage::GetWallTime();
+}
+
+void FlashMetrics::CountPartition(const string& partitionName, long long bytes, double seconds)
+{
+	if (!IsEnabled())
+		return;
+
+	string partitionLabel = formatLabel("partition", partitionName);
+
+	Add(formatSeries("heimdall_flashed_bytes_total", partitionLabel), static_cast<double>(bytes));
+	Add(formatSeries("heimdall_flash_seconds_total", partitionLabel), seconds);
+}
+
+void FlashMetrics::CountRetry(const char *operation)
+{
+	if (IsEnabled())
+		Add(formatSeries("heimdall_retries_total", formatLabel("operation", operation)), 1.0);
+}
+
+void FlashMetrics::CountLibusbError(const char *errorName)
+{
+	if (IsEnabled())
+		Add(formatSeries("heimdall_libusb_errors_total", formatLabel("error", errorName)), 1.0);
+}
+
+void FlashMetrics::EndJob(bool success)
+{
+	if (!IsEnabled())
+		return;
+
+	EndPhase();
+
+	string actionLabel = formatLabel("action", action);
+
+	Add(formatSeries("heimdall_sessions_total", actionLabel + "," + formatLabel("result", (success) ? "success" : "failure")), 1.0);
+
+	if (!success)
+	{
+		string phase = (currentPhase.empty()) ? "none" : currentPhase;
+		Add(formatSeries("heimdall_failures_total", actionLabel + "," + formatLabel("phase", phase)), 1.0);
+	}
+
+	gauges["heimdall_last_job_timestamp_seconds"] = static_cast<double>(time(nullptr));
+	gauges["heimdall_last_job_success"] = (success) ? 1.0 : 0.0;
+
+	currentPhase.clear();
+
+	Write();
+}
+
+void FlashMetrics::Load(vector<string>& order, map<string, double>& values)
+{
+	FILE *file = fopen(path.c_str(), "r");
+
+	// Nothing has been written yet.
+	if (!file)
+		return;
+
+	char line[kMaxMetricsLineLength];
+
+	while (fgets(line, sizeof(line), file))
+	{
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		char *separator = strrchr(line, ' ');
+
+		if (!separator)
+			continue;
+
+		char *end;
+		double value = strtod(separator + 1, &end);
+
+		if (end == separator + 1)
+			continue;
+
+		string series(line, separator - line);
+
+		if (values.find(series) == values.end())
+			order.push_back(series);
+
+		values[series] = value;
+	}
+
+	fclose(file);
+}
+
+bool FlashMetrics::Update(void)
+{
+	vector<string> order;
+	map<string, double> values;
+
+	Load(order, values);
+
+	for (unsigned int i = 0; i < seriesOrder.size(); i++)
+	{
+		if (values.find(seriesOrder[i]) == values.end())
+			order.push_back(seriesOrder[i]);
+
+		values[seriesOrder[i]] += counters[seriesOrder[i]];
+	}
+
+	for (map<string, double>::const_iterator it = gauges.begin(); it != gauges.end(); it++)
+	{
+		if (values.find(it->first) == values.end())
+			order.push_back(it->first);
+
+		values[it->first] = it->second;
+	}
+
+	seriesOrder.clear();
+	counters.clear();
+	gauges.clear();
+
+	// Written to a temporary file and moved into place, the collector only reads files ending in .prom.
+	string temporaryPath = path + ".tmp";
+
+	FILE *file = fopen(temporaryPath.c_str(), "w");
+
+	if (!file)
+	{
+		Interface::Print("WARNING: Failed to write metrics \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	bool success = true;
+
+	for (unsigned int i = 0; i < sizeof(metricFamilies) / sizeof(metricFamilies[0]) && success; i++)
+	{
+		bool headerWritten = false;
+
+		for (unsigned int j = 0; j < order.size() && success; j++)
+		{
+			if (!isFamilySeries(metricFamilies[i], order[j]))
+				continue;
+
+			if (!headerWritten)
+			{
+				success = fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", metricFamilies[i].name, metricFamilies[i].help,
+					metricFamilies[i].name, metricFamilies[i].type) > 0;
+				headerWritten = true;
+			}
+
+			success = success && fprintf(file, "%s %.15g\n", order[j].c_str(), values[order[j]]) > 0;
+		}
+	}
+
+	success = fclose(file) == 0 && success;
+
+#ifdef OS_WINDOWS
+	if (success)
+		remove(path.c_str());
+#endif
+
+	if (!success || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		Interface::Print("WARNING: Failed to write metrics \"%s\"\n", path.c_str());
+		remove(temporaryPath.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+bool FlashMetrics::Write(void)
+{
+	if (!IsEnabled())
+		return (false);
+
+	// Stations sharing a file would otherwise lose each other's counts between reading it back and replacing it.
+	LockHandle lock;
+	bool locked = lockFile(path + ".lock", &lock);
+
+	if (!locked)
+		Interface::Print("WARNING: Failed to lock metrics \"%s\", writing them anyway\n", path.c_str());
+
+	bool success = Update();
+
+	if (locked)
+		unlockFile(lock);
+
+	return (success);
+}
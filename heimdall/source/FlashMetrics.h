@@ -0,0 +1,87 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef FLASHMETRICS_H
+#define FLASHMETRICS_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Heimdall
+{
+	// Counters and histograms for unattended flashing stations, written in the Prometheus text format for the node
+	// exporter's textfile collector. The file is read back and added to whenever it's written, so counters keep counting
+	// across runs. It's written when each job ends, after each device of a batch, and when the program exits without
+	// ending its job, which then counts as failed in whatever phase it was in. Nothing is recorded without --metrics.
+	class FlashMetrics
+	{
+		private:
+
+			static std::string path;
+			static std::string action;
+
+			// Added to the file's values when it's written, then cleared.
+			static std::vector<std::string> seriesOrder;
+			static std::map<std::string, double> counters;
+
+			// Replace the file's values.
+			static std::map<std::string, double> gauges;
+
+			static std::string currentPhase;
+			static long long phaseStartTime;
+
+			static void Add(const std::string& series, double value);
+			static void EndPhase(void);
+			static void Load(std::vector<std::string>& order, std::map<std::string, double>& values);
+			static bool Update(void);
+
+			static void Finish(void);
+
+		public:
+
+			// Enables metrics, written to path. action labels the jobs counted.
+			static void Start(const char *path, const char *action);
+
+			static bool IsEnabled(void)
+			{
+				return (!path.empty());
+			}
+
+			// Ends the phase in progress, if any, and observes how long it took.
+			static void BeginPhase(const char *phase);
+
+			static void CountPartition(const std::string& partitionName, long long bytes, double seconds);
+			static void CountRetry(const char *operation);
+			static void CountLibusbError(const char *errorName);
+
+			// Counts the job, failures by the phase they happened in, and writes the file.
+			static void EndJob(bool success);
+
+			// Atomically replaces the file with its previous values plus everything recorded since the last write. Other
+			// processes writing the same file are kept out by an advisory lock on a ".lock" file beside it.
+			static bool Write(void);
+	};
+}
+
+#endif
@@ -30,6 +30,11 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<FileTransferPacket::kDataSize, unsigned short> UnknownField;
+			typedef libpit::WireField<UnknownField::kEnd, unsigned int> TransferCountField;
+
+			WIRE_STATIC_ASSERT(TransferCountField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned short unknown;
 			unsigned int transferCount;
 
@@ -56,8 +61,8 @@ namespace Heimdall
 			{
 				FileTransferPacket::Pack();
 
-				PackShort(FileTransferPacket::kDataSize, unknown);
-				PackInteger(FileTransferPacket::kDataSize + 2, transferCount);
+				PackField<UnknownField>(unknown);
+				PackField<TransferCountField>(transferCount);
 			}
 	};
 }
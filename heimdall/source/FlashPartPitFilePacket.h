@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<PitFilePacket::kDataSize, unsigned int> PartSizeField;
+
+			WIRE_STATIC_ASSERT(PartSizeField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int partSize;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 			{
 				PitFilePacket::Pack();
 
-				PackInteger(PitFilePacket::kDataSize, partSize);
+				PackField<PartSizeField>(partSize);
 			}
 	};
 }
@@ -0,0 +1,267 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "FlashMetrics.h"
+#include "FlashProgress.h"
+#include "Heimdall.h"
+#include "HostUsage.h"
+#include "Interface.h"
+#include "JsonEvent.h"
+
+using namespace std;
+using namespace Heimdall;
+
+// Weight of each new throughput sample. Samples are a quarter of a second apart, so the average mostly reflects the last
+// couple of seconds.
+static const double kThroughputSmoothing = 0.3;
+
+static double toMebibytes(double bytes)
+{
+	return (bytes / (1024.0 * 1024.0));
+}
+
+static const char *formatDuration(long long seconds, char *buffer)
+{
+	// buffer must hold at least 32 characters.
+	if (seconds >= 3600)
+		sprintf(buffer, "%lld:%02lld:%02lld", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+	else
+		sprintf(buffer, "%lld:%02lld", seconds / 60, seconds % 60);
+
+	return (buffer);
+}
+
+FlashProgress::FlashProgress(long long totalBytes, bool verbose)
+{
+	this->totalBytes = totalBytes;
+	this->verbose = verbose;
+
+	completedBytes = 0;
+
+	partitionStartTime = HostUsage::GetWallTime();
+
+	sampleTime = partitionStartTime;
+	sampleBytes = 0;
+
+	throughput = -1.0;
+
+	printTime = 0;
+	linePrinted = false;
+}
+
+void FlashProgress::PrintProgress(long long now)
+{
+	const PartitionProgress& partition = partitions.back();
+
+	int percent = (partition.size > 0) ? static_cast<int>(100 * partition.bytesTransferred / partition.size) : 100;
+
+	long long overallBytes = completedBytes + partition.bytesTransferred;
+	int overallPercent = (totalBytes > 0) ? static_cast<int>(100 * overallBytes / totalBytes) : 100;
+
+	if (overallPercent > 100)
+		overallPercent = 100;
+
+	JsonEvent event("progress");
+	event.Add("partition", partition.name);
+	event.Add("bytes", partition.bytesTransferred);
+	event.Add("size", partition.size);
+	event.Add("total_bytes", overallBytes);
+	event.Add("total_size", totalBytes);
+
+	char line[160];
+	int length = sprintf(line, "%3d%%", percent);
+
+	if (throughput >= 0.0)
+	{
+		length += sprintf(line + length, "  %.1f MiB/s", toMebibytes(throughput));
+		event.Add("rate", throughput);
+
+		if (throughput > 0.0 && totalBytes > overallBytes)
+		{
+			long long eta = static_cast<long long>((totalBytes - overallBytes) / throughput);
+			event.Add("eta", eta);
+
+			char etaText[32];
+			length += sprintf(line + length, "  total %d%%, ETA %s", overallPercent, formatDuration(eta, etaText));
+		}
+		else
+		{
+			length += sprintf(line + length, "  total %d%%", overallPercent);
+		}
+	}
+
+	// The line is rewritten in place, it's padded so nothing is left over from a longer one.
+	const char *format = (verbose) ? "%s\n" : "\r%-60s";
+
+	// Only the partition's last line has to get out, the others may be dropped rather than hold up the transfer.
+	bool lastLine = partition.bytesTransferred >= partition.size;
+
+	if (lastLine)
+		Interface::Print(format, line);
+	else
+		Interface::PrintProgress(format, line);
+
+	event.Emit(!lastLine);
+
+	printTime = now;
+	linePrinted = true;
+}
+
+void FlashProgress::BeginPartition(const char *partitionName, long long plannedSize, long long transferSize)
+{
+	PartitionProgress partition;
+	partition.name = partitionName;
+	partition.size = transferSize;
+	partition.bytesTransferred = 0;
+	partition.elapsedTime = 0;
+	partition.result = kResultInProgress;
+
+	partitions.push_back(partition);
+
+	totalBytes += transferSize - plannedSize;
+
+	partitionStartTime = HostUsage::GetWallTime();
+	sampleTime = partitionStartTime;
+	sampleBytes = 0;
+
+	JsonEvent event("partition_start");
+	event.Add("partition", partition.name);
+	event.Add("size", transferSize);
+	event.Emit();
+
+	PrintProgress(partitionStartTime);
+}
+
+void FlashProgress::Update(long long bytesTransferred)
+{
+	PartitionProgress& partition = partitions.back();
+	partition.bytesTransferred = bytesTransferred;
+
+	long long now = HostUsage::GetWallTime();
+
+	// Throughput carries over from the previous partition, only the sample restarts.
+	if (now - sampleTime >= kSampleInterval)
+	{
+		double sample = (bytesTransferred - sampleBytes) * 1000000.0 / (now - sampleTime);
+		throughput = (throughput < 0.0) ? sample : kThroughputSmoothing * sample + (1.0 - kThroughputSmoothing) * throughput;
+
+		sampleTime = now;
+		sampleBytes = bytesTransferred;
+	}
+
+	if (now - printTime >= kPrintInterval || bytesTransferred == partition.size)
+		PrintProgress(now);
+}
+
+void FlashProgress::EndPartition(bool success)
+{
+	PartitionProgress& partition = partitions.back();
+	partition.elapsedTime = HostUsage::GetWallTime() - partitionStartTime;
+	partition.result = (success) ? kResultFlashed : kResultFailed;
+
+	completedBytes += partition.size;
+
+	if (linePrinted && !verbose)
+		Interface::Print("\n");
+
+	linePrinted = false;
+
+	JsonEvent event("partition_end");
+	event.Add("partition", partition.name);
+	event.Add("result", (success) ? "flashed" : "failed");
+	event.Add("bytes", partition.bytesTransferred);
+	event.Add("seconds", partition.elapsedTime / 1000000.0);
+
+	if (partition.elapsedTime > 0)
+		event.Add("rate", partition.bytesTransferred * 1000000.0 / partition.elapsedTime);
+
+	event.Emit();
+
+	FlashMetrics::CountPartition(partition.name, partition.bytesTransferred, partition.elapsedTime / 1000000.0);
+}
+
+void FlashProgress::SkipPartition(const char *partitionName, long long plannedSize)
+{
+	PartitionProgress partition;
+	partition.name = partitionName;
+	partition.size = plannedSize;
+	partition.bytesTransferred = 0;
+	partition.elapsedTime = 0;
+	partition.result = kResultSkipped;
+
+	partitions.push_back(partition);
+
+	completedBytes += plannedSize;
+
+	JsonEvent event("partition_end");
+	event.Add("partition", partition.name);
+	event.Add("result", "skipped");
+	event.Add("bytes", 0LL);
+	event.Emit();
+}
+
+void FlashProgress::PrintSummary(void) const
+{
+	if (partitions.empty())
+		return;
+
+	Interface::Print("\n%-32s %12s %10s %10s\n", "Partition", "MiB", "Seconds", "MiB/s");
+
+	long long transferredBytes = 0;
+	long long transferTime = 0;
+
+	for (unsigned int i = 0; i < partitions.size(); i++)
+	{
+		const PartitionProgress& partition = partitions[i];
+
+		if (partition.result == kResultSkipped)
+		{
+			Interface::Print("%-32s %12.1f %10s %10s\n", partition.name.c_str(), toMebibytes(partition.size), "-", "skipped");
+			continue;
+		}
+
+		double seconds = partition.elapsedTime / 1000000.0;
+
+		if (partition.result == kResultFlashed && seconds > 0.0)
+		{
+			Interface::Print("%-32s %12.1f %10.2f %10.1f\n", partition.name.c_str(), toMebibytes(partition.size), seconds,
+				toMebibytes(partition.size) / seconds);
+		}
+		else
+		{
+			Interface::Print("%-32s %12.1f %10.2f %10s\n", partition.name.c_str(), toMebibytes(partition.bytesTransferred), seconds,
+				(partition.result == kResultFlashed) ? "-" : "failed");
+		}
+
+		transferredBytes += partition.bytesTransferred;
+		transferTime += partition.elapsedTime;
+	}
+
+	double transferSeconds = transferTime / 1000000.0;
+
+	Interface::Print("%-32s %12.1f %10.2f %10.1f\n\n", "Total", toMebibytes(transferredBytes), transferSeconds,
+		(transferSeconds > 0.0) ? toMebibytes(transferredBytes) / transferSeconds : 0.0);
+}
@@ -0,0 +1,103 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef FLASHPROGRESS_H
+#define FLASHPROGRESS_H
+
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
+namespace Heimdall
+{
+	// Tracks the bytes transferred to each partition and across the whole flash. Throughput is a moving average so the
+	// ETA follows the device rather than the start of the flash, and a summary of every partition's rate is printed at
+	// the end. A slow station or cable shows up as one partition, or every partition, well below the others.
+	class FlashProgress
+	{
+		private:
+
+			enum
+			{
+				kResultInProgress = 0,
+				kResultFlashed,
+				kResultSkipped,
+				kResultFailed
+			};
+
+			enum
+			{
+				// Microseconds between throughput samples and between progress lines.
+				kSampleInterval = 250000,
+				kPrintInterval = 500000
+			};
+
+			struct PartitionProgress
+			{
+				std::string name;
+				long long size;
+				long long bytesTransferred;
+				long long elapsedTime;
+				int result;
+			};
+
+			bool verbose;
+
+			long long totalBytes;
+
+			// Bytes of every partition before the current one, whether flashed or skipped.
+			long long completedBytes;
+
+			std::vector<PartitionProgress> partitions;
+
+			long long partitionStartTime;
+
+			long long sampleTime;
+			long long sampleBytes;
+
+			// Bytes per second, negative until the first sample has been taken.
+			double throughput;
+
+			long long printTime;
+			bool linePrinted;
+
+			void PrintProgress(long long now);
+
+			FlashProgress(const FlashProgress&);
+			FlashProgress& operator=(const FlashProgress&);
+
+		public:
+
+			FlashProgress(long long totalBytes, bool verbose);
+
+			// transferSize differs from plannedSize when a sparse image is expanded as it's sent.
+			void BeginPartition(const char *partitionName, long long plannedSize, long long transferSize);
+			void Update(long long bytesTransferred);
+			void EndPartition(bool success);
+
+			void SkipPartition(const char *partitionName, long long plannedSize);
+
+			void PrintSummary(void) const;
+	};
+}
+
+#endif
@@ -0,0 +1,183 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// C/C++ Standard Library
+#include <new>
+
+// Heimdall
+#include "Heimdall.h"
+#include "HostUsage.h"
+
+#ifndef OS_WINDOWS
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+using namespace Heimdall;
+
+#ifdef HEIMDALL_COUNT_ALLOCATIONS
+
+// Replacing the global operators affects every action, so they're only built in to measure the benchmark action.
+#ifdef OS_WINDOWS
+static volatile LONGLONG allocationTotal = 0;
+#else
+static long long allocationTotal = 0;
+
+// Statically initialised rather than a Mutex, allocations are made before static constructors and after destructors run.
+static pthread_mutex_t allocationMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static long long getAllocationTotal(void)
+{
+#ifdef OS_WINDOWS
+	return (InterlockedCompareExchange64(&allocationTotal, 0, 0));
+#else
+	pthread_mutex_lock(&allocationMutex);
+	long long total = allocationTotal;
+	pthread_mutex_unlock(&allocationMutex);
+
+	return (total);
+#endif
+}
+
+// Every allocation made with new is counted, nothing else changes.
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+#ifdef OS_WINDOWS
+	InterlockedIncrement64(&allocationTotal);
+#else
+	pthread_mutex_lock(&allocationMutex);
+	allocationTotal++;
+	pthread_mutex_unlock(&allocationMutex);
+#endif
+
+	void *memory = malloc((size > 0) ? size : 1);
+
+	if (!memory)
+		throw std::bad_alloc();
+
+	return (memory);
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc)
+{
+	return (operator new(size));
+}
+
+void operator delete(void *memory) throw()
+{
+	free(memory);
+}
+
+void operator delete[](void *memory) throw()
+{
+	free(memory);
+}
+
+#endif // HEIMDALL_COUNT_ALLOCATIONS
+
+#ifdef OS_WINDOWS
+
+static long long fileTimeToMicroseconds(const FILETIME& fileTime)
+{
+	ULARGE_INTEGER value;
+	value.LowPart = fileTime.dwLowDateTime;
+	value.HighPart = fileTime.dwHighDateTime;
+
+	// FILETIME counts 100 nanosecond intervals.
+	return (static_cast<long long>(value.QuadPart / 10));
+}
+
+#endif
+
+long long HostUsage::GetWallTime(void)
+{
+#ifdef OS_WINDOWS
+	return (static_cast<long long>(GetTickCount()) * 1000);
+#else
+	timeval now;
+	gettimeofday(&now, nullptr);
+
+	return (static_cast<long long>(now.tv_sec) * 1000000 + now.tv_usec);
+#endif
+}
+
+void HostUsage::Capture(void)
+{
+#ifdef HEIMDALL_COUNT_ALLOCATIONS
+	allocationCount = getAllocationTotal();
+#else
+	allocationCount = -1;
+#endif
+
+	readCalls = -1;
+	writeCalls = -1;
+
+	wallTime = GetWallTime();
+
+#ifdef OS_WINDOWS
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+
+	if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		cpuTime = fileTimeToMicroseconds(kernelTime) + fileTimeToMicroseconds(userTime);
+	else
+		cpuTime = -1;
+#else
+	rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+		cpuTime = static_cast<long long>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+			+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	}
+	else
+	{
+		cpuTime = -1;
+	}
+#endif
+
+#ifdef OS_LINUX
+	FILE *io = fopen("/proc/self/io", "r");
+
+	if (io)
+	{
+		char name[32];
+		long long value;
+
+		while (fscanf(io, "%31s %lld", name, &value) == 2)
+		{
+			if (strcmp(name, "syscr:") == 0)
+				readCalls = value;
+			else if (strcmp(name, "syscw:") == 0)
+				writeCalls = value;
+		}
+
+		fclose(io);
+	}
+#endif
+}
@@ -0,0 +1,51 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef HOSTUSAGE_H
+#define HOSTUSAGE_H
+
+namespace Heimdall
+{
+	// Snapshot of the resources the process has used so far, the difference between two is what happened in between.
+	// Anything the platform can't report is -1.
+	struct HostUsage
+	{
+		// Microseconds, the wall time is only meaningful relative to another snapshot.
+		long long wallTime;
+		long long cpuTime;
+
+		// Allocations made with new since the process started. They're only counted when built with
+		// HEIMDALL_COUNT_ALLOCATIONS defined (./configure CPPFLAGS=-DHEIMDALL_COUNT_ALLOCATIONS), otherwise this is -1.
+		long long allocationCount;
+
+		// Read and write system calls, Linux only.
+		long long readCalls;
+		long long writeCalls;
+
+		void Capture(void);
+
+		// Microseconds from an arbitrary starting point.
+		static long long GetWallTime(void);
+	};
+}
+
+#endif
@@ -0,0 +1,172 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "FileSource.h"
+#include "Heimdall.h"
+#include "ImageHasher.h"
+
+using namespace std;
+using namespace Heimdall;
+
+ImageHasher::ImageHasher(int algorithms)
+{
+	this->algorithms = algorithms;
+
+	threadCount = 0;
+	nextImage = 0;
+}
+
+ImageHasher::~ImageHasher()
+{
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads[i].Join();
+}
+
+void ImageHasher::Add(FILE *file, const string& path, const string& name, long long offset, long long size)
+{
+	Image image;
+
+	image.file = file;
+	image.path = path;
+	image.name = name;
+	image.offset = offset;
+	image.size = size;
+	image.hashed = false;
+	memset(image.md5Digest, 0, Md5::kDigestSize);
+	memset(image.sha256Digest, 0, Sha256::kDigestSize);
+
+	images.push_back(image);
+}
+
+void ImageHasher::Hash(Image& image, unsigned char *buffer) const
+{
+	FILE *file = fopen(image.path.c_str(), "rb");
+
+	if (!file)
+		return;
+
+	FileRegionSource source(file, image.offset, image.size);
+
+	Md5 md5;
+	Sha256 sha256;
+
+	long long remaining = image.size;
+
+	while (remaining > 0)
+	{
+		unsigned int readSize = (remaining < kBufferSize) ? static_cast<unsigned int>(remaining)
+			: static_cast<unsigned int>(kBufferSize);
+
+		if (source.Read(buffer, readSize) != readSize)
+			break;
+
+		if (algorithms & kAlgorithmMd5)
+			md5.Update(buffer, readSize);
+
+		if (algorithms & kAlgorithmSha256)
+			sha256.Update(buffer, readSize);
+
+		remaining -= readSize;
+	}
+
+	fclose(file);
+
+	if (remaining == 0)
+	{
+		md5.Finish(image.md5Digest);
+		sha256.Finish(image.sha256Digest);
+
+		image.hashed = true;
+	}
+}
+
+void ImageHasher::Work(void *hasher)
+{
+	ImageHasher *self = static_cast<ImageHasher *>(hasher);
+	unsigned char *buffer = new unsigned char[kBufferSize];
+
+	while (true)
+	{
+		self->mutex.Lock();
+		unsigned int imageIndex = self->nextImage;
+
+		if (imageIndex < self->images.size())
+			self->nextImage++;
+
+		self->mutex.Unlock();
+
+		if (imageIndex >= self->images.size())
+			break;
+
+		// Each image is only ever touched by the worker that claimed it.
+		self->Hash(self->images[imageIndex], buffer);
+	}
+
+	delete [] buffer;
+}
+
+void ImageHasher::Start(void)
+{
+	unsigned int wantedThreadCount = (images.size() < kMaxThreadCount) ? images.size() : static_cast<unsigned int>(kMaxThreadCount);
+
+	// If a thread can't be started its share of the work is picked up by the others, or by Wait().
+	for (threadCount = 0; threadCount < wantedThreadCount; threadCount++)
+	{
+		if (!threads[threadCount].Start(Work, this))
+			break;
+	}
+}
+
+void ImageHasher::Wait(void)
+{
+	Work(this);
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads[i].Join();
+
+	threadCount = 0;
+}
+
+int ImageHasher::FindImage(FILE *file, long long offset) const
+{
+	for (unsigned int i = 0; i < images.size(); i++)
+	{
+		if (images[i].file == file && images[i].offset == offset)
+			return (i);
+	}
+
+	return (-1);
+}
+
+const unsigned char *ImageHasher::GetMd5Digest(unsigned int index) const
+{
+	return ((images[index].hashed && (algorithms & kAlgorithmMd5)) ? images[index].md5Digest : nullptr);
+}
+
+const unsigned char *ImageHasher::GetSha256Digest(unsigned int index) const
+{
+	return ((images[index].hashed && (algorithms & kAlgorithmSha256)) ? images[index].sha256Digest : nullptr);
+}
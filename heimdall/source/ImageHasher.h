@@ -0,0 +1,130 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef IMAGEHASHER_H
+#define IMAGEHASHER_H
+
+// C Standard Library
+#include <stdio.h>
+
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "Md5.h"
+#include "Sha256.h"
+#include "Thread.h"
+
+namespace Heimdall
+{
+	// Hashes images on a small pool of worker threads so the work overlaps with initialising the device and session setup.
+	// Each worker opens the image by path, the FILE the image was opened with is only used to look the result up
+	// afterwards. Every requested algorithm is computed in the same pass over the image.
+	class ImageHasher
+	{
+		public:
+
+			enum
+			{
+				kMaxThreadCount = 4,
+				kBufferSize = 1024 * 1024
+			};
+
+			// Algorithms, may be combined.
+			enum
+			{
+				kAlgorithmMd5 = 1,
+				kAlgorithmSha256 = 2
+			};
+
+		private:
+
+			struct Image
+			{
+				FILE *file;
+				std::string path;
+				std::string name;
+
+				long long offset;
+				long long size;
+
+				bool hashed;
+				unsigned char md5Digest[Md5::kDigestSize];
+				unsigned char sha256Digest[Sha256::kDigestSize];
+			};
+
+			int algorithms;
+			std::vector<Image> images;
+
+			Thread threads[kMaxThreadCount];
+			unsigned int threadCount;
+
+			Mutex mutex;
+			unsigned int nextImage;
+
+			static void Work(void *hasher);
+			void Hash(Image& image, unsigned char *buffer) const;
+
+			ImageHasher(const ImageHasher&);
+			ImageHasher& operator=(const ImageHasher&);
+
+		public:
+
+			ImageHasher(int algorithms);
+			~ImageHasher();
+
+			int GetAlgorithms(void) const
+			{
+				return (algorithms);
+			}
+
+			// Images must all be added before Start(). name is how the image is known in manifests.
+			void Add(FILE *file, const std::string& path, const std::string& name, long long offset, long long size);
+
+			void Start(void);
+
+			// Blocks until every image has been hashed, hashing whatever the workers haven't got to on this thread.
+			void Wait(void);
+
+			// Everything below is only valid after Wait().
+
+			// Returns the index of the image, or -1 if it wasn't added.
+			int FindImage(FILE *file, long long offset) const;
+
+			const std::string& GetImageName(unsigned int index) const
+			{
+				return (images[index].name);
+			}
+
+			bool IsImageHashed(unsigned int index) const
+			{
+				return (images[index].hashed);
+			}
+
+			// nullptr if the algorithm wasn't requested or the image couldn't be read.
+			const unsigned char *GetMd5Digest(unsigned int index) const;
+			const unsigned char *GetSha256Digest(unsigned int index) const;
+	};
+}
+
+#endif
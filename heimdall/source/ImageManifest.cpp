@@ -0,0 +1,166 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+// Heimdall
+#include "Digest.h"
+#include "Heimdall.h"
+#include "ImageHasher.h"
+#include "ImageManifest.h"
+#include "Interface.h"
+
+using namespace std;
+using namespace Heimdall;
+
+enum
+{
+	kMaxManifestLineLength = 1024
+};
+
+ImageManifest::ImageManifest()
+{
+	algorithms = 0;
+}
+
+string ImageManifest::GetKey(const string& filename)
+{
+	string::size_type separator = filename.find_last_of("/\\");
+	string key = (separator == string::npos) ? filename : filename.substr(separator + 1);
+
+	for (unsigned int i = 0; i < key.length(); i++)
+		key[i] = tolower(static_cast<unsigned char>(key[i]));
+
+	return (key);
+}
+
+bool ImageManifest::ParseEntry(const char *digest, unsigned int digestLength, ManifestEntry *entry)
+{
+	if (digestLength == Md5::kDigestSize * 2)
+		entry->algorithm = ImageHasher::kAlgorithmMd5;
+	else if (digestLength == Sha256::kDigestSize * 2)
+		entry->algorithm = ImageHasher::kAlgorithmSha256;
+	else
+		return (false);
+
+	return (Digest::Parse(digest, digestLength / 2, entry->digest));
+}
+
+bool ImageManifest::Load(const char *path)
+{
+	FILE *file = fopen(path, "r");
+
+	if (!file)
+	{
+		Interface::PrintError("Failed to open manifest \"%s\"\n", path);
+		return (false);
+	}
+
+	char line[kMaxManifestLineLength];
+	int lineNumber = 0;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNumber++;
+
+		// Strip the line ending and skip blank lines and comments.
+		unsigned int length = strlen(line);
+
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+
+		if (length == 0 || line[0] == '#')
+			continue;
+
+		unsigned int digestLength = 0;
+
+		while (isxdigit(static_cast<unsigned char>(line[digestLength])))
+			digestLength++;
+
+		ManifestEntry entry;
+
+		if (!ParseEntry(line, digestLength, &entry))
+		{
+			Interface::PrintError("Unrecognised digest on line %d of manifest \"%s\"\n", lineNumber, path);
+			fclose(file);
+			return (false);
+		}
+
+		// The digest is followed by whitespace and, from md5sum -b, a '*' marking binary mode.
+		const char *filename = line + digestLength;
+
+		while (*filename == ' ' || *filename == '\t')
+			filename++;
+
+		if (*filename == '*')
+			filename++;
+
+		if (filename == line + digestLength || *filename == '\0')
+		{
+			Interface::PrintError("Missing filename on line %d of manifest \"%s\"\n", lineNumber, path);
+			fclose(file);
+			return (false);
+		}
+
+		entries[GetKey(filename)] = entry;
+		algorithms |= entry.algorithm;
+	}
+
+	fclose(file);
+
+	if (entries.empty())
+	{
+		Interface::PrintError("Manifest \"%s\" doesn't list any images\n", path);
+		return (false);
+	}
+
+	return (true);
+}
+
+bool ImageManifest::Add(const string& digest, const string& filename)
+{
+	ManifestEntry entry;
+
+	if (!ParseEntry(digest.c_str(), digest.length(), &entry))
+		return (false);
+
+	entries[GetKey(filename)] = entry;
+	algorithms |= entry.algorithm;
+
+	return (true);
+}
+
+int ImageManifest::Check(const string& filename, const unsigned char *md5Digest, const unsigned char *sha256Digest) const
+{
+	map<string, ManifestEntry>::const_iterator it = entries.find(GetKey(filename));
+
+	if (it == entries.end())
+		return (kCheckNotListed);
+
+	if (it->second.algorithm == ImageHasher::kAlgorithmMd5)
+		return ((md5Digest && memcmp(md5Digest, it->second.digest, Md5::kDigestSize) == 0) ? kCheckMatched : kCheckMismatched);
+	else
+		return ((sha256Digest && memcmp(sha256Digest, it->second.digest, Sha256::kDigestSize) == 0) ? kCheckMatched : kCheckMismatched);
+}
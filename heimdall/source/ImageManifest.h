@@ -0,0 +1,87 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef IMAGEMANIFEST_H
+#define IMAGEMANIFEST_H
+
+// C/C++ Standard Library
+#include <map>
+#include <string>
+
+// Heimdall
+#include "Md5.h"
+#include "Sha256.h"
+
+namespace Heimdall
+{
+	// Expected digests of images, read from md5sum or sha256sum output ("<digest>  <filename>" per line, the two may be
+	// mixed). Filenames are matched without their directory and ignoring case.
+	class ImageManifest
+	{
+		public:
+
+			// Check() results
+			enum
+			{
+				kCheckMatched = 0,
+				kCheckMismatched,
+				kCheckNotListed
+			};
+
+		private:
+
+			struct ManifestEntry
+			{
+				// ImageHasher::kAlgorithmMd5 or ImageHasher::kAlgorithmSha256
+				int algorithm;
+				unsigned char digest[Sha256::kDigestSize];
+			};
+
+			std::map<std::string, ManifestEntry> entries;
+			int algorithms;
+
+			static std::string GetKey(const std::string& filename);
+
+			// Sets the algorithm from the digest's length, returns false if it's neither MD5 nor SHA-256.
+			static bool ParseEntry(const char *digest, unsigned int digestLength, ManifestEntry *entry);
+
+		public:
+
+			ImageManifest();
+
+			bool Load(const char *path);
+
+			// Lists a single image, for digests that don't come from a manifest file.
+			bool Add(const std::string& digest, const std::string& filename);
+
+			// The ImageHasher algorithms needed to check images against this manifest.
+			int GetAlgorithms(void) const
+			{
+				return (algorithms);
+			}
+
+			// Digests of algorithms the manifest doesn't use may be nullptr.
+			int Check(const std::string& filename, const unsigned char *md5Digest, const unsigned char *sha256Digest) const;
+	};
+}
+
+#endif
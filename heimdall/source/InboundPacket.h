@@ -21,6 +21,9 @@
 #ifndef INBOUNDPACKET_H
 #define INBOUNDPACKET_H
 
+// libpit
+#include "WireFormat.h"
+
 // Heimdall
 #include "Packet.h"
 
@@ -35,17 +38,11 @@ namespace Heimdall
 
 		protected:
 
-			unsigned int UnpackInteger(unsigned int offset) const
+			// Field is a libpit::WireField describing where and how the value is stored.
+			template <typename Field>
+			typename Field::ValueType UnpackField(void) const
 			{
-#ifdef WORDS_BIGENDIAN
-				unsigned int value = (data[offset] << 24) | (data[offset + 1] << 16) |
-					(data[offset + 2] << 8) | data[offset + 3];
-#else
-				// Flip endianness
-				unsigned int value = data[offset] | (data[offset + 1] << 8) |
-					(data[offset + 2] << 16) | (data[offset + 3] << 24);
-#endif
-				return (value);
+				return (Field::Unpack(data));
 			}
 
 		public:
@@ -22,23 +22,50 @@
 #include <cstdarg>
 #include <cstdlib>
 #include <stdio.h>
+#include <string.h>
 
 // Heimdall
+#include "FlashMetrics.h"
 #include "Heimdall.h"
+#include "HostUsage.h"
 #include "Interface.h"
+#include "JsonEvent.h"
+#include "LogWriter.h"
+
+#ifdef OS_WINDOWS
+#define vsnprintf _vsnprintf
+
+// va_list is a plain pointer with MSVC.
+#ifndef va_copy
+#define va_copy(destination, source) ((destination) = (source))
+#endif
+#endif
 
 using namespace std;
 using namespace libpit;
 using namespace Heimdall;
 
 bool Interface::stdoutErrors = false;
+bool Interface::jsonOutput = false;
+long long Interface::startTime = HostUsage::GetWallTime();
+
+// Output goes through here once it's started, it's stopped and drained when the program exits.
+static LogWriter logWriter;
 
 const char *Interface::version = "v1.3.1";
 
 const char *Interface::usage = "Usage: heimdall <action> <action arguments> <common arguments>\n\
 \n\
 Common Arguments:\n\
-    [--verbose] [--no-reboot] [--stdout-errors] [--delay <ms>]\n\
+    [--verbose] [--no-reboot] [--stdout-errors] [--json] [--delay <ms>]\n\
+    [--metrics <filename>]\n\
+NOTE: --json writes an object per line to stdout for every event: phase\n\
+      changes, partitions starting and ending, progress (at most twice a\n\
+      second) and errors. Everything else is printed to stderr.\n\
+NOTE: --metrics keeps counters of jobs, failures by phase, phase durations,\n\
+      bytes flashed per partition, retries and libusb errors in a file for\n\
+      the Prometheus node exporter's textfile collector (name it *.prom). It's\n\
+      added to and atomically replaced as each job, or batch device, ends.\n\
 \n\
 \n\
 Action: flash\n\
@@ -50,6 +77,8 @@ Arguments:\n\
     [--user-data <filename>] [--fota <filename>] [--hidden <filename>]\n\
     [--movinand <filename>] [--data <filename>] [--ums <filename>]\n\
     [--emmc <filename>] [--<partition identifier> <filename>]\n\
+    [--package <filename>] [--manifest <filename>]\n\
+    [--size <argument>=<bytes>[,...]]\n\
   or:\n\
     [--factoryfs <filename>] [--cache <filename>] [--dbdata <filename>]\n\
     [--primary-boot <filename>] [--secondary-boot <filename>]\n\
@@ -59,9 +88,64 @@ Arguments:\n\
     [--user-data <filename>] [--fota <filename>] [--hidden <filename>]\n\
     [--movinand <filename>] [--data <filename>] [--ums <filename>]\n\
     [--emmc <filename>] [--<partition identifier> <filename>]\n\
+    [--package <filename>] [--manifest <filename>] [--refresh-pit]\n\
+    [--skip-size-check] [--expand-sparse] [--skip-unchanged] [--resume]\n\
+    [--size <argument>=<bytes>[,...]]\n\
 Description: Flashes firmware files to your phone.\n\
 WARNING: If you're repartitioning it's strongly recommended you specify\n\
          all files at your disposal, including bootloaders.\n\
+NOTE: The device's PIT file is cached per device (by VID/PID, device type and\n\
+      serial number). It's still downloaded in full and checked against the\n\
+      cached copy unless the HEIMDALL_PIT_CACHE_QUICK_CHECK environment\n\
+      variable is set to 1, in which case only the first part is compared\n\
+      and the rest of the download is skipped if it matches. That's quicker\n\
+      but untested on devices and misses changes to later entries. Specify\n\
+      --refresh-pit to ignore the cache. The cache location can be\n\
+      overridden with the HEIMDALL_PIT_CACHE environment variable.\n\
+NOTE: Before anything is transferred each file is checked against the size of\n\
+      its partition (block size x block count) and the flash plan is printed.\n\
+      When a PIT file is specified this happens before the session begins.\n\
+      Specify --skip-size-check to flash files regardless of their size.\n\
+NOTE: --package flashes an Odin .tar or .tar.md5 without extracting it. Each\n\
+      file in the package is flashed to the partition whose PIT filename\n\
+      matches. The MD5 of a .tar.md5 is verified while flashing and boot\n\
+      partitions are only flashed once it has been verified.\n\
+NOTE: Android sparse images are sent as they are by default, which suits\n\
+      bootloaders that expand them (those that flash Odin packages). For\n\
+      older bootloaders specify --expand-sparse, images are then expanded as\n\
+      they're sent without needing space on disk.\n\
+NOTE: Heimdall keeps a ledger of the images it last flashed to each device.\n\
+      Specify --skip-unchanged to skip partitions whose image matches the\n\
+      ledger, images are hashed while the session is set up. Only specify it\n\
+      if Heimdall is the only tool flashing the device. The ledger location\n\
+      can be overridden with the HEIMDALL_FLASH_LEDGER environment variable.\n\
+NOTE: --manifest takes md5sum or sha256sum output listing the images. Every\n\
+      image is hashed while the device is initialised and the flash is\n\
+      aborted before anything is written if one doesn't match.\n\
+NOTE: A file of - is read from stdin, named pipes can be given too. Their\n\
+      sizes must be declared up front, e.g. --size system=1073741824,21=4096.\n\
+      They're read once as their partition is flashed, so they can't be hashed\n\
+      and are always sent as they are.\n\
+NOTE: Progress is journalled per device as each sequence is confirmed. If a\n\
+      flash is interrupted, run it again with --resume to skip partitions\n\
+      that were completely flashed from the same (unmodified) files. Images\n\
+      are identified by MD5, so they're hashed when --resume is given, and\n\
+      only partitions whose MD5 was journalled can be skipped, i.e. those\n\
+      flashed with --resume (harmless on a fresh flash) or --skip-unchanged.\n\
+      The partition that was interrupted is flashed again from the start.\n\
+\n\
+Action: batch\n\
+Arguments: --job <filename>\n\
+Description: Flashes the same images to each device listed in a job file, one\n\
+    after another. Every image is opened, and checked against its digest,\n\
+    before any device is touched. A job file has one entry per line:\n\
+        device <bus>:<port>\n\
+        pit <filename>\n\
+        image <partition name or identifier> <filename> [<md5 or sha256>]\n\
+        option <repartition | refresh-pit | skip-size-check | expand-sparse |\n\
+                skip-unchanged | resume | no-reboot>\n\
+NOTE: detect --verbose lists the bus and port of every device found. A job\n\
+      without devices flashes the first device found.\n\
 \n\
 Action: close-pc-screen\n\
 Description: Attempts to get rid off the \"connect phone to PC\" screen.\n\
@@ -70,6 +154,9 @@ Action: download-pit\n\
 Arguments: --output <filename>\n\
 Description: Downloads the connected device's PIT file to the specified\n\
     output file.\n\
+NOTE: PIT file parts are requested one at a time. Setting the\n\
+      HEIMDALL_PIT_PIPELINE_DEPTH environment variable (up to 16) requests\n\
+      that many parts ahead, which is quicker but untested on most devices.\n\
 \n\
 Action: detect\n\
 Description: Indicates whether or not a download mode device can be detected.\n\
@@ -84,6 +171,18 @@ Action: print-pit\n\
 Description: Dumps the PIT file from the connected device and prints it in\n\
     a human readable format.\n\
 \n\
+Action: benchmark\n\
+Arguments: [--images <bytes>[,...]] [--part-size <bytes>]\n\
+    [--sequence-length <parts>] [--latency <microseconds>]\n\
+Description: Flashes generated images to a simulated device and reports the\n\
+    throughput, CPU time, allocations and system calls of the host side.\n\
+    No device is needed. Sizes may end in K, M or G, the default is a\n\
+    single 256M image sent in 131072 byte parts, 800 parts per sequence.\n\
+NOTE: Devices only accept the default part size and sequence length, the\n\
+      options are only for exploring the cost of the transfer loop.\n\
+NOTE: Allocations are only reported when built with HEIMDALL_COUNT_ALLOCATIONS\n\
+      defined.\n\
+\n\
 Action: version\n\
 Description: Displays the version number of this binary.\n\
 \n\
@@ -105,20 +204,20 @@ libusb-1.0 is licensed under the LGPL-2.1:\n\
 // Flash arguments
 string Interface::flashValueArguments[kFlashValueArgCount] = {
 	"-pit", "-factoryfs", "-cache", "-dbdata", "-primary-boot",	"-secondary-boot", "-secondary-boot-backup", "-param", "-kernel", "-recovery", "-efs", "-modem",
-	"-normal-boot", "-system", "-user-data", "-fota", "-hidden", "-movinand", "-data", "-ums", "-emmc", "-%d"
+	"-normal-boot", "-system", "-user-data", "-fota", "-hidden", "-movinand", "-data", "-ums", "-emmc", "-%d", "-package", "-manifest", "-size"
 };
 
 string Interface::flashValueShortArguments[kFlashValueArgCount] = {
 	"pit",  "fs",         "cache",  "db",      "boot",           "sbl",            "sbl2",                   "param",  "z",       "rec",       "efs",  "m",
-	"norm",         "sys",     "udata",      "fota",  "hide",    "nand",      "data",  "ums",  "emmc",  "%d"
+	"norm",         "sys",     "udata",      "fota",  "hide",    "nand",      "data",  "ums",  "emmc",  "%d",  "tar",      "mf",        "size"
 };
 
 string Interface::flashValuelessArguments[kFlashValuelessArgCount] = {
-	"-repartition"
+	"-repartition", "-refresh-pit", "-skip-size-check", "-expand-sparse", "-skip-unchanged", "-resume"
 };
 
 string Interface::flashValuelessShortArguments[kFlashValuelessArgCount] = {
-	"r"
+	"r",            "rpit",         "ssc",              "xs",             "su",              "res"
 };
 
 // Download PIT arguments
@@ -139,21 +238,39 @@ string Interface::dumpValueShortArguments[kDumpValueArgCount] = {
 	"type",       "id",       "out"
 };
 
+// Benchmark arguments
+string Interface::benchmarkValueArguments[kBenchmarkValueArgCount] = {
+	"-images", "-part-size", "-sequence-length", "-latency"
+};
+
+string Interface::benchmarkValueShortArguments[kBenchmarkValueArgCount] = {
+	"img",     "ps",         "sl",               "lat"
+};
+
+// Batch arguments
+string Interface::batchValueArguments[kBatchValueArgCount] = {
+	"-job"
+};
+
+string Interface::batchValueShortArguments[kBatchValueArgCount] = {
+	"j"
+};
+
 // Common arguments
 string Interface::commonValueArguments[kCommonValueArgCount] = {
-	"-delay"
+	"-delay", "-metrics"
 };
 
 string Interface::commonValueShortArguments[kCommonValueArgCount] = {
-	"d"
+	"d",      "met"
 };
 
 string Interface::commonValuelessArguments[kCommonValuelessArgCount] = {
-	"-verbose", "-no-reboot", "-stdout-errors"
+	"-verbose", "-no-reboot", "-stdout-errors", "-json"
 };
 
 string Interface::commonValuelessShortArguments[kCommonValuelessArgCount] = {
-	"v",        "nobt",       "err"
+	"v",        "nobt",       "err",            "json"
 };
 
 Action Interface::actions[Interface::kActionCount] = {
@@ -191,7 +308,15 @@ Action Interface::actions[Interface::kActionCount] = {
 
 	// kActionInfo
 	Action("info", nullptr, nullptr, kInfoValueArgCount,
-		nullptr, nullptr, kInfoValuelessArgCount)
+		nullptr, nullptr, kInfoValuelessArgCount),
+
+	// kActionBenchmark
+	Action("benchmark", benchmarkValueArguments, benchmarkValueShortArguments, kBenchmarkValueArgCount,
+		nullptr, nullptr, kBenchmarkValuelessArgCount),
+
+	// kActionBatch
+	Action("batch", batchValueArguments, batchValueShortArguments, kBatchValueArgCount,
+		nullptr, nullptr, kBatchValuelessArgCount)
 };
 
 bool Interface::GetArguments(int argc, char **argv, map<string, string>& argumentMap, int *actionIndex)
@@ -350,52 +475,177 @@ bool Interface::GetArguments(int argc, char **argv, map<string, string>& argumen
 	return (true);
 }
 
+// Formats into buffer, or a heap buffer if the message doesn't fit (which the caller must delete). Returns the length.
+static int formatMessage(char *buffer, int bufferSize, char **message, const char *format, va_list args)
+{
+	*message = buffer;
+	int size = bufferSize;
+
+	for (;;)
+	{
+		va_list attemptArgs;
+		va_copy(attemptArgs, args);
+		int length = vsnprintf(*message, size, format, attemptArgs);
+		va_end(attemptArgs);
+
+		if (length >= 0 && length < size)
+			return (length);
+
+		if (*message != buffer)
+			delete [] *message;
+
+		// Windows only says the message didn't fit, not how long it is.
+		size = (length >= 0) ? length + 1 : size * 2;
+		*message = new char[size];
+	}
+}
+
+void Interface::Write(FILE *stream, int level, const char *text, unsigned int length)
+{
+	// Only debug messages show the time.
+	long long time = (level == LogWriter::kLevelDebug) ? HostUsage::GetWallTime() - startTime : 0;
+	logWriter.Write(stream, level, time, text, length);
+}
+
 void Interface::Print(const char *format, ...)
 {
+	char buffer[kMessageBufferSize];
+	char *message;
+
 	va_list args;
 	va_start(args, format);
+	int length = formatMessage(buffer, sizeof(buffer), &message, format, args);
+	va_end(args);
 
-	vfprintf(stdout, format, args);
-	fflush(stdout);
+	Write((jsonOutput) ? stderr : stdout, LogWriter::kLevelInfo, message, length);
 
+	if (message != buffer)
+		delete [] message;
+}
+
+void Interface::PrintDebug(const char *format, ...)
+{
+	char buffer[kMessageBufferSize];
+	char *message;
+
+	va_list args;
+	va_start(args, format);
+	int length = formatMessage(buffer, sizeof(buffer), &message, format, args);
 	va_end(args);
-	
+
+	Write((jsonOutput) ? stderr : stdout, LogWriter::kLevelDebug, message, length);
+
+	if (message != buffer)
+		delete [] message;
+}
+
+void Interface::PrintProgress(const char *format, ...)
+{
+	char buffer[kMessageBufferSize];
+	char *message;
+
+	va_list args;
+	va_start(args, format);
+	int length = formatMessage(buffer, sizeof(buffer), &message, format, args);
+	va_end(args);
+
+	Write((jsonOutput) ? stderr : stdout, LogWriter::kLevelProgress, message, length);
+
+	if (message != buffer)
+		delete [] message;
 }
 
 void Interface::PrintError(const char *format, ...)
 {
+	// Formatted once, it may be written to stderr, stdout and an event.
+	char buffer[kMessageBufferSize];
+	char *message;
+
+	memcpy(buffer, "ERROR: ", 7);
+
 	va_list args;
 	va_start(args, format);
+	int length = formatMessage(buffer + 7, sizeof(buffer) - 7, &message, format, args);
+	va_end(args);
+
+	// The prefix is only in place if the message fitted.
+	if (message == buffer + 7)
+	{
+		Write(stderr, LogWriter::kLevelError, buffer, length + 7);
+	}
+	else
+	{
+		Write(stderr, LogWriter::kLevelError, "ERROR: ", 7);
+		Write(stderr, LogWriter::kLevelError, message, length);
+	}
 
-	fprintf(stderr, "ERROR: ");
-	vfprintf(stderr, format, args);
-	fflush(stderr);
+	if (jsonOutput)
+	{
+		while (length > 0 && message[length - 1] == '\n')
+			length--;
 
-	if (stdoutErrors)
+		JsonEvent event("error");
+		event.Add("message", string(message, length));
+		event.Emit();
+	}
+	else if (stdoutErrors)
 	{
-		fprintf(stdout, "ERROR: ");
-		vfprintf(stdout, format, args);
-		fflush(stdout);
+		Write(stdout, LogWriter::kLevelError, "ERROR: ", 7);
+		Write(stdout, LogWriter::kLevelError, message, length);
 	}
 
-	va_end(args);
+	if (message != buffer + 7)
+		delete [] message;
 }
 
 void Interface::PrintErrorSameLine(const char *format, ...)
 {
+	char buffer[kMessageBufferSize];
+	char *message;
+
 	va_list args;
 	va_start(args, format);
+	int length = formatMessage(buffer, sizeof(buffer), &message, format, args);
+	va_end(args);
 
-	vfprintf(stderr, format, args);
-	fflush(stderr);
+	Write(stderr, LogWriter::kLevelError, message, length);
 
-	if (stdoutErrors)
-	{
-		vfprintf(stdout, format, args);
-		fflush(stdout);
-	}
+	// Only continues an error that's already been reported, so there's no event.
+	if (stdoutErrors && !jsonOutput)
+		Write(stdout, LogWriter::kLevelError, message, length);
 
-	va_end(args);
+	if (message != buffer)
+		delete [] message;
+}
+
+void Interface::PrintEvent(const string& event, bool progress)
+{
+	string line = event + '\n';
+	Write(stdout, (progress) ? LogWriter::kLevelProgress : LogWriter::kLevelInfo, line.c_str(), line.length());
+}
+
+void Interface::StartLogWriter(void)
+{
+	logWriter.Start();
+}
+
+void Interface::FlushLog(void)
+{
+	logWriter.Flush();
+}
+
+void Interface::PrintPhaseEvent(const char *phase)
+{
+	JsonEvent event("phase");
+	event.Add("phase", phase);
+	event.Emit();
+
+	FlashMetrics::BeginPhase(phase);
+}
+
+double Interface::GetElapsedTime(void)
+{
+	return ((HostUsage::GetWallTime() - startTime) / 1000000.0);
 }
 
 void Interface::PrintVersion(void)
@@ -424,57 +674,104 @@ void Interface::PrintDeviceDetectionFailed(void)
 	Print("Failed to detect compatible download-mode device.\n");
 }
 
-void Interface::PrintPit(const PitData *pitData)
+void Interface::PrintPit(const PitView *pitView)
 {
-	Interface::Print("Entry Count: %d\n", pitData->GetEntryCount());
-
-	Interface::Print("Unknown 1: %d\n", pitData->GetUnknown1());
-	Interface::Print("Unknown 2: %d\n", pitData->GetUnknown2());
-	Interface::Print("Unknown 3: %d\n", pitData->GetUnknown3());
-	Interface::Print("Unknown 4: %d\n", pitData->GetUnknown4());
-	Interface::Print("Unknown 5: %d\n", pitData->GetUnknown5());
-	Interface::Print("Unknown 6: %d\n", pitData->GetUnknown6());
-	Interface::Print("Unknown 7: %d\n", pitData->GetUnknown7());
-	Interface::Print("Unknown 8: %d\n", pitData->GetUnknown8());
-
-	for (unsigned int i = 0; i < pitData->GetEntryCount(); i++)
+	Interface::Print("Entry Count: %d\n", pitView->GetEntryCount());
+
+	Interface::Print("Unknown 1: %d\n", pitView->GetUnknown1());
+	Interface::Print("Unknown 2: %d\n", pitView->GetUnknown2());
+	Interface::Print("Unknown 3: %d\n", pitView->GetUnknown3());
+	Interface::Print("Unknown 4: %d\n", pitView->GetUnknown4());
+	Interface::Print("Unknown 5: %d\n", pitView->GetUnknown5());
+	Interface::Print("Unknown 6: %d\n", pitView->GetUnknown6());
+	Interface::Print("Unknown 7: %d\n", pitView->GetUnknown7());
+	Interface::Print("Unknown 8: %d\n", pitView->GetUnknown8());
+
+	for (unsigned int i = 0; i < pitView->GetEntryCount(); i++)
 	{
-		const PitEntry *entry = pitData->GetEntry(i);
+		PitEntryView entry = pitView->GetEntry(i);
 
 		Interface::Print("\n\n--- Entry #%d ---\n", i);
-		Interface::Print("Unused: %s\n", (entry->GetUnused()) ? "Yes" : "No");
+		Interface::Print("Unused: %s\n", (entry.GetUnused()) ? "Yes" : "No");
 
 		const char *partitionTypeText = "Unknown";
 
-		if (entry->GetPartitionType() == PitEntry::kPartitionTypeRfs)
+		if (entry.GetPartitionType() == PitEntry::kPartitionTypeRfs)
 			partitionTypeText = "RFS";
-		else if (entry->GetPartitionType() == PitEntry::kPartitionTypeExt4)
+		else if (entry.GetPartitionType() == PitEntry::kPartitionTypeExt4)
 			partitionTypeText = "EXT4";
 
-		Interface::Print("Partition Type: %d (%s)\n", entry->GetPartitionType(), partitionTypeText);
+		Interface::Print("Partition Type: %d (%s)\n", entry.GetPartitionType(), partitionTypeText);
 
-		Interface::Print("Partition Identifier: %d\n", entry->GetPartitionIdentifier());
+		Interface::Print("Partition Identifier: %d\n", entry.GetPartitionIdentifier());
 
-		Interface::Print("Partition Flags: %d (", entry->GetPartitionFlags());
+		Interface::Print("Partition Flags: %d (", entry.GetPartitionFlags());
 
-		if (entry->GetPartitionFlags() & PitEntry::kPartitionFlagWrite)
+		if (entry.GetPartitionFlags() & PitEntry::kPartitionFlagWrite)
 			Interface::Print("R/W");
 		else
 			Interface::Print("R");
 
 		Interface::Print(")\n");
 
-		Interface::Print("Unknown 1: %d\n", entry->GetUnknown1());
+		Interface::Print("Unknown 1: %d\n", entry.GetUnknown1());
 
-		Interface::Print("Partition Block Size: %d\n", entry->GetPartitionBlockSize());
-		Interface::Print("Partition Block Count: %d\n", entry->GetPartitionBlockCount());
+		Interface::Print("Partition Block Size: %d\n", entry.GetPartitionBlockSize());
+		Interface::Print("Partition Block Count: %d\n", entry.GetPartitionBlockCount());
 
-		Interface::Print("Unknown 2: %d\n", entry->GetUnknown2());
-		Interface::Print("Unknown 3: %d\n", entry->GetUnknown3());
+		Interface::Print("Unknown 2: %d\n", entry.GetUnknown2());
+		Interface::Print("Unknown 3: %d\n", entry.GetUnknown3());
 
-		Interface::Print("Partition Name: %s\n", entry->GetPartitionName());
-		Interface::Print("Filename: %s\n", entry->GetFilename());
+		Interface::Print("Partition Name: %.*s\n", static_cast<int>(entry.GetPartitionNameLength()), entry.GetPartitionName());
+		Interface::Print("Filename: %.*s\n", static_cast<int>(entry.GetFilenameLength()), entry.GetFilename());
 	}
 
 	Interface::Print("\n");
 }
+
+void Interface::PrintPitDiff(const PitDiff *pitDiff, const char *pitName, const char *otherPitName)
+{
+	const PitData *pitData = pitDiff->GetPitData();
+	const PitData *otherPitData = pitDiff->GetOtherPitData();
+
+	for (unsigned int i = 0; i < pitDiff->GetDifferenceCount(); i++)
+	{
+		const PitDifference& difference = pitDiff->GetDifference(i);
+
+		const PitEntry *entry = (difference.GetEntryIndex() >= 0) ? pitData->GetEntry(difference.GetEntryIndex()) : nullptr;
+		const PitEntry *otherEntry = (difference.GetOtherEntryIndex() >= 0)
+			? otherPitData->GetEntry(difference.GetOtherEntryIndex()) : nullptr;
+
+		if (!entry && !otherEntry)
+		{
+			Interface::Print("Header %s: %u (%s) -> %u (%s)\n", PitDiff::GetFieldName(difference.GetField()),
+				difference.GetValue(), pitName, difference.GetOtherValue(), otherPitName);
+			continue;
+		}
+
+		const PitEntry *namedEntry = (entry) ? entry : otherEntry;
+		Interface::Print("Entry \"%s\" (ID %u): ", namedEntry->GetPartitionName(), namedEntry->GetPartitionIdentifier());
+
+		switch (difference.GetField())
+		{
+			case PitDiff::kFieldEntry:
+				Interface::Print("only in %s PIT\n", (entry) ? pitName : otherPitName);
+				break;
+
+			case PitDiff::kFieldPartitionName:
+				Interface::Print("%s: %s (%s) -> %s (%s)\n", PitDiff::GetFieldName(difference.GetField()),
+					entry->GetPartitionName(), pitName, otherEntry->GetPartitionName(), otherPitName);
+				break;
+
+			case PitDiff::kFieldFilename:
+				Interface::Print("%s: %s (%s) -> %s (%s)\n", PitDiff::GetFieldName(difference.GetField()),
+					entry->GetFilename(), pitName, otherEntry->GetFilename(), otherPitName);
+				break;
+
+			default:
+				Interface::Print("%s: %u (%s) -> %u (%s)\n", PitDiff::GetFieldName(difference.GetField()),
+					difference.GetValue(), pitName, difference.GetOtherValue(), otherPitName);
+				break;
+		}
+	}
+}
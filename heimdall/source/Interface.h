@@ -23,6 +23,7 @@
 
 // C/C++ Standard Library
 #include <map>
+#include <stdio.h>
 #include <string>
 
 // libpit
@@ -78,6 +79,8 @@ namespace Heimdall
 				kActionDetect,
 				kActionDownloadPit,
 				kActionInfo,
+				kActionBenchmark,
+				kActionBatch,
 				kActionCount
 			};
 
@@ -108,6 +111,9 @@ namespace Heimdall
 				kFlashValueArgEmmc,
 
 				kFlashValueArgPartitionIndex,
+				kFlashValueArgPackage,
+				kFlashValueArgManifest,
+				kFlashValueArgSize,
 
 				kFlashValueArgCount
 			};
@@ -116,6 +122,11 @@ namespace Heimdall
 			enum
 			{
 				kFlashValuelessArgRepartition = 0,
+				kFlashValuelessArgRefreshPit,
+				kFlashValuelessArgSkipSizeCheck,
+				kFlashValuelessArgExpandSparse,
+				kFlashValuelessArgSkipUnchanged,
+				kFlashValuelessArgResume,
 
 				kFlashValuelessArgCount
 			};
@@ -221,10 +232,42 @@ namespace Heimdall
 				kDownloadPitValuelessArgCount = 0
 			};
 
+			// Benchmark value arguments
+			enum
+			{
+				kBenchmarkValueArgImages = 0,
+				kBenchmarkValueArgPartSize,
+				kBenchmarkValueArgSequenceLength,
+				kBenchmarkValueArgLatency,
+
+				kBenchmarkValueArgCount
+			};
+
+			// Benchmark valueless arguments
+			enum
+			{
+				kBenchmarkValuelessArgCount = 0
+			};
+
+			// Batch value arguments
+			enum
+			{
+				kBatchValueArgJob = 0,
+
+				kBatchValueArgCount
+			};
+
+			// Batch valueless arguments
+			enum
+			{
+				kBatchValuelessArgCount = 0
+			};
+
 			// Common value arguments
 			enum
 			{
 				kCommonValueArgDelay = 0,
+				kCommonValueArgMetrics,
 
 				kCommonValueArgCount
 			};
@@ -235,6 +278,7 @@ namespace Heimdall
 				kCommonValuelessArgVerbose = 0,
 				kCommonValuelessArgNoReboot,
 				kCommonValuelessArgStdoutErrors,
+				kCommonValuelessArgJson,
 
 				kCommonValuelessArgCount
 			};
@@ -242,6 +286,18 @@ namespace Heimdall
 		private:
 
 			static bool stdoutErrors;
+
+			// With --json, stdout only carries events and everything else is printed to stderr.
+			static bool jsonOutput;
+			static long long startTime;
+
+			enum
+			{
+				// Messages are formatted on the stack unless they're longer than this.
+				kMessageBufferSize = 1024
+			};
+
+			static void Write(FILE *stream, int level, const char *text, unsigned int length);
 		
 			static const char *version;
 			static const char *usage;
@@ -263,6 +319,14 @@ namespace Heimdall
 			static string dumpValueArguments[kDumpValueArgCount];
 			static string dumpValueShortArguments[kDumpValueArgCount];
 
+			// Benchmark arguments
+			static string benchmarkValueArguments[kBenchmarkValueArgCount];
+			static string benchmarkValueShortArguments[kBenchmarkValueArgCount];
+
+			// Batch arguments
+			static string batchValueArguments[kBatchValueArgCount];
+			static string batchValueShortArguments[kBatchValueArgCount];
+
 		public:
 
 			// Common arguments
@@ -280,6 +344,17 @@ namespace Heimdall
 			static void PrintError(const char *format, ...);
 			static void PrintErrorSameLine(const char *format, ...);
 
+			// Timestamped, and dropped rather than holding up the caller if output can't keep up. For verbose tracing.
+			static void PrintDebug(const char *format, ...);
+
+			// For output the next progress line supersedes, dropped rather than holding up the transfer if output can't
+			// keep up. The last line of a partition should be printed with Print() so that it's never lost.
+			static void PrintProgress(const char *format, ...);
+
+			// Writes a --json event, see JsonEvent. Progress events may be dropped, as with PrintProgress().
+			static void PrintEvent(const string& event, bool progress = false);
+			static void PrintPhaseEvent(const char *phase);
+
 			static void PrintVersion(void);
 			static void PrintUsage(void);
 			static void PrintReleaseInfo(void);
@@ -287,7 +362,8 @@ namespace Heimdall
 
 			static void PrintDeviceDetectionFailed(void);
 
-			static void PrintPit(const PitData *pitData);
+			static void PrintPit(const PitView *pitView);
+			static void PrintPitDiff(const PitDiff *pitDiff, const char *pitName, const char *otherPitName);
 
 			static string& GetPitArgument(void)
 			{
@@ -298,6 +374,24 @@ namespace Heimdall
 			{
 				stdoutErrors = enabled;
 			}
+
+			static void SetJsonOutput(bool enabled)
+			{
+				jsonOutput = enabled;
+			}
+
+			static bool IsJsonOutput(void)
+			{
+				return (jsonOutput);
+			}
+
+			// Seconds since the program started, events are timestamped with it.
+			static double GetElapsedTime(void);
+
+			// Until the log writer is started output is written directly. Once started, everything is written on a
+			// thread of its own and FlushLog() waits for it to catch up.
+			static void StartLogWriter(void);
+			static void FlushLog(void);
 	};
 }
 
@@ -0,0 +1,152 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Heimdall.h"
+#include "Interface.h"
+#include "JsonEvent.h"
+
+using namespace std;
+using namespace Heimdall;
+
+JsonEvent::JsonEvent(const char *event)
+{
+	enabled = Interface::IsJsonOutput();
+
+	if (!enabled)
+		return;
+
+	line.reserve(128);
+	line = "{\"event\":\"";
+	line += event;
+	line += "\"";
+
+	Add("time", Interface::GetElapsedTime());
+}
+
+void JsonEvent::AddKey(const char *key)
+{
+	line += ",\"";
+	line += key;
+	line += "\":";
+}
+
+void JsonEvent::Add(const char *key, const char *value)
+{
+	if (!enabled)
+		return;
+
+	AddKey(key);
+	line += '"';
+
+	for (const char *character = value; *character != '\0'; character++)
+	{
+		switch (*character)
+		{
+			case '"':
+				line += "\\\"";
+				break;
+
+			case '\\':
+				line += "\\\\";
+				break;
+
+			case '\n':
+				line += "\\n";
+				break;
+
+			case '\r':
+				line += "\\r";
+				break;
+
+			case '\t':
+				line += "\\t";
+				break;
+
+			default:
+				if (static_cast<unsigned char>(*character) < 0x20)
+				{
+					char escaped[8];
+					sprintf(escaped, "\\u%04x", static_cast<unsigned char>(*character));
+					line += escaped;
+				}
+				else
+				{
+					line += *character;
+				}
+
+				break;
+		}
+	}
+
+	line += '"';
+}
+
+void JsonEvent::Add(const char *key, const string& value)
+{
+	Add(key, value.c_str());
+}
+
+void JsonEvent::Add(const char *key, long long value)
+{
+	if (!enabled)
+		return;
+
+	char text[32];
+	sprintf(text, "%lld", value);
+
+	AddKey(key);
+	line += text;
+}
+
+void JsonEvent::Add(const char *key, double value)
+{
+	if (!enabled)
+		return;
+
+	char text[32];
+	sprintf(text, "%.3f", value);
+
+	AddKey(key);
+	line += text;
+}
+
+void JsonEvent::Add(const char *key, bool value)
+{
+	if (!enabled)
+		return;
+
+	AddKey(key);
+	line += (value) ? "true" : "false";
+}
+
+void JsonEvent::Emit(bool progress)
+{
+	if (!enabled)
+		return;
+
+	line += '}';
+	Interface::PrintEvent(line, progress);
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef JSONEVENT_H
+#define JSONEVENT_H
+
+// C/C++ Standard Library
+#include <string>
+
+namespace Heimdall
+{
+	// One line of --json output. Fields are appended in order and the event is written by Emit(). Without --json nothing
+	// is built, so events can be created unconditionally.
+	class JsonEvent
+	{
+		private:
+
+			bool enabled;
+			std::string line;
+
+			void AddKey(const char *key);
+
+		public:
+
+			JsonEvent(const char *event);
+
+			void Add(const char *key, const char *value);
+			void Add(const char *key, const std::string& value);
+			void Add(const char *key, long long value);
+			void Add(const char *key, double value);
+			void Add(const char *key, bool value);
+
+			// Progress events may be dropped if output can't keep up, see Interface::PrintProgress().
+			void Emit(bool progress = false);
+	};
+}
+
+#endif
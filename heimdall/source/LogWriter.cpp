@@ -0,0 +1,201 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "Heimdall.h"
+#include "LogWriter.h"
+
+using namespace Heimdall;
+
+LogWriter::LogWriter() : freeEntries(kEntryCount), usedEntries(0), flushed(0)
+{
+	entries = new Entry[kEntryCount];
+
+	head = 0;
+	tail = 0;
+
+	droppedCount = 0;
+}
+
+LogWriter::~LogWriter()
+{
+	Stop();
+
+	delete [] entries;
+}
+
+void LogWriter::Run(void *logWriter)
+{
+	static_cast<LogWriter *>(logWriter)->WriteEntries();
+}
+
+void LogWriter::WriteEntries(void)
+{
+	for (;;)
+	{
+		// Only flush once there's nothing more to write.
+		if (!usedEntries.TryWait())
+		{
+			fflush(stdout);
+			fflush(stderr);
+
+			usedEntries.Wait();
+		}
+
+		const Entry& entry = entries[tail];
+		tail = (tail + 1) % kEntryCount;
+
+		mutex.Lock();
+		unsigned int dropped = droppedCount;
+		droppedCount = 0;
+		mutex.Unlock();
+
+		if (dropped > 0)
+			fprintf(stderr, "WARNING: %u verbose messages were dropped, output couldn't keep up\n", dropped);
+
+		if (entry.stream)
+		{
+			if (entry.level == kLevelDebug)
+				fprintf(entry.stream, "[%10.3f] ", entry.time / 1000000.0);
+
+			fwrite(entry.text, 1, entry.length, entry.stream);
+		}
+
+		int control = entry.control;
+
+		// The entry may be reused as soon as it's handed back.
+		freeEntries.Post();
+
+		if (control != kControlNone)
+		{
+			fflush(stdout);
+			fflush(stderr);
+
+			if (control == kControlStop)
+				break;
+
+			flushed.Post();
+		}
+	}
+}
+
+bool LogWriter::Enqueue(FILE *stream, int level, int control, long long time, const char *text, unsigned int length)
+{
+	if (level != kLevelDebug && level != kLevelProgress)
+	{
+		freeEntries.Wait();
+	}
+	else if (!freeEntries.TryWait())
+	{
+		if (level == kLevelDebug)
+		{
+			mutex.Lock();
+			droppedCount++;
+			mutex.Unlock();
+		}
+
+		return (false);
+	}
+
+	mutex.Lock();
+
+	Entry& entry = entries[head];
+	head = (head + 1) % kEntryCount;
+
+	entry.stream = stream;
+	entry.level = level;
+	entry.control = control;
+	entry.time = time;
+	entry.length = length;
+
+	if (length > 0)
+		memcpy(entry.text, text, length);
+
+	mutex.Unlock();
+
+	usedEntries.Post();
+
+	return (true);
+}
+
+bool LogWriter::Start(void)
+{
+	return (thread.Start(Run, this));
+}
+
+bool LogWriter::Write(FILE *stream, int level, long long time, const char *text, unsigned int length)
+{
+	if (!thread.IsRunning())
+	{
+		fwrite(text, 1, length, stream);
+		fflush(stream);
+
+		return (true);
+	}
+
+	// Debug messages are a line each and are cut short rather than split, so that they're dropped whole.
+	if (level == kLevelDebug)
+	{
+		unsigned int entryLength = (length < kEntrySize) ? length : static_cast<unsigned int>(kEntrySize);
+		return (Enqueue(stream, level, kControlNone, time, text, entryLength));
+	}
+
+	// Progress lines can't be cut short, one that doesn't fit an entry is written like normal output.
+	if (level == kLevelProgress)
+	{
+		if (length <= kEntrySize)
+			return (Enqueue(stream, level, kControlNone, time, text, length));
+
+		level = kLevelInfo;
+	}
+
+	while (length > kEntrySize)
+	{
+		Enqueue(stream, level, kControlNone, time, text, kEntrySize);
+
+		text += kEntrySize;
+		length -= kEntrySize;
+	}
+
+	return (Enqueue(stream, level, kControlNone, time, text, length));
+}
+
+void LogWriter::Flush(void)
+{
+	if (!thread.IsRunning())
+		return;
+
+	Enqueue(nullptr, kLevelInfo, kControlFlush, 0, nullptr, 0);
+	flushed.Wait();
+}
+
+void LogWriter::Stop(void)
+{
+	if (!thread.IsRunning())
+		return;
+
+	Enqueue(nullptr, kLevelInfo, kControlStop, 0, nullptr, 0);
+	thread.Join();
+}
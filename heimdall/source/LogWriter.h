@@ -0,0 +1,119 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "Thread.h"
+
+namespace Heimdall
+{
+	// Writes output on a thread of its own, so a slow terminal or a full pipe never holds up the transfer. Messages are
+	// copied into a fixed ring of entries and the writer only flushes once it has caught up. Errors and normal output
+	// wait for space, debug messages are dropped instead when the ring is full and the number dropped is reported.
+	// Progress lines are dropped too, silently, as the next one supersedes them.
+	class LogWriter
+	{
+		public:
+
+			enum
+			{
+				kLevelError = 0,
+				kLevelInfo,
+				kLevelDebug,
+				kLevelProgress
+			};
+
+		private:
+
+			enum
+			{
+				kEntryCount = 256,
+				kEntrySize = 496
+			};
+
+			enum
+			{
+				kControlNone = 0,
+				kControlFlush,
+				kControlStop
+			};
+
+			struct Entry
+			{
+				FILE *stream;
+				int level;
+				int control;
+
+				// Microseconds, debug messages are prefixed with it.
+				long long time;
+
+				unsigned int length;
+				char text[kEntrySize];
+			};
+
+			Entry *entries;
+
+			// head is only touched with mutex held, tail only by the writer.
+			unsigned int head;
+			unsigned int tail;
+
+			Mutex mutex;
+			unsigned int droppedCount;
+
+			Semaphore freeEntries;
+			Semaphore usedEntries;
+			Semaphore flushed;
+
+			Thread thread;
+
+			static void Run(void *logWriter);
+			void WriteEntries(void);
+
+			bool Enqueue(FILE *stream, int level, int control, long long time, const char *text, unsigned int length);
+
+			LogWriter(const LogWriter&);
+			LogWriter& operator=(const LogWriter&);
+
+		public:
+
+			LogWriter();
+			~LogWriter();
+
+			bool Start(void);
+
+			// Returns false if a debug message or progress line was dropped.
+			bool Write(FILE *stream, int level, long long time, const char *text, unsigned int length);
+
+			// Returns once everything written so far is out.
+			void Flush(void);
+
+			// Writes what's left and stops the writer.
+			void Stop(void);
+	};
+}
+
+#endif
@@ -0,0 +1,209 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "Md5.h"
+
+using namespace Heimdall;
+
+#define MD5_FF(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define MD5_GG(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+#define MD5_HH(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_II(x, y, z) ((y) ^ ((x) | ~(z)))
+
+#define MD5_STEP(f, a, b, c, d, x, t, s) \
+	(a) += f((b), (c), (d)) + (x) + (t); \
+	(a) = ((a) << (s)) | ((a) >> (32 - (s))); \
+	(a) += (b);
+
+static unsigned int UnpackMd5Integer(const unsigned char *data)
+{
+	return (data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<unsigned int>(data[3]) << 24));
+}
+
+static void PackMd5Integer(unsigned char *data, unsigned int value)
+{
+	data[0] = value & 0x000000FF;
+	data[1] = (value & 0x0000FF00) >> 8;
+	data[2] = (value & 0x00FF0000) >> 16;
+	data[3] = (value & 0xFF000000) >> 24;
+}
+
+Md5::Md5()
+{
+	Reset();
+}
+
+void Md5::Reset(void)
+{
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+
+	length = 0;
+	blockSize = 0;
+}
+
+void Md5::Transform(const unsigned char *data)
+{
+	unsigned int x[16];
+
+	for (int i = 0; i < 16; i++)
+		x[i] = UnpackMd5Integer(data + i * 4);
+
+	unsigned int a = state[0];
+	unsigned int b = state[1];
+	unsigned int c = state[2];
+	unsigned int d = state[3];
+
+	MD5_STEP(MD5_FF, a, b, c, d, x[0], 0xD76AA478, 7)
+	MD5_STEP(MD5_FF, d, a, b, c, x[1], 0xE8C7B756, 12)
+	MD5_STEP(MD5_FF, c, d, a, b, x[2], 0x242070DB, 17)
+	MD5_STEP(MD5_FF, b, c, d, a, x[3], 0xC1BDCEEE, 22)
+	MD5_STEP(MD5_FF, a, b, c, d, x[4], 0xF57C0FAF, 7)
+	MD5_STEP(MD5_FF, d, a, b, c, x[5], 0x4787C62A, 12)
+	MD5_STEP(MD5_FF, c, d, a, b, x[6], 0xA8304613, 17)
+	MD5_STEP(MD5_FF, b, c, d, a, x[7], 0xFD469501, 22)
+	MD5_STEP(MD5_FF, a, b, c, d, x[8], 0x698098D8, 7)
+	MD5_STEP(MD5_FF, d, a, b, c, x[9], 0x8B44F7AF, 12)
+	MD5_STEP(MD5_FF, c, d, a, b, x[10], 0xFFFF5BB1, 17)
+	MD5_STEP(MD5_FF, b, c, d, a, x[11], 0x895CD7BE, 22)
+	MD5_STEP(MD5_FF, a, b, c, d, x[12], 0x6B901122, 7)
+	MD5_STEP(MD5_FF, d, a, b, c, x[13], 0xFD987193, 12)
+	MD5_STEP(MD5_FF, c, d, a, b, x[14], 0xA679438E, 17)
+	MD5_STEP(MD5_FF, b, c, d, a, x[15], 0x49B40821, 22)
+
+	MD5_STEP(MD5_GG, a, b, c, d, x[1], 0xF61E2562, 5)
+	MD5_STEP(MD5_GG, d, a, b, c, x[6], 0xC040B340, 9)
+	MD5_STEP(MD5_GG, c, d, a, b, x[11], 0x265E5A51, 14)
+	MD5_STEP(MD5_GG, b, c, d, a, x[0], 0xE9B6C7AA, 20)
+	MD5_STEP(MD5_GG, a, b, c, d, x[5], 0xD62F105D, 5)
+	MD5_STEP(MD5_GG, d, a, b, c, x[10], 0x02441453, 9)
+	MD5_STEP(MD5_GG, c, d, a, b, x[15], 0xD8A1E681, 14)
+	MD5_STEP(MD5_GG, b, c, d, a, x[4], 0xE7D3FBC8, 20)
+	MD5_STEP(MD5_GG, a, b, c, d, x[9], 0x21E1CDE6, 5)
+	MD5_STEP(MD5_GG, d, a, b, c, x[14], 0xC33707D6, 9)
+	MD5_STEP(MD5_GG, c, d, a, b, x[3], 0xF4D50D87, 14)
+	MD5_STEP(MD5_GG, b, c, d, a, x[8], 0x455A14ED, 20)
+	MD5_STEP(MD5_GG, a, b, c, d, x[13], 0xA9E3E905, 5)
+	MD5_STEP(MD5_GG, d, a, b, c, x[2], 0xFCEFA3F8, 9)
+	MD5_STEP(MD5_GG, c, d, a, b, x[7], 0x676F02D9, 14)
+	MD5_STEP(MD5_GG, b, c, d, a, x[12], 0x8D2A4C8A, 20)
+
+	MD5_STEP(MD5_HH, a, b, c, d, x[5], 0xFFFA3942, 4)
+	MD5_STEP(MD5_HH, d, a, b, c, x[8], 0x8771F681, 11)
+	MD5_STEP(MD5_HH, c, d, a, b, x[11], 0x6D9D6122, 16)
+	MD5_STEP(MD5_HH, b, c, d, a, x[14], 0xFDE5380C, 23)
+	MD5_STEP(MD5_HH, a, b, c, d, x[1], 0xA4BEEA44, 4)
+	MD5_STEP(MD5_HH, d, a, b, c, x[4], 0x4BDECFA9, 11)
+	MD5_STEP(MD5_HH, c, d, a, b, x[7], 0xF6BB4B60, 16)
+	MD5_STEP(MD5_HH, b, c, d, a, x[10], 0xBEBFBC70, 23)
+	MD5_STEP(MD5_HH, a, b, c, d, x[13], 0x289B7EC6, 4)
+	MD5_STEP(MD5_HH, d, a, b, c, x[0], 0xEAA127FA, 11)
+	MD5_STEP(MD5_HH, c, d, a, b, x[3], 0xD4EF3085, 16)
+	MD5_STEP(MD5_HH, b, c, d, a, x[6], 0x04881D05, 23)
+	MD5_STEP(MD5_HH, a, b, c, d, x[9], 0xD9D4D039, 4)
+	MD5_STEP(MD5_HH, d, a, b, c, x[12], 0xE6DB99E5, 11)
+	MD5_STEP(MD5_HH, c, d, a, b, x[15], 0x1FA27CF8, 16)
+	MD5_STEP(MD5_HH, b, c, d, a, x[2], 0xC4AC5665, 23)
+
+	MD5_STEP(MD5_II, a, b, c, d, x[0], 0xF4292244, 6)
+	MD5_STEP(MD5_II, d, a, b, c, x[7], 0x432AFF97, 10)
+	MD5_STEP(MD5_II, c, d, a, b, x[14], 0xAB9423A7, 15)
+	MD5_STEP(MD5_II, b, c, d, a, x[5], 0xFC93A039, 21)
+	MD5_STEP(MD5_II, a, b, c, d, x[12], 0x655B59C3, 6)
+	MD5_STEP(MD5_II, d, a, b, c, x[3], 0x8F0CCC92, 10)
+	MD5_STEP(MD5_II, c, d, a, b, x[10], 0xFFEFF47D, 15)
+	MD5_STEP(MD5_II, b, c, d, a, x[1], 0x85845DD1, 21)
+	MD5_STEP(MD5_II, a, b, c, d, x[8], 0x6FA87E4F, 6)
+	MD5_STEP(MD5_II, d, a, b, c, x[15], 0xFE2CE6E0, 10)
+	MD5_STEP(MD5_II, c, d, a, b, x[6], 0xA3014314, 15)
+	MD5_STEP(MD5_II, b, c, d, a, x[13], 0x4E0811A1, 21)
+	MD5_STEP(MD5_II, a, b, c, d, x[4], 0xF7537E82, 6)
+	MD5_STEP(MD5_II, d, a, b, c, x[11], 0xBD3AF235, 10)
+	MD5_STEP(MD5_II, c, d, a, b, x[2], 0x2AD7D2BB, 15)
+	MD5_STEP(MD5_II, b, c, d, a, x[9], 0xEB86D391, 21)
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+void Md5::Update(const unsigned char *data, unsigned int size)
+{
+	length += size;
+
+	// Top up a partially filled block first, then transform whole blocks straight from data.
+	if (blockSize > 0)
+	{
+		unsigned int copySize = (size < kBlockSize - blockSize) ? size : kBlockSize - blockSize;
+		memcpy(block + blockSize, data, copySize);
+
+		blockSize += copySize;
+		data += copySize;
+		size -= copySize;
+
+		if (blockSize < kBlockSize)
+			return;
+
+		Transform(block);
+		blockSize = 0;
+	}
+
+	while (size >= kBlockSize)
+	{
+		Transform(data);
+
+		data += kBlockSize;
+		size -= kBlockSize;
+	}
+
+	memcpy(block, data, size);
+	blockSize = size;
+}
+
+void Md5::Finish(unsigned char *digest)
+{
+	unsigned long long bitLength = length * 8;
+
+	// Pad with a single 1 bit, then zeros up to 56 bytes into the block, then the 64-bit little endian message length.
+	unsigned char padding[kBlockSize * 2];
+	memset(padding, 0, sizeof(padding));
+	padding[0] = 0x80;
+
+	unsigned int paddingSize = (blockSize < 56) ? 56 - blockSize : 120 - blockSize;
+
+	PackMd5Integer(padding + paddingSize, static_cast<unsigned int>(bitLength));
+	PackMd5Integer(padding + paddingSize + 4, static_cast<unsigned int>(bitLength >> 32));
+
+	Update(padding, paddingSize + 8);
+
+	for (int i = 0; i < 4; i++)
+		PackMd5Integer(digest + i * 4, state[i]);
+
+	Reset();
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef MD5_H
+#define MD5_H
+
+namespace Heimdall
+{
+	// MD5 as described in RFC 1321. Only used to verify the checksums Odin appends to .tar.md5 packages.
+	class Md5
+	{
+		public:
+
+			enum
+			{
+				kDigestSize = 16,
+				kBlockSize = 64
+			};
+
+		private:
+
+			unsigned int state[4];
+			unsigned long long length;
+
+			unsigned char block[kBlockSize];
+			unsigned int blockSize;
+
+			void Transform(const unsigned char *data);
+
+		public:
+
+			Md5();
+
+			void Reset(void);
+			void Update(const unsigned char *data, unsigned int size);
+			void Finish(unsigned char *digest);
+	};
+}
+
+#endif
@@ -21,6 +21,12 @@
 #ifndef OUTBOUNDPACKET_H
 #define OUTBOUNDPACKET_H
 
+// C/C++ Standard Library
+#include <vector>
+
+// libpit
+#include "WireFormat.h"
+
 // Heimdall
 #include "Packet.h"
 
@@ -30,32 +36,11 @@ namespace Heimdall
 	{
 		protected:
 
-			void PackInteger(unsigned int offset, unsigned int value)
+			// Field is a libpit::WireField describing where and how the value is stored.
+			template <typename Field>
+			void PackField(typename Field::ValueType value)
 			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF000000) >> 24;
-				data[offset + 1] = (value & 0x00FF0000) >> 16;
-				data[offset + 2] = (value & 0x0000FF00) >> 8;
-				data[offset + 3] = value & 0x000000FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x000000FF;
-				data[offset + 1] = (value & 0x0000FF00) >> 8;
-				data[offset + 2] = (value & 0x00FF0000) >> 16;
-				data[offset + 3] = (value & 0xFF000000) >> 24;
-#endif
-			}
-
-			void PackShort(unsigned int offset, unsigned short value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF00) >> 8;
-				data[offset + 1] = value & 0x00FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x00FF;
-				data[offset + 1] = (value & 0xFF00) >> 8;
-#endif
+				Field::Pack(data, value);
 			}
 
 		public:
@@ -65,6 +50,19 @@ namespace Heimdall
 			}
 
 			virtual void Pack(void) = 0;
+
+			// The bytes handed to the transport. Most packets are contiguous and simply return their own data, packets
+			// made up of several segments may need to coalesce them into staging, which is grown as necessary and reused
+			// between sends.
+			virtual const unsigned char *GetTransferData(std::vector<unsigned char>& /*staging*/)
+			{
+				return (data);
+			}
+
+			virtual unsigned int GetTransferSize(void) const
+			{
+				return (GetSize());
+			}
 	};
 }
 
@@ -28,9 +28,23 @@ namespace Heimdall
 {
 	class Packet
 	{
+		public:
+
+			enum
+			{
+				// Packets no larger than this are stored inline, so control packets and responses can live on the
+				// stack without touching the heap. Only file part payloads are allocated.
+				kInlineCapacity = 1024
+			};
+
 		private:
 
 			unsigned int size;
+			unsigned char inlineData[kInlineCapacity];
+
+			// data may point into the packet itself, so packets can't be copied.
+			Packet(const Packet&);
+			Packet& operator=(const Packet&);
 
 		protected:
 
@@ -41,13 +55,14 @@ namespace Heimdall
 			Packet(unsigned int size)
 			{
 				this->size = size;
-				data = new unsigned char[size];
+				data = (size <= kInlineCapacity) ? inlineData : new unsigned char[size];
 				memset(data, 0, size);
 			}
 
 			~Packet()
 			{
-				delete [] data;
+				if (data != inlineData)
+					delete [] data;
 			}
 
 			int GetSize(void) const
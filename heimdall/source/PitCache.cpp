@@ -0,0 +1,259 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OS_WINDOWS
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+// Heimdall
+#include "BridgeManager.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "PitCache.h"
+
+using namespace std;
+using namespace Heimdall;
+
+static void PackCacheInteger(unsigned char *data, unsigned int offset, unsigned int value)
+{
+	data[offset] = value & 0x000000FF;
+	data[offset + 1] = (value & 0x0000FF00) >> 8;
+	data[offset + 2] = (value & 0x00FF0000) >> 16;
+	data[offset + 3] = (value & 0xFF000000) >> 24;
+}
+
+static unsigned int UnpackCacheInteger(const unsigned char *data, unsigned int offset)
+{
+	return (data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | (data[offset + 3] << 24));
+}
+
+PitCache::PitCache(const BridgeManager *bridgeManager)
+{
+	const char *overrideDirectory = getenv("HEIMDALL_PIT_CACHE");
+
+	if (overrideDirectory && *overrideDirectory)
+		directory = overrideDirectory;
+	else
+		directory = GetCacheDirectory("pit");
+
+	key = GetDeviceKey(bridgeManager);
+}
+
+string PitCache::GetCacheDirectory(const char *name)
+{
+#ifdef OS_WINDOWS
+	const char *appData = getenv("APPDATA");
+
+	if (appData && *appData)
+		return (string(appData) + "\\Heimdall\\" + name);
+#else
+	const char *cacheHome = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+
+	if (cacheHome && *cacheHome)
+		return (string(cacheHome) + "/heimdall/" + name);
+	else if (home && *home)
+		return (string(home) + "/.cache/heimdall/" + name);
+#endif
+
+	return ("");
+}
+
+string PitCache::GetDeviceKey(const BridgeManager *bridgeManager)
+{
+	const string& serialNumber = bridgeManager->GetSerialNumber();
+
+	if (serialNumber.empty() || bridgeManager->GetDeviceType() < 0)
+		return ("");
+
+	char identity[64];
+	sprintf(identity, "%04X-%04X-%04X-%d-", bridgeManager->GetVendorId() & 0xFFFF, bridgeManager->GetProductId() & 0xFFFF,
+		bridgeManager->GetDeviceRevision() & 0xFFFF, bridgeManager->GetDeviceType());
+
+	string key = identity;
+
+	// Serial numbers are reported by the device, only keep characters that are safe in a filename.
+	for (unsigned int i = 0; i < serialNumber.length(); i++)
+	{
+		char c = serialNumber[i];
+
+		if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' || c == '_')
+			key += c;
+		else
+			key += '_';
+	}
+
+	return (key);
+}
+
+bool PitCache::MakeDirectory(const string& directory)
+{
+	// Create each component of the path in turn, ignoring those which already exist.
+	for (string::size_type position = 1; position <= directory.length(); position++)
+	{
+		if (position != directory.length() && directory[position] != '/' && directory[position] != '\\')
+			continue;
+
+		string component = directory.substr(0, position);
+
+#ifdef OS_WINDOWS
+		int result = _mkdir(component.c_str());
+#else
+		int result = mkdir(component.c_str(), 0755);
+#endif
+
+		if (result != 0 && errno != EEXIST)
+			return (false);
+	}
+
+	return (true);
+}
+
+string PitCache::GetEntryPath(void) const
+{
+#ifdef OS_WINDOWS
+	return (directory + "\\" + key + ".pit");
+#else
+	return (directory + "/" + key + ".pit");
+#endif
+}
+
+unsigned int PitCache::Fingerprint(const unsigned char *data, unsigned int size)
+{
+	// FNV-1a, it only needs to catch truncated or corrupted cache entries.
+	unsigned int hash = 2166136261U;
+
+	for (unsigned int i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619U;
+	}
+
+	return (hash);
+}
+
+int PitCache::Load(unsigned char **pitBuffer) const
+{
+	*pitBuffer = nullptr;
+
+	if (!IsAvailable())
+		return (0);
+
+	FILE *file = fopen(GetEntryPath().c_str(), "rb");
+
+	if (!file)
+		return (0);
+
+	unsigned char header[kHeaderSize];
+
+	if (fread(header, 1, kHeaderSize, file) != kHeaderSize || UnpackCacheInteger(header, 0) != kMagic)
+	{
+		fclose(file);
+		return (0);
+	}
+
+	unsigned int pitSize = UnpackCacheInteger(header, 4);
+	unsigned int fingerprint = UnpackCacheInteger(header, 8);
+
+	if (pitSize == 0 || pitSize > kMaxPitFileSize)
+	{
+		fclose(file);
+		return (0);
+	}
+
+	unsigned char *buffer = new unsigned char[pitSize];
+	size_t bytesRead = fread(buffer, 1, pitSize, file);
+	fclose(file);
+
+	if (bytesRead != pitSize || Fingerprint(buffer, pitSize) != fingerprint)
+	{
+		Interface::Print("Discarding corrupt cached PIT file for device %s\n", key.c_str());
+
+		delete [] buffer;
+		Invalidate();
+		return (0);
+	}
+
+	*pitBuffer = buffer;
+	return (pitSize);
+}
+
+bool PitCache::Store(const unsigned char *pitBuffer, int pitSize) const
+{
+	if (!IsAvailable() || pitSize <= 0 || pitSize > kMaxPitFileSize)
+		return (false);
+
+	if (!MakeDirectory(directory))
+	{
+		Interface::Print("WARNING: Failed to create PIT cache directory \"%s\"\n", directory.c_str());
+		return (false);
+	}
+
+	unsigned char header[kHeaderSize];
+	PackCacheInteger(header, 0, kMagic);
+	PackCacheInteger(header, 4, pitSize);
+	PackCacheInteger(header, 8, Fingerprint(pitBuffer, pitSize));
+
+	// Write to a temporary file and move it into place so an interrupted write never leaves a partial entry behind.
+	string path = GetEntryPath();
+	string temporaryPath = path + ".tmp";
+
+	FILE *file = fopen(temporaryPath.c_str(), "wb");
+
+	if (!file)
+	{
+		Interface::Print("WARNING: Failed to write PIT cache entry \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	bool success = fwrite(header, 1, kHeaderSize, file) == kHeaderSize && fwrite(pitBuffer, 1, pitSize, file) == static_cast<size_t>(pitSize);
+	success = fclose(file) == 0 && success;
+
+#ifdef OS_WINDOWS
+	if (success)
+		remove(path.c_str());
+#endif
+
+	if (!success || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		Interface::Print("WARNING: Failed to write PIT cache entry \"%s\"\n", path.c_str());
+		remove(temporaryPath.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+void PitCache::Invalidate(void) const
+{
+	if (IsAvailable())
+		remove(GetEntryPath().c_str());
+}
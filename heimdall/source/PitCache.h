@@ -0,0 +1,87 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef PITCACHE_H
+#define PITCACHE_H
+
+// C/C++ Standard Library
+#include <string>
+
+namespace Heimdall
+{
+	class BridgeManager;
+
+	// On-disk cache of device PIT files. Entries are keyed by the identity of the device (VID, PID, device revision,
+	// device type and serial number), so repeat flashes of the same unit don't need to download the PIT again.
+	class PitCache
+	{
+		public:
+
+			enum
+			{
+				kMagic = 0x48504954, // "HPIT"
+				kHeaderSize = 12,
+				kMaxPitFileSize = 1024 * 1024
+			};
+
+		private:
+
+			std::string directory;
+			std::string key;
+
+			std::string GetEntryPath(void) const;
+
+			static unsigned int Fingerprint(const unsigned char *data, unsigned int size);
+
+		public:
+
+			PitCache(const BridgeManager *bridgeManager);
+
+			// Per user cache directory for the named kind of entry, empty if there's nowhere suitable.
+			static std::string GetCacheDirectory(const char *name);
+
+			// Identity of the device (see above) as used to name entries, empty if the device can't be told apart from others.
+			static std::string GetDeviceKey(const BridgeManager *bridgeManager);
+
+			// Creates directory along with any missing parents.
+			static bool MakeDirectory(const std::string& directory);
+
+			// Devices without a serial number can't be told apart reliably, so their PITs are never cached.
+			bool IsAvailable(void) const
+			{
+				return (!key.empty() && !directory.empty());
+			}
+
+			const std::string& GetKey(void) const
+			{
+				return (key);
+			}
+
+			// Returns the size of the cached PIT and allocates *pitBuffer, or returns 0 if there is no valid entry.
+			int Load(unsigned char **pitBuffer) const;
+
+			bool Store(const unsigned char *pitBuffer, int pitSize) const;
+			void Invalidate(void) const;
+	};
+}
+
+#endif
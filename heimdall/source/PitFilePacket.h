@@ -40,9 +40,11 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::WireField<ControlPacket::kDataSize, unsigned int> RequestField;
+
 			enum
 			{
-				kDataSize = ControlPacket::kDataSize + 4
+				kDataSize = RequestField::kEnd
 			};
 
 		private:
@@ -65,7 +67,7 @@ namespace Heimdall
 			{
 				ControlPacket::Pack();
 
-				PackInteger(ControlPacket::kDataSize, request);
+				PackField<RequestField>(request);
 			}
 	};
 }
@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<ResponsePacket::kDataSize, unsigned int> FileSizeField;
+
+			WIRE_STATIC_ASSERT(FileSizeField::kEnd <= static_cast<unsigned int>(ResponsePacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int fileSize;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				fileSize = UnpackInteger(ResponsePacket::kDataSize);
+				fileSize = UnpackField<FileSizeField>();
 
 				return (true);
 			}
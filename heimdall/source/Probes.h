@@ -0,0 +1,60 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT probes on the protocol's hot path, so a live flash can be traced with bpftrace or perf without rebuilding in
+// verbose mode. They're only built with HEIMDALL_USDT defined (./configure CPPFLAGS=-DHEIMDALL_USDT), which needs
+// sys/sdt.h from SystemTap. Each probe is a single nop until a tracer attaches to it, e.g.
+//
+//   bpftrace -e 'usdt:/usr/bin/heimdall:heimdall:send_packet_end { @[arg2] = count(); }'
+//
+// Probes (arguments):
+//   send_packet_begin (size)                       send_packet_end (size, transferred, libusb result)
+//   receive_packet_begin (size)                    receive_packet_end (size, received, libusb result)
+//   bulk_in_complete (received, libusb status)     GT-P7510 builds only
+//   file_sequence_begin (file, sequence, parts)    file_sequence_end (file, sequence, bytes sent so far)
+//   reset_interface_step (step name)               reset_interface_done ()
+//
+// Arguments are always evaluated, so only pass values that are already at hand.
+
+#ifdef HEIMDALL_USDT
+
+// C Standard Library
+#include <sys/sdt.h>
+
+#define HEIMDALL_PROBE0(name) DTRACE_PROBE(heimdall, name)
+#define HEIMDALL_PROBE1(name, arg1) DTRACE_PROBE1(heimdall, name, arg1)
+#define HEIMDALL_PROBE2(name, arg1, arg2) DTRACE_PROBE2(heimdall, name, arg1, arg2)
+#define HEIMDALL_PROBE3(name, arg1, arg2, arg3) DTRACE_PROBE3(heimdall, name, arg1, arg2, arg3)
+
+#else
+
+#define HEIMDALL_PROBE0(name)
+#define HEIMDALL_PROBE1(name, arg1)
+#define HEIMDALL_PROBE2(name, arg1, arg2)
+#define HEIMDALL_PROBE3(name, arg1, arg2, arg3)
+
+#endif
+
+#endif
@@ -35,6 +35,8 @@ namespace Heimdall
 				kDataSize = 500
 			};
 
+			WIRE_STATIC_ASSERT(kDataSize <= static_cast<unsigned int>(Packet::kInlineCapacity), ReceiveFilePartPacketIsInline);
+
 			ReceiveFilePartPacket() : InboundPacket(kDataSize, true)
 			{
 			}
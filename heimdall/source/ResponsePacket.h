@@ -45,14 +45,19 @@ namespace Heimdall
 
 		protected:
 
+			typedef libpit::WireField<0, unsigned int> ResponseTypeField;
+
 			enum
 			{
-				kDataSize = 4
+				kPacketSize = 8,
+				kDataSize = ResponseTypeField::kEnd
 			};
 
+			WIRE_STATIC_ASSERT(kPacketSize <= static_cast<unsigned int>(Packet::kInlineCapacity), ResponsePacketIsInline);
+
 		public:
 
-			ResponsePacket(int responseType) : InboundPacket(8)
+			ResponsePacket(int responseType) : InboundPacket(kPacketSize)
 			{
 				this->responseType = responseType;
 			}
@@ -64,9 +69,7 @@ namespace Heimdall
 
 			virtual bool Unpack(void)
 			{
-				const unsigned char *data = GetData();
-
-				unsigned int receivedResponseType = UnpackInteger(0);
+				unsigned int receivedResponseType = UnpackField<ResponseTypeField>();
 				if (receivedResponseType != responseType)
 				{
 					responseType = receivedResponseType;
@@ -0,0 +1,124 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef SEGMENTEDPACKET_H
+#define SEGMENTEDPACKET_H
+
+// Heimdall
+#include "Heimdall.h"
+#include "OutboundPacket.h"
+
+namespace Heimdall
+{
+	// An outbound packet made up of segments, the packet's own (header) bytes followed by spans of borrowed memory and
+	// runs of zero padding. Borrowed memory belongs to the caller and must outlive the send. A packet consisting of a
+	// single borrowed span is sent straight from the caller's memory, anything else is coalesced with one copy.
+	class SegmentedPacket : public OutboundPacket
+	{
+		public:
+
+			enum
+			{
+				kMaxSegmentCount = 4
+			};
+
+		private:
+
+			// data is nullptr for padding.
+			const unsigned char *segmentData[kMaxSegmentCount];
+			unsigned int segmentSizes[kMaxSegmentCount];
+
+			unsigned int segmentCount;
+			unsigned int transferSize;
+
+		protected:
+
+			SegmentedPacket(unsigned int headerSize) : OutboundPacket(headerSize)
+			{
+				segmentCount = 0;
+				transferSize = headerSize;
+			}
+
+			bool AddSegment(const unsigned char *data, unsigned int size)
+			{
+				if (segmentCount == kMaxSegmentCount)
+					return (false);
+
+				if (size == 0)
+					return (true);
+
+				segmentData[segmentCount] = data;
+				segmentSizes[segmentCount] = size;
+				segmentCount++;
+
+				transferSize += size;
+
+				return (true);
+			}
+
+			bool AddPadding(unsigned int size)
+			{
+				return (AddSegment(nullptr, size));
+			}
+
+			void ClearSegments(void)
+			{
+				segmentCount = 0;
+				transferSize = GetSize();
+			}
+
+		public:
+
+			const unsigned char *GetTransferData(std::vector<unsigned char>& staging)
+			{
+				if (GetSize() == 0 && segmentCount == 1 && segmentData[0] != nullptr)
+					return (segmentData[0]);
+
+				if (staging.size() < transferSize)
+					staging.resize(transferSize);
+
+				unsigned char *destination = &staging[0];
+
+				memcpy(destination, data, GetSize());
+				destination += GetSize();
+
+				for (unsigned int i = 0; i < segmentCount; i++)
+				{
+					if (segmentData[i])
+						memcpy(destination, segmentData[i], segmentSizes[i]);
+					else
+						memset(destination, 0, segmentSizes[i]);
+
+					destination += segmentSizes[i];
+				}
+
+				return (&staging[0]);
+			}
+
+			unsigned int GetTransferSize(void) const
+			{
+				return (transferSize);
+			}
+	};
+}
+
+#endif
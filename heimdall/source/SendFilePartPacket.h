@@ -21,16 +21,14 @@
 #ifndef SENDFILEPARTPACKET_H
 #define SENDFILEPARTPACKET_H
 
-// C Standard Library
-#include <stdio.h>
-#include <string.h>
-
 // Heimdall
-#include "Packet.h"
+#include "SegmentedPacket.h"
 
 namespace Heimdall
 {
-	class SendFilePartPacket : public OutboundPacket
+	// A file part borrowed from the caller's buffer and zero padded out to the packet size. Nothing is copied unless
+	// padding is required.
+	class SendFilePartPacket : public SegmentedPacket
 	{
 		public:
 
@@ -39,21 +37,14 @@ namespace Heimdall
 				kDefaultPacketSize = 131072
 			};
 
-			SendFilePartPacket(FILE *file, int size = SendFilePartPacket::kDefaultPacketSize) : OutboundPacket(size)
+			SendFilePartPacket(const unsigned char *payload, unsigned int payloadSize, unsigned int size = SendFilePartPacket::kDefaultPacketSize)
+				: SegmentedPacket(0)
 			{
-				memset(data, 0, size);
-
-				long position = ftell(file);
-
-				fseek(file, 0, SEEK_END);
-				long fileSize = ftell(file);
-				fseek(file, position, SEEK_SET);
+				if (payloadSize > size)
+					payloadSize = size;
 
-				// min(fileSize, size)
-				int bytesToRead = (fileSize < size) ? fileSize - position : size;
-				
-				// bytesRead is discarded (it's just there to stop GCC warnings)
-				int bytesRead = fread(data, 1, bytesToRead, file);
+				AddSegment(payload, payloadSize);
+				AddPadding(size - payloadSize);
 			}
 
 			void Pack(void)
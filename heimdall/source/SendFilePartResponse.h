@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<ResponsePacket::kDataSize, unsigned int> PartIndexField;
+
+			WIRE_STATIC_ASSERT(PartIndexField::kEnd <= static_cast<unsigned int>(ResponsePacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int partIndex;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				partIndex = UnpackInteger(ResponsePacket::kDataSize);
+				partIndex = UnpackField<PartIndexField>();
 				
 				return (true);
 			}
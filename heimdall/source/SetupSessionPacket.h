@@ -1,74 +1,90 @@
-/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
- 
- Permission is hereby granted, free of charge, to any person obtaining a copy
- of this software and associated documentation files (the "Software"), to deal
- in the Software without restriction, including without limitation the rights
- to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- copies of the Software, and to permit persons to whom the Software is
- furnished to do so, subject to the following conditions:
- 
- The above copyright notice and this permission notice shall be included in
- all copies or substantial portions of the Software.
- 
- THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- THE SOFTWARE.*/
-
-#ifndef SETUPSESSIONPACKET_H
-#define SETUPSESSIONPACKET_H
-
-// Heimdall
-#include "ControlPacket.h"
-
-namespace Heimdall
-{
-	class SetupSessionPacket : public ControlPacket
-	{
-		public:
-
-			enum
-			{
-				kBeginSession		= 0,
-				kDeviceInfo			= 1,
-				kTotalBytes			= 2
-			};
-
-		private:
-
-			unsigned int request;
-			unsigned int unknown3Parameter;
-
-		public:
-
-			SetupSessionPacket(unsigned int request, unsigned int unknown3Parameter = 0)
-				: ControlPacket(ControlPacket::kControlTypeSetupSession)
-			{
-				this->request = request;
-				this->unknown3Parameter = unknown3Parameter;
-			}
-
-			unsigned int GetRequest(void) const
-			{
-				return (request);
-			}
-
-			unsigned int GetUnknown3Parameter(void) const
-			{
-				return (unknown3Parameter);
-			}
-
-			void Pack(void)
-			{
-				ControlPacket::Pack();
-
-				PackInteger(ControlPacket::kDataSize, request);
-				PackInteger(ControlPacket::kDataSize + 4, unknown3Parameter);
-			}
-	};
-}
-
-#endif
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef SETUPSESSIONPACKET_H
+#define SETUPSESSIONPACKET_H
+
+// Heimdall
+#include "ControlPacket.h"
+
+namespace Heimdall
+{
+	class SetupSessionPacket : public ControlPacket
+	{
+		public:
+
+			enum
+			{
+				kBeginSession		= 0,
+				kDeviceInfo			= 1,
+				kTotalBytes			= 2
+			};
+
+		private:
+
+			typedef libpit::WireField<ControlPacket::kDataSize, unsigned int> RequestField;
+			typedef libpit::WireField<RequestField::kEnd, unsigned int> Unknown3ParameterField;
+			typedef libpit::WireField<Unknown3ParameterField::kEnd, unsigned int> Unknown3ParameterHighField;
+
+			WIRE_STATIC_ASSERT(Unknown3ParameterHighField::kEnd <= static_cast<unsigned int>(ControlPacket::kPacketSize), FieldsFitInPacket);
+
+			unsigned int request;
+			unsigned int unknown3Parameter;
+			unsigned int unknown3ParameterHigh;
+
+		public:
+
+			// unknown3ParameterHigh carries the upper 32 bits of 64-bit parameters i.e. kTotalBytes. The benchmark checks
+			// what's sent, but no device has been confirmed to read the high word, it's zero below 4 GiB regardless.
+			SetupSessionPacket(unsigned int request, unsigned int unknown3Parameter = 0, unsigned int unknown3ParameterHigh = 0)
+				: ControlPacket(ControlPacket::kControlTypeSetupSession)
+			{
+				this->request = request;
+				this->unknown3Parameter = unknown3Parameter;
+				this->unknown3ParameterHigh = unknown3ParameterHigh;
+			}
+
+			unsigned int GetRequest(void) const
+			{
+				return (request);
+			}
+
+			unsigned int GetUnknown3Parameter(void) const
+			{
+				return (unknown3Parameter);
+			}
+
+			unsigned int GetUnknown3ParameterHigh(void) const
+			{
+				return (unknown3ParameterHigh);
+			}
+
+			void Pack(void)
+			{
+				ControlPacket::Pack();
+
+				PackField<RequestField>(request);
+				PackField<Unknown3ParameterField>(unknown3Parameter);
+				PackField<Unknown3ParameterHighField>(unknown3ParameterHigh);
+			}
+	};
+}
+
+#endif
@@ -30,6 +30,10 @@ namespace Heimdall
 	{
 		private:
 
+			typedef libpit::WireField<ResponsePacket::kDataSize, unsigned int> UnknownField;
+
+			WIRE_STATIC_ASSERT(UnknownField::kEnd <= static_cast<unsigned int>(ResponsePacket::kPacketSize), FieldsFitInPacket);
+
 			unsigned int unknown;
 
 		public:
@@ -48,7 +52,7 @@ namespace Heimdall
 				if (!ResponsePacket::Unpack())
 					return (false);
 
-				unknown = UnpackInteger(ResponsePacket::kDataSize);
+				unknown = UnpackField<UnknownField>();
 
 				return (true);
 			}
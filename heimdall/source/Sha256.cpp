@@ -0,0 +1,184 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "Sha256.h"
+
+using namespace Heimdall;
+
+#define SHA256_ROTATE(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const unsigned int kRoundConstants[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+// Unlike MD5, SHA-256 is big endian throughout.
+static unsigned int UnpackSha256Integer(const unsigned char *data)
+{
+	return ((static_cast<unsigned int>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+}
+
+static void PackSha256Integer(unsigned char *data, unsigned int value)
+{
+	data[0] = (value & 0xFF000000) >> 24;
+	data[1] = (value & 0x00FF0000) >> 16;
+	data[2] = (value & 0x0000FF00) >> 8;
+	data[3] = value & 0x000000FF;
+}
+
+Sha256::Sha256()
+{
+	Reset();
+}
+
+void Sha256::Reset(void)
+{
+	state[0] = 0x6A09E667;
+	state[1] = 0xBB67AE85;
+	state[2] = 0x3C6EF372;
+	state[3] = 0xA54FF53A;
+	state[4] = 0x510E527F;
+	state[5] = 0x9B05688C;
+	state[6] = 0x1F83D9AB;
+	state[7] = 0x5BE0CD19;
+
+	length = 0;
+	blockSize = 0;
+}
+
+void Sha256::Transform(const unsigned char *data)
+{
+	unsigned int w[64];
+
+	for (int i = 0; i < 16; i++)
+		w[i] = UnpackSha256Integer(data + i * 4);
+
+	for (int i = 16; i < 64; i++)
+	{
+		unsigned int s0 = SHA256_ROTATE(w[i - 15], 7) ^ SHA256_ROTATE(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		unsigned int s1 = SHA256_ROTATE(w[i - 2], 17) ^ SHA256_ROTATE(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	unsigned int a = state[0];
+	unsigned int b = state[1];
+	unsigned int c = state[2];
+	unsigned int d = state[3];
+	unsigned int e = state[4];
+	unsigned int f = state[5];
+	unsigned int g = state[6];
+	unsigned int h = state[7];
+
+	for (int i = 0; i < 64; i++)
+	{
+		unsigned int s1 = SHA256_ROTATE(e, 6) ^ SHA256_ROTATE(e, 11) ^ SHA256_ROTATE(e, 25);
+		unsigned int choice = (e & f) ^ (~e & g);
+		unsigned int t1 = h + s1 + choice + kRoundConstants[i] + w[i];
+
+		unsigned int s0 = SHA256_ROTATE(a, 2) ^ SHA256_ROTATE(a, 13) ^ SHA256_ROTATE(a, 22);
+		unsigned int majority = (a & b) ^ (a & c) ^ (b & c);
+		unsigned int t2 = s0 + majority;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+void Sha256::Update(const unsigned char *data, unsigned int size)
+{
+	length += size;
+
+	// Same buffering as Md5::Update(), whole blocks are transformed straight from data.
+	if (blockSize > 0)
+	{
+		unsigned int copySize = (size < kBlockSize - blockSize) ? size : kBlockSize - blockSize;
+		memcpy(block + blockSize, data, copySize);
+
+		blockSize += copySize;
+		data += copySize;
+		size -= copySize;
+
+		if (blockSize < kBlockSize)
+			return;
+
+		Transform(block);
+		blockSize = 0;
+	}
+
+	while (size >= kBlockSize)
+	{
+		Transform(data);
+
+		data += kBlockSize;
+		size -= kBlockSize;
+	}
+
+	memcpy(block, data, size);
+	blockSize = size;
+}
+
+void Sha256::Finish(unsigned char *digest)
+{
+	unsigned long long bitLength = length * 8;
+
+	unsigned char padding[kBlockSize * 2];
+	memset(padding, 0, sizeof(padding));
+	padding[0] = 0x80;
+
+	unsigned int paddingSize = (blockSize < 56) ? 56 - blockSize : 120 - blockSize;
+
+	PackSha256Integer(padding + paddingSize, static_cast<unsigned int>(bitLength >> 32));
+	PackSha256Integer(padding + paddingSize + 4, static_cast<unsigned int>(bitLength));
+
+	Update(padding, paddingSize + 8);
+
+	for (int i = 0; i < 8; i++)
+		PackSha256Integer(digest + i * 4, state[i]);
+
+	Reset();
+}
@@ -0,0 +1,280 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <stdio.h>
+#include <string.h>
+
+// libpit
+#include "libpit.h"
+
+// Heimdall
+#include "ControlPacket.h"
+#include "EndFileTransferPacket.h"
+#include "FileTransferPacket.h"
+#include "Heimdall.h"
+#include "PitFilePacket.h"
+#include "ReceiveFilePartPacket.h"
+#include "ResponsePacket.h"
+#include "SetupSessionPacket.h"
+#include "SimulatedDevice.h"
+
+using namespace libpit;
+using namespace Heimdall;
+
+SimulatedDevice::SimulatedDevice(const std::vector<long long>& partitionSizes, int latency)
+{
+	this->latency = latency;
+
+	firstResponse = 0;
+	responseCount = 0;
+
+	remainingFileParts = 0;
+	nextFilePartIndex = 0;
+	flashingPit = false;
+	expectingPitData = false;
+
+	bytesReceived = 0;
+
+	announcedTotalBytes = -1;
+	sequenceCount = 0;
+	filePartSize = 0;
+	fileBytes = 0;
+
+	// Like a real PIT, padded out to 4 kilobytes.
+	unsigned int pitSize = PitHeaderLayout::kSize + partitionSizes.size() * PitEntryLayout::kSize;
+	if (pitSize % kPitPadding != 0)
+		pitSize += kPitPadding - pitSize % kPitPadding;
+
+	pitData.resize(pitSize, 0);
+
+	unsigned char *header = &pitData[0];
+	PitHeaderLayout::FileIdentifier::Pack(header, PitData::kFileIdentifier);
+	PitHeaderLayout::EntryCount::Pack(header, partitionSizes.size());
+
+	for (unsigned int i = 0; i < partitionSizes.size(); i++)
+	{
+		unsigned char *entry = &pitData[PitHeaderLayout::kSize + i * PitEntryLayout::kSize];
+
+		char partitionName[PitEntry::kPartitionNameMaxLength];
+		sprintf(partitionName, "BENCHMARK%u", i + 1);
+
+		PitEntryLayout::PartitionType::Pack(entry, PitEntry::kPartitionTypeExt4);
+		PitEntryLayout::PartitionIdentifier::Pack(entry, i + 1);
+		PitEntryLayout::PartitionBlockSize::Pack(entry, kPartitionBlockSize);
+		PitEntryLayout::PartitionBlockCount::Pack(entry,
+			static_cast<unsigned int>((partitionSizes[i] + kPartitionBlockSize - 1) / kPartitionBlockSize));
+		PitEntryLayout::PartitionName::Pack(entry, partitionName);
+	}
+}
+
+bool SimulatedDevice::QueueResponse(const unsigned char *data, int size)
+{
+	if (responseCount == kMaxPendingResponses || size > kMaxResponseSize)
+		return (false);
+
+	int index = (firstResponse + responseCount) % kMaxPendingResponses;
+
+	memcpy(responses[index], data, size);
+	responseSizes[index] = size;
+	responseCount++;
+
+	return (true);
+}
+
+bool SimulatedDevice::QueueResponse(unsigned int responseType, unsigned int value)
+{
+	unsigned char response[kResponseSize];
+
+	ResponseTypeField::Pack(response, responseType);
+	ResponseValueField::Pack(response, value);
+
+	return (QueueResponse(response, kResponseSize));
+}
+
+bool SimulatedDevice::HandleSetupSession(const unsigned char *data)
+{
+	unsigned int request = RequestField::Unpack(data);
+
+	if (request == SetupSessionPacket::kTotalBytes)
+		announcedTotalBytes = static_cast<long long>(ParameterHighField::Unpack(data)) << 32 | ParameterField::Unpack(data);
+
+	unsigned int value = (request == SetupSessionPacket::kDeviceInfo) ? kDeviceType : 0;
+	return (QueueResponse(ResponsePacket::kResponseTypeBeginSession, value));
+}
+
+bool SimulatedDevice::HandlePitFile(const unsigned char *data)
+{
+	switch (RequestField::Unpack(data))
+	{
+		case PitFilePacket::kRequestFlash:
+			flashingPit = true;
+			return (QueueResponse(ResponsePacket::kResponseTypePitFile, 0));
+
+		case PitFilePacket::kRequestDump:
+			flashingPit = false;
+			return (QueueResponse(ResponsePacket::kResponseTypePitFile, pitData.size()));
+
+		case PitFilePacket::kRequestPart:
+		{
+			// When flashing, this gives the size of the PIT that follows in a packet of its own.
+			if (flashingPit)
+			{
+				expectingPitData = true;
+				return (QueueResponse(ResponsePacket::kResponseTypePitFile, 0));
+			}
+
+			unsigned int offset = ParameterField::Unpack(data) * ReceiveFilePartPacket::kDataSize;
+
+			if (offset >= pitData.size())
+				return (false);
+
+			unsigned int partSize = pitData.size() - offset;
+			if (partSize > ReceiveFilePartPacket::kDataSize)
+				partSize = ReceiveFilePartPacket::kDataSize;
+
+			return (QueueResponse(&pitData[offset], partSize));
+		}
+
+		case PitFilePacket::kRequestEndTransfer:
+			flashingPit = false;
+			return (QueueResponse(ResponsePacket::kResponseTypePitFile, 0));
+
+		default:
+			return (false);
+	}
+}
+
+bool SimulatedDevice::HandleFileTransfer(const unsigned char *data)
+{
+	switch (RequestField::Unpack(data))
+	{
+		case FileTransferPacket::kRequestFlash:
+			return (QueueResponse(ResponsePacket::kResponseTypeFileTransfer, 0));
+
+		case FileTransferPacket::kRequestEnd:
+		{
+			// Decoded as the bootloader would, an odd index means the partial packet is 65536 bytes longer than stated.
+			unsigned int partialPacketLength = PartialPacketLengthField::Unpack(data);
+			unsigned int lastFullPacketIndex = LastFullPacketIndexField::Unpack(data);
+
+			if (lastFullPacketIndex % 2 != 0)
+			{
+				partialPacketLength += 65536;
+				lastFullPacketIndex--;
+			}
+
+			fileBytes += static_cast<long long>(lastFullPacketIndex / 2) * filePartSize + partialPacketLength;
+
+			bool endOfFile = (DestinationField::Unpack(data) == EndFileTransferPacket::kDestinationModem)
+				? ModemEndOfFileField::Unpack(data) != 0 : PhoneEndOfFileField::Unpack(data) != 0;
+
+			if (endOfFile)
+			{
+				fileSizes.push_back(fileBytes);
+				fileBytes = 0;
+			}
+
+			return (QueueResponse(ResponsePacket::kResponseTypeFileTransfer, 0));
+		}
+
+		case FileTransferPacket::kRequestPart:
+			// The transfer count is twice the number of parts in the sequence.
+			remainingFileParts = TransferCountField::Unpack(data) / 2;
+			nextFilePartIndex = 0;
+			sequenceCount++;
+			return (QueueResponse(ResponsePacket::kResponseTypeFileTransfer, 0));
+
+		default:
+			return (false);
+	}
+}
+
+void SimulatedDevice::Wait(void) const
+{
+	if (latency <= 0)
+		return;
+
+#ifdef OS_WINDOWS
+	Sleep((latency + 999) / 1000);
+#else
+	usleep(latency);
+#endif
+}
+
+bool SimulatedDevice::HandleTransfer(const unsigned char *data, int size)
+{
+	Wait();
+
+	bytesReceived += size;
+
+	if (remainingFileParts > 0)
+	{
+		filePartSize = size;
+		remainingFileParts--;
+		return (QueueResponse(ResponsePacket::kResponseTypeSendFilePart, nextFilePartIndex++));
+	}
+
+	if (expectingPitData)
+	{
+		expectingPitData = false;
+		return (QueueResponse(ResponsePacket::kResponseTypePitFile, 0));
+	}
+
+	if (size < kControlPacketSize)
+		return (false);
+
+	switch (ControlTypeField::Unpack(data))
+	{
+		case ControlPacket::kControlTypeSetupSession:
+			return (HandleSetupSession(data));
+
+		case ControlPacket::kControlTypePitFile:
+			return (HandlePitFile(data));
+
+		case ControlPacket::kControlTypeFileTransfer:
+			return (HandleFileTransfer(data));
+
+		case ControlPacket::kControlTypeEndSession:
+			return (QueueResponse(ResponsePacket::kResponseTypeEndSession, 0));
+
+		default:
+			return (false);
+	}
+}
+
+int SimulatedDevice::ReadResponse(unsigned char *destination, int size)
+{
+	if (responseCount == 0)
+		return (0);
+
+	int responseSize = responseSizes[firstResponse];
+	if (responseSize > size)
+		responseSize = size;
+
+	memcpy(destination, responses[firstResponse], responseSize);
+
+	firstResponse = (firstResponse + 1) % kMaxPendingResponses;
+	responseCount--;
+
+	return (responseSize);
+}
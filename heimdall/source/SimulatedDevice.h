@@ -0,0 +1,150 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef SIMULATEDDEVICE_H
+#define SIMULATEDDEVICE_H
+
+// C/C++ Standard Library
+#include <vector>
+
+// libpit
+#include "WireFormat.h"
+
+namespace Heimdall
+{
+	// Stands in for a device in download mode so the host side of a flash can be measured without one. It understands
+	// just enough of the protocol to answer a session, a PIT download and file transfers, and discards everything it's
+	// sent. Packets are exchanged with it at the SendPacket()/ReceivePacket() boundary, so only USB itself is skipped.
+	class SimulatedDevice
+	{
+		public:
+
+			enum
+			{
+				kPartitionBlockSize = 512,
+				kDeviceType = 180
+			};
+
+		private:
+
+			enum
+			{
+				kControlPacketSize = 1024,
+				kResponseSize = 8,
+
+				kMaxPendingResponses = 32,
+				kMaxResponseSize = 500,
+				kPitPadding = 4096
+			};
+
+			// Offsets shared by every control packet and response. The packet classes keep theirs private.
+			typedef libpit::WireField<0, unsigned int> ControlTypeField;
+			typedef libpit::WireField<ControlTypeField::kEnd, unsigned int> RequestField;
+			typedef libpit::WireField<RequestField::kEnd, unsigned int> ParameterField;
+			typedef libpit::WireField<RequestField::kEnd + 2, unsigned int> TransferCountField;
+			typedef libpit::WireField<ParameterField::kEnd, unsigned int> ParameterHighField;
+
+			// End of file transfer sequence. Phone transfers send the file identifier where modem transfers send the end of
+			// file flag, theirs follows it.
+			typedef libpit::WireField<RequestField::kEnd, unsigned int> DestinationField;
+			typedef libpit::WireField<DestinationField::kEnd, unsigned short> PartialPacketLengthField;
+			typedef libpit::WireField<PartialPacketLengthField::kEnd, unsigned int> LastFullPacketIndexField;
+			typedef libpit::WireField<LastFullPacketIndexField::kEnd + 6, unsigned int> ModemEndOfFileField;
+			typedef libpit::WireField<ModemEndOfFileField::kEnd, unsigned int> PhoneEndOfFileField;
+
+			typedef libpit::WireField<0, unsigned int> ResponseTypeField;
+			typedef libpit::WireField<ResponseTypeField::kEnd, unsigned int> ResponseValueField;
+
+			std::vector<unsigned char> pitData;
+
+			int latency;
+
+			// Responses are queued as the bulk in endpoint would, one transfer each. The PIT is downloaded with several
+			// part requests outstanding, so there can be a few at once.
+			unsigned char responses[kMaxPendingResponses][kMaxResponseSize];
+			int responseSizes[kMaxPendingResponses];
+			int firstResponse;
+			int responseCount;
+
+			int remainingFileParts;
+			int nextFilePartIndex;
+			bool flashingPit;
+			bool expectingPitData;
+
+			long long bytesReceived;
+
+			// What the host said it would send and what it described sending, so a benchmark can check them.
+			long long announcedTotalBytes;
+			int sequenceCount;
+			int filePartSize;
+			long long fileBytes;
+			std::vector<long long> fileSizes;
+
+			bool QueueResponse(const unsigned char *data, int size);
+			bool QueueResponse(unsigned int responseType, unsigned int value);
+
+			bool HandleSetupSession(const unsigned char *data);
+			bool HandlePitFile(const unsigned char *data);
+			bool HandleFileTransfer(const unsigned char *data);
+
+			void Wait(void) const;
+
+			SimulatedDevice(const SimulatedDevice&);
+			SimulatedDevice& operator=(const SimulatedDevice&);
+
+		public:
+
+			// A partition is created for each image, large enough to hold it. Partition identifiers start at 1. Latency
+			// is added to every packet sent, in microseconds.
+			SimulatedDevice(const std::vector<long long>& partitionSizes, int latency);
+
+			// Handles a packet sent to the device, returning false if it isn't one the device expected.
+			bool HandleTransfer(const unsigned char *data, int size);
+
+			// Copies the oldest response into destination, returning its size or 0 if there's nothing to receive.
+			int ReadResponse(unsigned char *destination, int size);
+
+			long long GetBytesReceived(void) const
+			{
+				return (bytesReceived);
+			}
+
+			// Total sent with kTotalBytes, both halves combined.
+			long long GetAnnouncedTotalBytes(void) const
+			{
+				return (announcedTotalBytes);
+			}
+
+			int GetSequenceCount(void) const
+			{
+				return (sequenceCount);
+			}
+
+			// Size of each file transferred as described by the end of its sequences, in the order they completed.
+			const std::vector<long long>& GetFileSizes(void) const
+			{
+				return (fileSizes);
+			}
+	};
+}
+
+#endif
@@ -0,0 +1,233 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "SparseFileSource.h"
+
+using namespace libpit;
+using namespace Heimdall;
+
+WIRE_STATIC_ASSERT(static_cast<int>(SparseFileSource::HeaderLayout::kSize) == 28, SparseHeaderSize);
+WIRE_STATIC_ASSERT(static_cast<int>(SparseFileSource::ChunkHeaderLayout::kSize) == 12, SparseChunkHeaderSize);
+
+SparseFileSource::SparseFileSource(FileSource *source)
+{
+	this->source = source;
+
+	headerSize = 0;
+	chunkHeaderSize = 0;
+	blockSize = 0;
+	chunkCount = 0;
+
+	size = 0;
+	position = 0;
+
+	chunkIndex = 0;
+	chunkType = 0;
+	chunkRemaining = 0;
+	memset(fillValue, 0, sizeof(fillValue));
+
+	generatedSize = 0;
+}
+
+int SparseFileSource::Open(void)
+{
+	unsigned char header[HeaderLayout::kSize];
+
+	if (source->Read(header, HeaderLayout::kSize) != HeaderLayout::kSize)
+		return (kOpenErrorRead);
+
+	if (HeaderLayout::Magic::Unpack(header) != kMagic)
+		return (kOpenErrorNotSparse);
+
+	headerSize = HeaderLayout::HeaderSize::Unpack(header);
+	chunkHeaderSize = HeaderLayout::ChunkHeaderSize::Unpack(header);
+	blockSize = HeaderLayout::BlockSize::Unpack(header);
+	chunkCount = HeaderLayout::ChunkCount::Unpack(header);
+
+	// Newer minor versions may only grow the headers, which we skip over.
+	if (HeaderLayout::MajorVersion::Unpack(header) != kMajorVersion || headerSize < HeaderLayout::kSize
+		|| chunkHeaderSize < ChunkHeaderLayout::kSize || blockSize == 0 || blockSize % 4 != 0)
+	{
+		return (kOpenErrorUnsupported);
+	}
+
+	size = static_cast<long long>(blockSize) * HeaderLayout::BlockCount::Unpack(header);
+
+	if (!Skip(headerSize - HeaderLayout::kSize))
+		return (kOpenErrorRead);
+
+	return (kOpenSucceeded);
+}
+
+bool SparseFileSource::Skip(unsigned int size)
+{
+	unsigned char discard[64];
+
+	while (size > 0)
+	{
+		unsigned int skipSize = (size < sizeof(discard)) ? size : sizeof(discard);
+
+		if (source->Read(discard, skipSize) != skipSize)
+			return (false);
+
+		size -= skipSize;
+	}
+
+	return (true);
+}
+
+bool SparseFileSource::NextChunk(void)
+{
+	while (chunkIndex < chunkCount)
+	{
+		unsigned char header[ChunkHeaderLayout::kSize];
+
+		if (source->Read(header, ChunkHeaderLayout::kSize) != ChunkHeaderLayout::kSize
+			|| !Skip(chunkHeaderSize - ChunkHeaderLayout::kSize))
+		{
+			return (false);
+		}
+
+		chunkIndex++;
+		chunkType = ChunkHeaderLayout::Type::Unpack(header);
+
+		unsigned int totalSize = ChunkHeaderLayout::TotalSize::Unpack(header);
+
+		if (totalSize < chunkHeaderSize)
+			return (false);
+
+		long long dataSize = totalSize - chunkHeaderSize;
+		long long outputSize = static_cast<long long>(blockSize) * ChunkHeaderLayout::BlockCount::Unpack(header);
+
+		switch (chunkType)
+		{
+			case kChunkTypeRaw:
+				if (dataSize != outputSize)
+					return (false);
+
+				break;
+
+			case kChunkTypeFill:
+				if (dataSize != sizeof(fillValue) || source->Read(fillValue, sizeof(fillValue)) != sizeof(fillValue))
+					return (false);
+
+				break;
+
+			case kChunkTypeDontCare:
+				if (dataSize != 0)
+					return (false);
+
+				break;
+
+			case kChunkTypeCrc32:
+				// Only a checksum of what came before, nothing to output.
+				if (dataSize != 4 || !Skip(4))
+					return (false);
+
+				continue;
+
+			default:
+				return (false);
+		}
+
+		// Chunks can't describe more than the header said the image holds.
+		if (outputSize > size - position)
+			return (false);
+
+		chunkRemaining = outputSize;
+
+		if (chunkRemaining > 0)
+			return (true);
+	}
+
+	return (false);
+}
+
+unsigned int SparseFileSource::Read(unsigned char *buffer, unsigned int size)
+{
+	unsigned int bytesRead = 0;
+
+	while (bytesRead < size && position < this->size)
+	{
+		if (chunkRemaining == 0 && !NextChunk())
+			break;
+
+		unsigned int count = (static_cast<long long>(size - bytesRead) < chunkRemaining) ? size - bytesRead
+			: static_cast<unsigned int>(chunkRemaining);
+
+		unsigned char *output = buffer + bytesRead;
+
+		if (chunkType == kChunkTypeRaw)
+		{
+			unsigned int rawRead = source->Read(output, count);
+
+			bytesRead += rawRead;
+			position += rawRead;
+			chunkRemaining -= rawRead;
+
+			if (rawRead != count)
+				break;
+
+			continue;
+		}
+
+		if (chunkType == kChunkTypeFill)
+		{
+			// Chunks start on a block boundary and blocks are a multiple of 4 bytes, so the pattern lines up with position.
+			for (unsigned int i = 0; i < count; i++)
+				output[i] = fillValue[(position + i) % 4];
+		}
+		else
+		{
+			memset(output, 0, count);
+		}
+
+		bytesRead += count;
+		position += count;
+		chunkRemaining -= count;
+		generatedSize += count;
+	}
+
+	return (bytesRead);
+}
+
+const char *SparseFileSource::GetOpenErrorMessage(int result)
+{
+	switch (result)
+	{
+		case kOpenSucceeded:
+			return ("Success");
+
+		case kOpenErrorNotSparse:
+			return ("Not a sparse image");
+
+		case kOpenErrorUnsupported:
+			return ("Unsupported sparse image version");
+
+		default:
+			return ("Failed to read sparse image");
+	}
+}
@@ -0,0 +1,146 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef SPARSEFILESOURCE_H
+#define SPARSEFILESOURCE_H
+
+// libpit
+#include "WireFormat.h"
+
+// Heimdall
+#include "FileSource.h"
+
+namespace Heimdall
+{
+	// Expands an Android sparse image as it's read. Raw chunks are read from the underlying source, fill and "don't care"
+	// chunks are generated in memory, so the expanded image never has to exist on disk and its empty regions are never
+	// read at all.
+	class SparseFileSource : public FileSource
+	{
+		public:
+
+			enum
+			{
+				kMagic = 0xED26FF3A,
+				kMajorVersion = 1
+			};
+
+			enum
+			{
+				kChunkTypeRaw = 0xCAC1,
+				kChunkTypeFill = 0xCAC2,
+				kChunkTypeDontCare = 0xCAC3,
+				kChunkTypeCrc32 = 0xCAC4
+			};
+
+			// Open() results
+			enum
+			{
+				kOpenSucceeded = 0,
+				kOpenErrorNotSparse,
+				kOpenErrorUnsupported,
+				kOpenErrorRead
+			};
+
+			class HeaderLayout
+			{
+				public:
+
+					typedef libpit::WireField<0, unsigned int> Magic;
+					typedef libpit::WireField<Magic::kEnd, unsigned short> MajorVersion;
+					typedef libpit::WireField<MajorVersion::kEnd, unsigned short> MinorVersion;
+					typedef libpit::WireField<MinorVersion::kEnd, unsigned short> HeaderSize;
+					typedef libpit::WireField<HeaderSize::kEnd, unsigned short> ChunkHeaderSize;
+					typedef libpit::WireField<ChunkHeaderSize::kEnd, unsigned int> BlockSize;
+					typedef libpit::WireField<BlockSize::kEnd, unsigned int> BlockCount;
+					typedef libpit::WireField<BlockCount::kEnd, unsigned int> ChunkCount;
+					typedef libpit::WireField<ChunkCount::kEnd, unsigned int> Checksum;
+
+					enum
+					{
+						kSize = Checksum::kEnd
+					};
+			};
+
+			class ChunkHeaderLayout
+			{
+				public:
+
+					typedef libpit::WireField<0, unsigned short> Type;
+					typedef libpit::WireField<Type::kEnd, unsigned short> Reserved;
+					typedef libpit::WireField<Reserved::kEnd, unsigned int> BlockCount;
+					typedef libpit::WireField<BlockCount::kEnd, unsigned int> TotalSize;
+
+					enum
+					{
+						kSize = TotalSize::kEnd
+					};
+			};
+
+		private:
+
+			FileSource *source;
+
+			unsigned int headerSize;
+			unsigned int chunkHeaderSize;
+			unsigned int blockSize;
+			unsigned int chunkCount;
+
+			long long size;
+			long long position;
+
+			unsigned int chunkIndex;
+			unsigned int chunkType;
+			long long chunkRemaining;
+			unsigned char fillValue[4];
+
+			long long generatedSize;
+
+			bool Skip(unsigned int size);
+			bool NextChunk(void);
+
+		public:
+
+			// source is the sparse image itself and must outlive this object.
+			SparseFileSource(FileSource *source);
+
+			// Reads the sparse header, must succeed before anything else is called.
+			int Open(void);
+
+			long long GetSize(void) const
+			{
+				return (size);
+			}
+
+			unsigned int Read(unsigned char *buffer, unsigned int size);
+
+			// Bytes of output produced from fill and "don't care" chunks rather than read from the image.
+			long long GetGeneratedSize(void) const
+			{
+				return (generatedSize);
+			}
+
+			static const char *GetOpenErrorMessage(int result);
+	};
+}
+
+#endif
@@ -0,0 +1,165 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "StreamSource.h"
+
+using namespace Heimdall;
+
+StreamSource::StreamSource(FILE *file, long long size) : freeBlocks(kBlockCount), filledBlocks(0)
+{
+	this->file = file;
+	this->size = size;
+
+	position = 0;
+
+	blocks = new unsigned char[kBlockCount * kBlockSize];
+
+	currentBlock = 0;
+	currentBlockOffset = 0;
+	holdingBlock = false;
+	truncated = false;
+	overlong = false;
+
+	stopping = false;
+
+	// Without a reader thread the stream is simply read as it's consumed.
+	readerThread.Start(ReadBlocks, this);
+}
+
+StreamSource::~StreamSource()
+{
+	// A reader waiting for a free block is woken to notice it should stop. One blocked reading the stream only stops once
+	// the writer sends more or closes its end.
+	stopping = true;
+	freeBlocks.Post();
+
+	readerThread.Join();
+
+	delete [] blocks;
+}
+
+void StreamSource::ReadBlocks(void *streamSource)
+{
+	StreamSource *self = static_cast<StreamSource *>(streamSource);
+
+	long long remaining = self->size;
+	unsigned int blockIndex = 0;
+
+	while (remaining > 0)
+	{
+		self->freeBlocks.Wait();
+
+		if (self->stopping)
+			break;
+
+		unsigned int expectedLength = (remaining < kBlockSize) ? static_cast<unsigned int>(remaining) : static_cast<unsigned int>(kBlockSize);
+		unsigned int length = fread(self->blocks + blockIndex * kBlockSize, 1, expectedLength, self->file);
+
+		// The whole stream has to be accounted for, so the final block is only handed over once the writer closes its
+		// end. Anything left over would otherwise be silently dropped.
+		if (length == remaining && fgetc(self->file) != EOF)
+		{
+			self->overlong = true;
+			length--;
+		}
+
+		self->blockLengths[blockIndex] = length;
+		self->filledBlocks.Post();
+
+		// The stream ended early or failed, the short block tells the consumer.
+		if (length != expectedLength)
+			break;
+
+		remaining -= length;
+		blockIndex = (blockIndex + 1) % kBlockCount;
+	}
+}
+
+unsigned int StreamSource::Read(unsigned char *buffer, unsigned int size)
+{
+	if (static_cast<long long>(size) > this->size - position)
+		size = static_cast<unsigned int>(this->size - position);
+
+	if (!readerThread.IsRunning())
+	{
+		unsigned int bytesRead = fread(buffer, 1, size, file);
+
+		if (bytesRead > 0 && position + bytesRead == this->size && fgetc(file) != EOF)
+		{
+			overlong = true;
+			bytesRead--;
+		}
+
+		position += bytesRead;
+
+		return (bytesRead);
+	}
+
+	unsigned int bytesRead = 0;
+
+	while (bytesRead < size && !truncated)
+	{
+		if (!holdingBlock)
+		{
+			filledBlocks.Wait();
+
+			currentBlockOffset = 0;
+			holdingBlock = true;
+		}
+
+		// Every block but the last is full, anything shorter means the stream ended before its declared size.
+		long long blockStart = position - currentBlockOffset;
+		unsigned int expectedLength = (this->size - blockStart < kBlockSize) ? static_cast<unsigned int>(this->size - blockStart)
+			: static_cast<unsigned int>(kBlockSize);
+		unsigned int blockLength = blockLengths[currentBlock];
+
+		unsigned int copySize = blockLength - currentBlockOffset;
+
+		if (copySize > size - bytesRead)
+			copySize = size - bytesRead;
+
+		memcpy(buffer + bytesRead, blocks + currentBlock * kBlockSize + currentBlockOffset, copySize);
+
+		bytesRead += copySize;
+		position += copySize;
+		currentBlockOffset += copySize;
+
+		if (currentBlockOffset == blockLength)
+		{
+			if (blockLength != expectedLength)
+			{
+				truncated = true;
+				break;
+			}
+
+			holdingBlock = false;
+			currentBlock = (currentBlock + 1) % kBlockCount;
+			freeBlocks.Post();
+		}
+	}
+
+	return (bytesRead);
+}
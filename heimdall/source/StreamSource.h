@@ -0,0 +1,99 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef STREAMSOURCE_H
+#define STREAMSOURCE_H
+
+// C Standard Library
+#include <stdio.h>
+
+// Heimdall
+#include "FileSource.h"
+#include "Thread.h"
+
+namespace Heimdall
+{
+	// Reads a pipe or stdin of a declared size. A reader thread keeps a bounded set of blocks filled ahead of the
+	// transfer, so whatever is producing the stream isn't stalled while we wait on USB, and we aren't stalled while it
+	// catches up so long as it's ahead.
+	class StreamSource : public FileSource
+	{
+		public:
+
+			enum
+			{
+				kBlockSize = 1048576,
+				kBlockCount = 8
+			};
+
+		private:
+
+			FILE *file;
+			long long size;
+			long long position;
+
+			unsigned char *blocks;
+			unsigned int blockLengths[kBlockCount];
+
+			// Blocks the reader may fill and blocks the transfer may consume.
+			Semaphore freeBlocks;
+			Semaphore filledBlocks;
+
+			// Consumer side.
+			unsigned int currentBlock;
+			unsigned int currentBlockOffset;
+			bool holdingBlock;
+			bool truncated;
+
+			// Set by the reader before it hands over the final block.
+			bool overlong;
+
+			Thread readerThread;
+			volatile bool stopping;
+
+			static void ReadBlocks(void *streamSource);
+
+			StreamSource(const StreamSource&);
+			StreamSource& operator=(const StreamSource&);
+
+		public:
+
+			StreamSource(FILE *file, long long size);
+			~StreamSource();
+
+			long long GetSize(void) const
+			{
+				return (size);
+			}
+
+			unsigned int Read(unsigned char *buffer, unsigned int size);
+
+			// True once the stream turned out to hold more than its declared size. The final block is then reported one
+			// byte short, so the transfer fails just as it does for a stream that ends early.
+			bool IsOverlong(void) const
+			{
+				return (overlong);
+			}
+	};
+}
+
+#endif
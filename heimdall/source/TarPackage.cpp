@@ -0,0 +1,354 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// C Standard Library
+#include <string.h>
+
+// Heimdall
+#include "Digest.h"
+#include "FileSource.h"
+#include "Heimdall.h"
+#include "Interface.h"
+#include "TarPackage.h"
+
+using namespace std;
+using namespace Heimdall;
+
+// ustar header layout
+enum
+{
+	kTarNameOffset = 0,
+	kTarNameLength = 100,
+	kTarSizeOffset = 124,
+	kTarSizeLength = 12,
+	kTarChecksumOffset = 148,
+	kTarChecksumLength = 8,
+	kTarTypeOffset = 156,
+	kTarMagicOffset = 257,
+	kTarPrefixOffset = 345,
+	kTarPrefixLength = 155
+};
+
+// The checksum line is short, but leave room for a long package name.
+enum
+{
+	kChecksumTailSize = 1024,
+	kMaxLongNameSize = 4096
+};
+
+TarPackage::TarPackage()
+{
+	file = nullptr;
+	archiveSize = 0;
+
+	hasChecksum = false;
+	verificationStarted = false;
+	verificationResult = kVerificationNotApplicable;
+}
+
+TarPackage::~TarPackage()
+{
+	verificationThread.Join();
+
+	if (file)
+		fclose(file);
+}
+
+bool TarPackage::Open(const char *path)
+{
+	this->path = path;
+	file = fopen(path, "rb");
+
+	if (!file)
+	{
+		Interface::PrintError("Failed to open package \"%s\"\n", path);
+		return (false);
+	}
+
+	long long fileSize = FileSource::GetFileSize(file);
+
+	if (fileSize < kBlockSize)
+	{
+		Interface::PrintError("\"%s\" is not a tar package\n", path);
+		return (false);
+	}
+
+	archiveSize = fileSize;
+
+	// Odin only appends a checksum to packages named .tar.md5.
+	if (this->path.length() > 4 && this->path.compare(this->path.length() - 4, 4, ".md5") == 0 && !ReadChecksum(fileSize))
+		return (false);
+
+	return (ReadHeaders());
+}
+
+bool TarPackage::ReadChecksum(long long fileSize)
+{
+	unsigned char tail[kChecksumTailSize];
+	unsigned int tailSize = (fileSize < kChecksumTailSize) ? static_cast<unsigned int>(fileSize) : static_cast<unsigned int>(kChecksumTailSize);
+
+	if (!FileSource::Seek(file, fileSize - tailSize) || fread(tail, 1, tailSize, file) != tailSize)
+	{
+		Interface::PrintError("Failed to read checksum of \"%s\"\n", path.c_str());
+		return (false);
+	}
+
+	// The tar always ends in zero padding, so the checksum line starts after the last zero byte.
+	unsigned int lineStart = tailSize;
+
+	while (lineStart > 0 && tail[lineStart - 1] != '\0')
+		lineStart--;
+
+	unsigned int lineLength = tailSize - lineStart;
+
+	if (lineStart == 0 || lineLength < Md5::kDigestSize * 2 + 1 || tail[lineStart + Md5::kDigestSize * 2] != ' '
+		|| !Digest::Parse(reinterpret_cast<const char *>(tail + lineStart), Md5::kDigestSize, expectedDigest))
+	{
+		Interface::PrintError("\"%s\" doesn't end in an MD5 checksum\n", path.c_str());
+		return (false);
+	}
+
+	hasChecksum = true;
+	archiveSize = fileSize - lineLength;
+
+	return (true);
+}
+
+long long TarPackage::ParseSize(const unsigned char *field, unsigned int length)
+{
+	long long size = 0;
+
+	// GNU tar stores sizes of 8 GiB and over as big endian base-256, flagged by the high bit.
+	if (field[0] & 0x80)
+	{
+		for (unsigned int i = 1; i < length; i++)
+		{
+			if (size > (0x7FFFFFFFFFFFFFFFLL >> 8))
+				return (-1);
+
+			size = (size << 8) | field[i];
+		}
+
+		return (size);
+	}
+
+	unsigned int i = 0;
+
+	while (i < length && field[i] == ' ')
+		i++;
+
+	for (; i < length && field[i] >= '0' && field[i] <= '7'; i++)
+	{
+		if (size > (0x7FFFFFFFFFFFFFFFLL >> 3))
+			return (-1);
+
+		size = (size << 3) | (field[i] - '0');
+	}
+
+	return (size);
+}
+
+bool TarPackage::ReadHeaders(void)
+{
+	unsigned char header[kBlockSize];
+	long long headerOffset = 0;
+
+	string longName;
+
+	while (headerOffset + kBlockSize <= archiveSize)
+	{
+		if (!FileSource::Seek(file, headerOffset) || fread(header, 1, kBlockSize, file) != kBlockSize)
+		{
+			Interface::PrintError("Failed to read \"%s\"\n", path.c_str());
+			return (false);
+		}
+
+		bool endOfArchive = true;
+
+		for (int i = 0; i < kBlockSize; i++)
+		{
+			if (header[i] != 0)
+			{
+				endOfArchive = false;
+				break;
+			}
+		}
+
+		if (endOfArchive)
+			break;
+
+		// The header checksum is the sum of its bytes with the checksum field itself read as spaces.
+		unsigned int headerChecksum = 0;
+
+		for (int i = 0; i < kBlockSize; i++)
+			headerChecksum += (i >= kTarChecksumOffset && i < kTarChecksumOffset + kTarChecksumLength) ? ' ' : header[i];
+
+		if (ParseSize(header + kTarChecksumOffset, kTarChecksumLength) != static_cast<long long>(headerChecksum))
+		{
+			Interface::PrintError("\"%s\" is corrupt or not a tar package (bad header at offset %lld)\n", path.c_str(), headerOffset);
+			return (false);
+		}
+
+		long long size = ParseSize(header + kTarSizeOffset, kTarSizeLength);
+		long long dataOffset = headerOffset + kBlockSize;
+
+		if (size < 0 || size > archiveSize - dataOffset)
+		{
+			Interface::PrintError("\"%s\" is truncated\n", path.c_str());
+			return (false);
+		}
+
+		char type = header[kTarTypeOffset];
+
+		if (type == 'L')
+		{
+			// GNU long name, the data is the name of the next member.
+			if (size > kMaxLongNameSize)
+			{
+				Interface::PrintError("\"%s\" contains an invalid long name\n", path.c_str());
+				return (false);
+			}
+
+			char name[kMaxLongNameSize + 1];
+
+			if (fread(name, 1, static_cast<size_t>(size), file) != static_cast<size_t>(size))
+			{
+				Interface::PrintError("Failed to read \"%s\"\n", path.c_str());
+				return (false);
+			}
+
+			name[size] = '\0';
+			longName = name;
+		}
+		else if (type == '0' || type == '\0' || type == '7')
+		{
+			string name;
+
+			if (!longName.empty())
+			{
+				name = longName;
+			}
+			else
+			{
+				const char *nameField = reinterpret_cast<const char *>(header + kTarNameOffset);
+				name.assign(nameField, strnlen(nameField, kTarNameLength));
+
+				if (memcmp(header + kTarMagicOffset, "ustar", 5) == 0 && header[kTarPrefixOffset] != '\0')
+				{
+					const char *prefixField = reinterpret_cast<const char *>(header + kTarPrefixOffset);
+					name = string(prefixField, strnlen(prefixField, kTarPrefixLength)) + "/" + name;
+				}
+			}
+
+			members.push_back(TarMember(name, dataOffset, size));
+			longName.clear();
+		}
+		else
+		{
+			// Directories, links and extended headers carry nothing we can flash.
+			longName.clear();
+		}
+
+		headerOffset = dataOffset + (size + kBlockSize - 1) / kBlockSize * kBlockSize;
+	}
+
+	if (members.empty())
+	{
+		Interface::PrintError("\"%s\" doesn't contain any files\n", path.c_str());
+		return (false);
+	}
+
+	return (true);
+}
+
+void TarPackage::Verify(void *package)
+{
+	TarPackage *self = static_cast<TarPackage *>(package);
+
+	// A handle of our own, the main thread is seeking around the package while it flashes.
+	FILE *verifyFile = fopen(self->path.c_str(), "rb");
+
+	if (!verifyFile)
+	{
+		self->verificationResult = kVerificationReadError;
+		return;
+	}
+
+	unsigned char *buffer = new unsigned char[kVerifyBufferSize];
+
+	Md5 md5;
+	long long remaining = self->archiveSize;
+
+	while (remaining > 0)
+	{
+		unsigned int readSize = (remaining < kVerifyBufferSize) ? static_cast<unsigned int>(remaining) : static_cast<unsigned int>(kVerifyBufferSize);
+
+		if (fread(buffer, 1, readSize, verifyFile) != readSize)
+			break;
+
+		md5.Update(buffer, readSize);
+		remaining -= readSize;
+	}
+
+	delete [] buffer;
+	fclose(verifyFile);
+
+	if (remaining > 0)
+	{
+		self->verificationResult = kVerificationReadError;
+		return;
+	}
+
+	unsigned char digest[Md5::kDigestSize];
+	md5.Finish(digest);
+
+	self->verificationResult = (memcmp(digest, self->expectedDigest, Md5::kDigestSize) == 0) ? kVerificationPassed
+		: kVerificationFailed;
+}
+
+bool TarPackage::StartVerification(void)
+{
+	if (!hasChecksum || verificationStarted)
+		return (true);
+
+	verificationStarted = verificationThread.Start(Verify, this);
+	return (verificationStarted);
+}
+
+int TarPackage::WaitForVerification(void)
+{
+	if (!hasChecksum)
+		return (kVerificationNotApplicable);
+
+	if (verificationStarted)
+	{
+		// Joining is what makes verificationResult safe to read.
+		verificationThread.Join();
+	}
+	else
+	{
+		Verify(this);
+		verificationStarted = true;
+	}
+
+	return (verificationResult);
+}
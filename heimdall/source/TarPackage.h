@@ -0,0 +1,144 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef TARPACKAGE_H
+#define TARPACKAGE_H
+
+// C Standard Library
+#include <stdio.h>
+
+// C/C++ Standard Library
+#include <string>
+#include <vector>
+
+// Heimdall
+#include "Md5.h"
+#include "Thread.h"
+
+namespace Heimdall
+{
+	struct TarMember
+	{
+		std::string name;
+
+		long long offset;
+		long long size;
+
+		TarMember(const std::string& name, long long offset, long long size)
+		{
+			this->name = name;
+			this->offset = offset;
+			this->size = size;
+		}
+	};
+
+	// An Odin firmware package, a plain ustar/GNU tar optionally followed by an md5sum style line ("<digest>  <name>\n")
+	// covering every byte before it. Only the headers are read up front, members are streamed straight out of the
+	// package by FileRegionSource. The checksum is verified on a worker thread with its own file handle, so it can
+	// overlap the transfer.
+	class TarPackage
+	{
+		public:
+
+			enum
+			{
+				kBlockSize = 512,
+				kVerifyBufferSize = 1024 * 1024
+			};
+
+			// Verification results
+			enum
+			{
+				kVerificationNotApplicable = 0,
+				kVerificationPassed,
+				kVerificationFailed,
+				kVerificationReadError
+			};
+
+		private:
+
+			std::string path;
+			FILE *file;
+
+			// Bytes covered by the checksum, the whole file when there's no checksum.
+			long long archiveSize;
+			std::vector<TarMember> members;
+
+			bool hasChecksum;
+			unsigned char expectedDigest[Md5::kDigestSize];
+
+			Thread verificationThread;
+			bool verificationStarted;
+			int verificationResult;
+
+			bool ReadChecksum(long long fileSize);
+			bool ReadHeaders(void);
+
+			static long long ParseSize(const unsigned char *field, unsigned int length);
+			static void Verify(void *package);
+
+			// Not copyable, owns the file and the worker.
+			TarPackage(const TarPackage&);
+			TarPackage& operator=(const TarPackage&);
+
+		public:
+
+			TarPackage();
+			~TarPackage();
+
+			bool Open(const char *path);
+
+			const std::string& GetPath(void) const
+			{
+				return (path);
+			}
+
+			FILE *GetFile(void) const
+			{
+				return (file);
+			}
+
+			unsigned int GetMemberCount(void) const
+			{
+				return (members.size());
+			}
+
+			const TarMember& GetMember(unsigned int index) const
+			{
+				return (members[index]);
+			}
+
+			bool HasChecksum(void) const
+			{
+				return (hasChecksum);
+			}
+
+			// Starts verifying the checksum in the background, does nothing for packages without one.
+			bool StartVerification(void);
+
+			// Blocks until verification has finished and returns its result. If it was never started in the background it's
+			// done here instead.
+			int WaitForVerification(void);
+	};
+}
+
+#endif
@@ -0,0 +1,228 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// Heimdall
+#include "Thread.h"
+
+using namespace Heimdall;
+
+Thread::Thread()
+{
+	function = nullptr;
+	argument = nullptr;
+	running = false;
+}
+
+Thread::~Thread()
+{
+	Join();
+}
+
+#ifdef OS_WINDOWS
+
+DWORD WINAPI Thread::Run(LPVOID thread)
+{
+	Thread *self = static_cast<Thread *>(thread);
+	self->function(self->argument);
+
+	return (0);
+}
+
+bool Thread::Start(Function function, void *argument)
+{
+	if (running)
+		return (false);
+
+	this->function = function;
+	this->argument = argument;
+
+	handle = CreateThread(nullptr, 0, Run, this, 0, nullptr);
+
+	if (!handle)
+		return (false);
+
+	running = true;
+	return (true);
+}
+
+void Thread::Join(void)
+{
+	if (!running)
+		return;
+
+	WaitForSingleObject(handle, INFINITE);
+	CloseHandle(handle);
+
+	running = false;
+}
+
+Mutex::Mutex()
+{
+	InitializeCriticalSection(&criticalSection);
+}
+
+Mutex::~Mutex()
+{
+	DeleteCriticalSection(&criticalSection);
+}
+
+void Mutex::Lock(void)
+{
+	EnterCriticalSection(&criticalSection);
+}
+
+void Mutex::Unlock(void)
+{
+	LeaveCriticalSection(&criticalSection);
+}
+
+Semaphore::Semaphore(unsigned int initialCount)
+{
+	handle = CreateSemaphore(nullptr, initialCount, 0x7FFFFFFF, nullptr);
+}
+
+Semaphore::~Semaphore()
+{
+	CloseHandle(handle);
+}
+
+void Semaphore::Wait(void)
+{
+	WaitForSingleObject(handle, INFINITE);
+}
+
+void Semaphore::Post(void)
+{
+	ReleaseSemaphore(handle, 1, nullptr);
+}
+
+bool Semaphore::TryWait(void)
+{
+	return (WaitForSingleObject(handle, 0) == WAIT_OBJECT_0);
+}
+
+#else // of ifdef OS_WINDOWS
+
+void *Thread::Run(void *thread)
+{
+	Thread *self = static_cast<Thread *>(thread);
+	self->function(self->argument);
+
+	return (nullptr);
+}
+
+bool Thread::Start(Function function, void *argument)
+{
+	if (running)
+		return (false);
+
+	this->function = function;
+	this->argument = argument;
+
+	if (pthread_create(&thread, nullptr, Run, this) != 0)
+		return (false);
+
+	running = true;
+	return (true);
+}
+
+void Thread::Join(void)
+{
+	if (!running)
+		return;
+
+	pthread_join(thread, nullptr);
+
+	running = false;
+}
+
+Mutex::Mutex()
+{
+	pthread_mutex_init(&mutex, nullptr);
+}
+
+Mutex::~Mutex()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void Mutex::Lock(void)
+{
+	pthread_mutex_lock(&mutex);
+}
+
+void Mutex::Unlock(void)
+{
+	pthread_mutex_unlock(&mutex);
+}
+
+Semaphore::Semaphore(unsigned int initialCount)
+{
+	pthread_mutex_init(&mutex, nullptr);
+	pthread_cond_init(&condition, nullptr);
+
+	count = initialCount;
+}
+
+Semaphore::~Semaphore()
+{
+	pthread_cond_destroy(&condition);
+	pthread_mutex_destroy(&mutex);
+}
+
+void Semaphore::Wait(void)
+{
+	pthread_mutex_lock(&mutex);
+
+	while (count == 0)
+		pthread_cond_wait(&condition, &mutex);
+
+	count--;
+
+	pthread_mutex_unlock(&mutex);
+}
+
+void Semaphore::Post(void)
+{
+	pthread_mutex_lock(&mutex);
+
+	count++;
+	pthread_cond_signal(&condition);
+
+	pthread_mutex_unlock(&mutex);
+}
+
+bool Semaphore::TryWait(void)
+{
+	pthread_mutex_lock(&mutex);
+
+	bool acquired = count > 0;
+
+	if (acquired)
+		count--;
+
+	pthread_mutex_unlock(&mutex);
+
+	return (acquired);
+}
+
+#endif // of else of ifdef OS_WINDOWS
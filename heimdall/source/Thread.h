@@ -0,0 +1,131 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+   Copyright (c) 2012 Marsh Ray
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+#ifndef THREAD_H
+#define THREAD_H
+
+// Heimdall
+#include "Heimdall.h"
+
+#ifndef OS_WINDOWS
+#include <pthread.h>
+#endif
+
+namespace Heimdall
+{
+	// Minimal portable worker thread. USB communication always stays on the main thread, workers only do file I/O and
+	// hashing and hand their results back once joined.
+	class Thread
+	{
+		public:
+
+			typedef void (*Function)(void *argument);
+
+		private:
+
+#ifdef OS_WINDOWS
+			HANDLE handle;
+#else
+			pthread_t thread;
+#endif
+
+			Function function;
+			void *argument;
+			bool running;
+
+#ifdef OS_WINDOWS
+			static DWORD WINAPI Run(LPVOID thread);
+#else
+			static void *Run(void *thread);
+#endif
+
+			// Not copyable, the native handle has a single owner.
+			Thread(const Thread&);
+			Thread& operator=(const Thread&);
+
+		public:
+
+			Thread();
+			~Thread();
+
+			bool Start(Function function, void *argument);
+			void Join(void);
+
+			bool IsRunning(void) const
+			{
+				return (running);
+			}
+	};
+
+	class Mutex
+	{
+		private:
+
+#ifdef OS_WINDOWS
+			CRITICAL_SECTION criticalSection;
+#else
+			pthread_mutex_t mutex;
+#endif
+
+			Mutex(const Mutex&);
+			Mutex& operator=(const Mutex&);
+
+		public:
+
+			Mutex();
+			~Mutex();
+
+			void Lock(void);
+			void Unlock(void);
+	};
+
+	// Counting semaphore, used to hand fixed buffers back and forth between a reader thread and the main thread.
+	class Semaphore
+	{
+		private:
+
+#ifdef OS_WINDOWS
+			HANDLE handle;
+#else
+			// Darwin doesn't implement unnamed POSIX semaphores.
+			pthread_mutex_t mutex;
+			pthread_cond_t condition;
+			unsigned int count;
+#endif
+
+			Semaphore(const Semaphore&);
+			Semaphore& operator=(const Semaphore&);
+
+		public:
+
+			Semaphore(unsigned int initialCount);
+			~Semaphore();
+
+			void Wait(void);
+			void Post(void);
+
+			// Returns false rather than waiting if the count is 0.
+			bool TryWait(void);
+	};
+}
+
+#endif
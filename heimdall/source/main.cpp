@@ -20,20 +20,43 @@
 
 // C/C++ Standard Library
 #include <algorithm>
+#include <ctype.h>
 #include <map>
 #include <stdio.h>
 #include <string>
+#include <string.h>
+
+#ifdef OS_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 // libpit
 #include "libpit.h"
 
 // Heimdall
+#include "BatchJob.h"
 #include "BridgeManager.h"
 #include "SetupSessionPacket.h"
 #include "SetupSessionResponse.h"
 #include "EndModemFileTransferPacket.h"
 #include "EndPhoneFileTransferPacket.h"
+#include "FileSource.h"
+#include "FlashJournal.h"
+#include "FlashLedger.h"
+#include "FlashMetrics.h"
+#include "FlashProgress.h"
+#include "HostUsage.h"
+#include "ImageHasher.h"
+#include "ImageManifest.h"
 #include "Interface.h"
+#include "JsonEvent.h"
+#include "PitCache.h"
+#include "SendFilePartPacket.h"
+#include "SimulatedDevice.h"
+#include "SparseFileSource.h"
+#include "StreamSource.h"
+#include "TarPackage.h"
 
 using namespace std;
 using namespace Heimdall;
@@ -69,15 +92,47 @@ enum
 
 vector<const char *> knownPartitionNames[kKnownPartitionCount];
 
+enum
+{
+	// Only used to estimate transfer time in the flash plan, real throughput varies from device to device.
+	kEstimatedTransferRate = 8 * 1024 * 1024
+};
+
 struct PartitionNameFilePair
 {
 	string partitionName;
 	FILE *file;
 
-	PartitionNameFilePair(const char *partitionName, FILE *file)
+	// The region of file to flash, files passed as arguments are flashed whole but package members are a part of the package.
+	long long fileOffset;
+	long long fileSize;
+
+	PartitionNameFilePair(const char *partitionName, FILE *file, long long fileOffset, long long fileSize)
 	{
 		this->partitionName = partitionName;
 		this->file = file;
+		this->fileOffset = fileOffset;
+		this->fileSize = fileSize;
+	}
+};
+
+// Everything a flash reads from. These are opened before the device is initialised so hashing can start straight away.
+struct FlashInputs
+{
+	map<string, FILE *> argumentFileMap;
+
+	// File sizes, or the --size declared for pipes and stdin.
+	map<string, long long> argumentSizeMap;
+
+	TarPackage *package;
+	ImageManifest *manifest;
+	ImageHasher *imageHasher;
+
+	FlashInputs()
+	{
+		package = nullptr;
+		manifest = nullptr;
+		imageHasher = nullptr;
 	}
 };
 
@@ -132,8 +187,72 @@ bool isKnownBootPartition(const char *partitionName)
 		isKnownPartition(partitionName, kKnownPartitionNormalBoot));
 }
 
-bool openFiles(const map<string, string>& argumentMap, map<string, FILE *>& argumentFileMap)
+// Parses --size, a comma separated list of <argument>=<bytes> e.g. "system=1073741824,21=4096".
+bool parseDeclaredSizes(const string& text, map<string, long long>& declaredSizeMap)
+{
+	const Action& flashAction = Interface::actions[Interface::kActionFlash];
+	string::size_type start = 0;
+
+	while (start < text.length())
+	{
+		string::size_type end = text.find(',', start);
+
+		if (end == string::npos)
+			end = text.length();
+
+		string declaration = text.substr(start, end - start);
+		string::size_type separator = declaration.find('=');
+
+		if (separator == string::npos || separator == 0 || separator + 1 == declaration.length())
+		{
+			Interface::PrintError("Invalid --size \"%s\", expected <argument>=<bytes>\n", declaration.c_str());
+			return (false);
+		}
+
+		string argumentName = "-" + declaration.substr(0, separator);
+		string sizeText = declaration.substr(separator + 1);
+
+		// Short argument names are accepted too, partition identifiers are used as they are.
+		for (unsigned int i = 0; i < flashAction.valueArgumentCount; i++)
+		{
+			if (argumentName.substr(1) == flashAction.valueShortArguments[i])
+			{
+				argumentName = flashAction.valueArguments[i];
+				break;
+			}
+		}
+
+		long long size = 0;
+
+		for (string::size_type i = 0; i < sizeText.length(); i++)
+		{
+			if (!isdigit(static_cast<unsigned char>(sizeText[i])) || size > (0x7FFFFFFFFFFFFFFFLL - 9) / 10)
+			{
+				Interface::PrintError("Invalid --size \"%s\", expected <argument>=<bytes>\n", declaration.c_str());
+				return (false);
+			}
+
+			size = size * 10 + (sizeText[i] - '0');
+		}
+
+		declaredSizeMap[argumentName] = size;
+		start = end + 1;
+	}
+
+	return (true);
+}
+
+bool openFiles(const map<string, string>& argumentMap, map<string, FILE *>& argumentFileMap, map<string, long long>& argumentSizeMap)
 {
+	map<string, long long> declaredSizeMap;
+	map<string, string>::const_iterator sizeArgument = argumentMap.find(
+		Interface::actions[Interface::kActionFlash].valueArguments[Interface::kFlashValueArgSize]);
+
+	if (sizeArgument != argumentMap.end() && !parseDeclaredSizes(sizeArgument->second, declaredSizeMap))
+		return (false);
+
+	bool stdinUsed = false;
+
 	map<string, string>::const_iterator it = argumentMap.begin();
 
 	for (it = argumentMap.begin(); it != argumentMap.end(); it++)
@@ -165,7 +284,26 @@ bool openFiles(const map<string, string>& argumentMap, map<string, FILE *>& argu
 
 		pair<string, FILE *> argumentFilePair;
 		argumentFilePair.first = it->first;
-		argumentFilePair.second = fopen(it->second.c_str(), "rb");
+
+		if (it->second == "-")
+		{
+			if (stdinUsed)
+			{
+				Interface::PrintError("Only one file can be read from stdin\n");
+				return (false);
+			}
+
+			stdinUsed = true;
+
+#ifdef OS_WINDOWS
+			_setmode(_fileno(stdin), _O_BINARY);
+#endif
+			argumentFilePair.second = stdin;
+		}
+		else
+		{
+			argumentFilePair.second = fopen(it->second.c_str(), "rb");
+		}
 
 		if (!argumentFilePair.second)
 		{
@@ -174,12 +312,50 @@ bool openFiles(const map<string, string>& argumentMap, map<string, FILE *>& argu
 		}
 
 		argumentFileMap.insert(argumentFilePair);
+
+		map<string, long long>::iterator declaredSize = declaredSizeMap.find(it->first);
+
+		if (FileSource::IsStream(argumentFilePair.second))
+		{
+			// The PIT is read more than once.
+			if (it->first == Interface::GetPitArgument())
+			{
+				Interface::PrintError("The PIT file can't be read from a pipe\n");
+				return (false);
+			}
+
+			if (declaredSize == declaredSizeMap.end() || declaredSize->second == 0)
+			{
+				Interface::PrintError("\"%s\" is a pipe, specify its size with --size %s=<bytes>\n", it->second.c_str(),
+					it->first.c_str() + 1);
+				return (false);
+			}
+
+			argumentSizeMap[it->first] = declaredSize->second;
+		}
+		else
+		{
+			if (declaredSize != declaredSizeMap.end())
+				Interface::Print("WARNING: \"%s\" isn't a pipe, ignoring its --size\n", it->second.c_str());
+
+			argumentSizeMap[it->first] = FileSource::GetFileSize(argumentFilePair.second);
+		}
+
+		if (declaredSize != declaredSizeMap.end())
+			declaredSizeMap.erase(declaredSize);
+	}
+
+	if (!declaredSizeMap.empty())
+	{
+		Interface::PrintError("--size specified for %s, which isn't being flashed\n", declaredSizeMap.begin()->first.c_str() + 1);
+		return (false);
 	}
 
 	return (true);
 }
 
-bool mapFilesToPartitions(const map<string, FILE *>& argumentFileMap, const PitData *pitData, map<unsigned int, PartitionNameFilePair>& partitionFileMap)
+bool mapFilesToPartitions(const map<string, FILE *>& argumentFileMap, const map<string, long long>& argumentSizeMap, const PitData *pitData,
+	map<unsigned int, PartitionNameFilePair>& partitionFileMap)
 {
 	map<string, FILE *>::const_iterator it = argumentFileMap.begin();
 
@@ -189,9 +365,14 @@ bool mapFilesToPartitions(const map<string, FILE *>& argumentFileMap, const PitD
 
 		const PitEntry *pitEntry = nullptr;
 
-		// Was the argument a partition index?
-		if (partitionIndex > 0 || it->first.compare("-0") == 0)
+		// Batch jobs name partitions as they appear in the PIT, those arguments have no leading '-'.
+		if (it->first[0] != '-')
+		{
+			pitEntry = pitData->FindEntry(it->first.c_str());
+		}
+		else if (partitionIndex > 0 || it->first.compare("-0") == 0)
 		{
+			// The argument was a partition index.
 			pitEntry = pitData->FindEntry(partitionIndex);
 		}
 		else
@@ -216,7 +397,8 @@ bool mapFilesToPartitions(const map<string, FILE *>& argumentFileMap, const PitD
 
 			if (!pitEntry && knownPartition == kKnownPartitionPit)
 			{
-				PartitionNameFilePair partitionNameFilePair(knownPartitionNames[kKnownPartitionPit][0], it->second);
+				PartitionNameFilePair partitionNameFilePair(knownPartitionNames[kKnownPartitionPit][0], it->second, 0,
+					argumentSizeMap.find(it->first)->second);
 				partitionFileMap.insert(pair<unsigned int, PartitionNameFilePair>(static_cast<unsigned int>(-1), partitionNameFilePair));
 
 				return (true);
@@ -229,275 +411,1411 @@ bool mapFilesToPartitions(const map<string, FILE *>& argumentFileMap, const PitD
 			return (false);
 		}
 
-		PartitionNameFilePair partitionNameFilePair(pitEntry->GetPartitionName(), it->second);
+		PartitionNameFilePair partitionNameFilePair(pitEntry->GetPartitionName(), it->second, 0, argumentSizeMap.find(it->first)->second);
+		partitionFileMap.insert(pair<unsigned int, PartitionNameFilePair>(pitEntry->GetPartitionIdentifier(), partitionNameFilePair));
+	}
+
+	return (true);
+}
+
+bool isSameFilename(const char *a, const char *b)
+{
+	for (; *a != '\0' && *b != '\0'; a++, b++)
+	{
+		if (tolower(static_cast<unsigned char>(*a)) != tolower(static_cast<unsigned char>(*b)))
+			return (false);
+	}
+
+	return (*a == *b);
+}
+
+// Maps package members to the partitions whose PIT filename matches the member's name. Files passed as arguments take
+// precedence over package members, and members without a partition (e.g. compressed images or metadata) are skipped.
+void mapPackageToPartitions(const TarPackage *package, const PitData *pitData, bool reportSkipped,
+	map<unsigned int, PartitionNameFilePair>& partitionFileMap)
+{
+	for (unsigned int memberIndex = 0; memberIndex < package->GetMemberCount(); memberIndex++)
+	{
+		const TarMember& member = package->GetMember(memberIndex);
+
+		string::size_type separator = member.name.find_last_of('/');
+		string filename = (separator == string::npos) ? member.name : member.name.substr(separator + 1);
+
+		const PitEntry *pitEntry = nullptr;
+
+		for (unsigned int entryIndex = 0; entryIndex < pitData->GetEntryCount(); entryIndex++)
+		{
+			const PitEntry *entry = pitData->GetEntry(entryIndex);
+
+			if (isSameFilename(filename.c_str(), entry->GetFilename()))
+			{
+				pitEntry = entry;
+				break;
+			}
+		}
+
+		if (!pitEntry)
+		{
+			if (reportSkipped)
+				Interface::Print("Skipping %s, no partition uses that filename\n", member.name.c_str());
+
+			continue;
+		}
+
+		// The PIT is only ever flashed from --pit, and only when repartitioning.
+		if (isKnownPartition(pitEntry->GetPartitionName(), kKnownPartitionPit))
+		{
+			if (reportSkipped)
+				Interface::Print("Skipping %s, specify --pit to repartition\n", member.name.c_str());
+
+			continue;
+		}
+
+		if (partitionFileMap.find(pitEntry->GetPartitionIdentifier()) != partitionFileMap.end())
+		{
+			if (reportSkipped)
+				Interface::Print("Skipping %s, a file was specified for %s\n", member.name.c_str(), pitEntry->GetPartitionName());
+
+			continue;
+		}
+
+		PartitionNameFilePair partitionNameFilePair(pitEntry->GetPartitionName(), package->GetFile(), member.offset, member.size);
 		partitionFileMap.insert(pair<unsigned int, PartitionNameFilePair>(pitEntry->GetPartitionIdentifier(), partitionNameFilePair));
 	}
+}
+
+const char *formatSize(long long size, char *buffer)
+{
+	// buffer must hold at least 32 characters.
+	if (size < 1024 * 1024)
+		sprintf(buffer, "%.1f KiB", size / 1024.0);
+	else if (size < 1024LL * 1024 * 1024)
+		sprintf(buffer, "%.1f MiB", size / (1024.0 * 1024.0));
+	else
+		sprintf(buffer, "%.2f GiB", size / (1024.0 * 1024.0 * 1024.0));
+
+	return (buffer);
+}
+
+// Returns the expanded size of an Android sparse image, or -1 if the file isn't one.
+long long getSparseImageSize(const PartitionNameFilePair& partitionNameFilePair)
+{
+	// Reading the header would consume it, streams are always sent as they are.
+	if (FileSource::IsStream(partitionNameFilePair.file))
+		return (-1);
+
+	FileRegionSource image(partitionNameFilePair.file, partitionNameFilePair.fileOffset, partitionNameFilePair.fileSize);
+	SparseFileSource sparseImage(&image);
+
+	if (sparseImage.Open() != SparseFileSource::kOpenSucceeded)
+		return (-1);
+
+	return (sparseImage.GetSize());
+}
+
+// Validates that every file fits in the partition it's mapped to and optionally prints the resulting plan. This only
+// needs the PIT, so it's done before anything is transferred and, where a local PIT is available, before the session
+// begins. A partition with a block size or count of zero is treated as having unknown capacity. Sparse images are checked
+// by their expanded size, as that's what ends up in the partition either way.
+bool checkFlashPlan(const map<unsigned int, PartitionNameFilePair>& partitionFileMap, const PitData *pitData, bool printPlan,
+	bool checkCapacity, bool expandSparse)
+{
+	bool success = true;
+	long long totalSize = 0;
+
+	char sizeText[32];
+	char expandedSizeText[32];
+	char capacityText[32];
+
+	if (printPlan)
+		Interface::Print("Flash plan:\n");
+
+	for (map<unsigned int, PartitionNameFilePair>::const_iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	{
+		const char *partitionName = it->second.partitionName.c_str();
+
+		// The PIT is tiny and is only flashed when repartitioning, so it's left out of the plan.
+		if (isKnownPartition(partitionName, kKnownPartitionPit))
+			continue;
+
+		long long fileSize = it->second.fileSize;
+		long long sparseImageSize = getSparseImageSize(it->second);
+
+		totalSize += (sparseImageSize >= 0 && expandSparse) ? sparseImageSize : fileSize;
+
+		const PitEntry *pitEntry = pitData->FindEntry(it->first);
+
+		// Multiplied as 64-bit, large partitions easily exceed 4 GiB.
+		unsigned long long capacity = (pitEntry) ? static_cast<unsigned long long>(pitEntry->GetPartitionBlockSize())
+			* pitEntry->GetPartitionBlockCount() : 0;
+
+		if (printPlan && sparseImageSize >= 0)
+		{
+			formatSize(fileSize, sizeText);
+			formatSize(sparseImageSize, expandedSizeText);
+
+			if (capacity > 0)
+			{
+				Interface::Print("  %s (ID %u): %s sparse image, %s expanded of %s\n", partitionName, it->first, sizeText,
+					expandedSizeText, formatSize(capacity, capacityText));
+			}
+			else
+			{
+				Interface::Print("  %s (ID %u): %s sparse image, %s expanded, partition size unknown\n", partitionName, it->first,
+					sizeText, expandedSizeText);
+			}
+		}
+		else if (printPlan)
+		{
+			if (capacity > 0)
+			{
+				Interface::Print("  %s (ID %u): %s of %s\n", partitionName, it->first, formatSize(fileSize, sizeText),
+					formatSize(capacity, capacityText));
+			}
+			else
+			{
+				Interface::Print("  %s (ID %u): %s, partition size unknown\n", partitionName, it->first, formatSize(fileSize, sizeText));
+			}
+		}
+
+		long long imageSize = (sparseImageSize >= 0) ? sparseImageSize : fileSize;
+
+		if (checkCapacity && capacity > 0 && static_cast<unsigned long long>(imageSize) > capacity)
+		{
+			Interface::PrintError("%s is %lld bytes but its partition only holds %llu bytes (%u blocks of %u)\n", partitionName,
+				imageSize, capacity, pitEntry->GetPartitionBlockCount(), pitEntry->GetPartitionBlockSize());
+
+			success = false;
+		}
+	}
+
+	if (printPlan)
+	{
+		long long estimatedSeconds = totalSize / kEstimatedTransferRate + 1;
+
+		Interface::Print("Total: %s, estimated transfer time %lldm %02llds\n\n", formatSize(totalSize, sizeText),
+			estimatedSeconds / 60, estimatedSeconds % 60);
+	}
+
+	if (!success)
+		Interface::PrintError("Images don't fit their partitions, specify --skip-size-check to flash regardless.\n");
+
+	return (success);
+}
+
+bool readLocalPitFile(FILE *localPitFile, PitData *pitData)
+{
+	// Load the local pit file into memory.
+	long long localPitFileSize = FileSource::GetFileSize(localPitFile);
+
+	if (localPitFileSize <= 0 || localPitFileSize > PitCache::kMaxPitFileSize)
+	{
+		Interface::PrintError("Failed to read PIT file!\n");
+		return (false);
+	}
+
+	unsigned char *pitFileBuffer = new unsigned char[localPitFileSize];
+
+	unsigned int dataRead = FileSource::ReadAt(localPitFile, 0, pitFileBuffer, static_cast<unsigned int>(localPitFileSize));
+
+	int unpackResult = pitData->Unpack(pitFileBuffer, dataRead);
+
+	delete [] pitFileBuffer;
+
+	if (unpackResult != PitData::kUnpackSucceeded)
+	{
+		Interface::PrintError("Invalid PIT file: %s\n", PitData::GetUnpackErrorMessage(unpackResult));
+		return (false);
+	}
+
+	return (true);
+}
+
+bool planFlashWithLocalPit(const FlashInputs& flashInputs, bool checkCapacity, bool expandSparse)
+{
+	const map<string, FILE *>& argumentFileMap = flashInputs.argumentFileMap;
+	map<string, FILE *>::const_iterator it = argumentFileMap.find(Interface::actions[Interface::kActionFlash].valueArguments[Interface::kFlashValueArgPit]);
+
+	// Without a local PIT the plan has to wait for the device's PIT.
+	if (it == argumentFileMap.end())
+		return (true);
+
+	PitData localPitData;
+
+	if (!readLocalPitFile(it->second, &localPitData))
+		return (false);
+
+	map<unsigned int, PartitionNameFilePair> partitionFileMap;
+
+	if (!mapFilesToPartitions(argumentFileMap, flashInputs.argumentSizeMap, &localPitData, partitionFileMap))
+		return (false);
+
+	if (flashInputs.package)
+		mapPackageToPartitions(flashInputs.package, &localPitData, true, partitionFileMap);
+
+	return (checkFlashPlan(partitionFileMap, &localPitData, true, checkCapacity, expandSparse));
+}
+
+void addImagesToHasher(ImageHasher *imageHasher, const map<string, string>& argumentMap, const map<string, FILE *>& argumentFileMap,
+	const TarPackage *package)
+{
+	for (map<string, FILE *>::const_iterator it = argumentFileMap.begin(); it != argumentFileMap.end(); it++)
+	{
+		// Streams can only be read once, by the transfer.
+		if (FileSource::IsStream(it->second))
+			continue;
+
+		const string& path = argumentMap.find(it->first)->second;
+		imageHasher->Add(it->second, path, path, 0, FileSource::GetFileSize(it->second));
+	}
+
+	if (package)
+	{
+		for (unsigned int i = 0; i < package->GetMemberCount(); i++)
+		{
+			const TarMember& member = package->GetMember(i);
+			imageHasher->Add(package->GetFile(), package->GetPath(), member.name, member.offset, member.size);
+		}
+	}
+}
+
+void closeFiles(map<string, FILE *> argumentfileMap)
+{
+	for (map<string, FILE *>::iterator it = argumentfileMap.begin(); it != argumentfileMap.end(); it++)
+		fclose(it->second);
+
+	argumentfileMap.clear();
+}
+
+// Opens the package and manifest, if any, and starts the package's MD5 check and image hashing in the background.
+// Files passed as arguments must already be open.
+bool openFlashInputs(const map<string, string>& argumentMap, FlashInputs *flashInputs)
+{
+	const Action& flashAction = Interface::actions[Interface::kActionFlash];
+	map<string, string>::const_iterator packageArgument = argumentMap.find(flashAction.valueArguments[Interface::kFlashValueArgPackage]);
+
+	if (packageArgument != argumentMap.end())
+	{
+		flashInputs->package = new TarPackage();
+
+		if (!flashInputs->package->Open(packageArgument->second.c_str()) || !flashInputs->package->StartVerification())
+			return (false);
+	}
+
+	map<string, string>::const_iterator manifestArgument = argumentMap.find(flashAction.valueArguments[Interface::kFlashValueArgManifest]);
+
+	if (manifestArgument != argumentMap.end())
+	{
+		flashInputs->manifest = new ImageManifest();
+
+		if (!flashInputs->manifest->Load(manifestArgument->second.c_str()))
+			return (false);
+	}
+
+	int hashAlgorithms = (flashInputs->manifest) ? flashInputs->manifest->GetAlgorithms() : 0;
+
+	// The ledger and journal only record MD5s.
+	if (argumentMap.find(flashAction.valuelessArguments[Interface::kFlashValuelessArgSkipUnchanged]) != argumentMap.end()
+		|| argumentMap.find(flashAction.valuelessArguments[Interface::kFlashValuelessArgResume]) != argumentMap.end())
+	{
+		hashAlgorithms |= ImageHasher::kAlgorithmMd5;
+	}
+
+	if (hashAlgorithms != 0)
+	{
+		flashInputs->imageHasher = new ImageHasher(hashAlgorithms);
+		addImagesToHasher(flashInputs->imageHasher, argumentMap, flashInputs->argumentFileMap, flashInputs->package);
+		flashInputs->imageHasher->Start();
+	}
+
+	return (true);
+}
+
+void closeFlashInputs(FlashInputs *flashInputs)
+{
+	// The hasher and package may still have workers reading, they're joined before the files are closed.
+	delete flashInputs->imageHasher;
+	delete flashInputs->manifest;
+	delete flashInputs->package;
+
+	flashInputs->imageHasher = nullptr;
+	flashInputs->manifest = nullptr;
+	flashInputs->package = nullptr;
+
+	closeFiles(flashInputs->argumentFileMap);
+	flashInputs->argumentFileMap.clear();
+}
+
+int downloadPitFile(BridgeManager *bridgeManager, unsigned char **pitBuffer, const unsigned char *cachedPit = nullptr,
+	int cachedPitSize = 0, bool *usedCache = nullptr)
+{
+	if (cachedPit)
+		Interface::Print("Checking cached PIT file against device...\n");
+	else
+		Interface::Print("Downloading device's PIT file...\n");
+
+	Interface::PrintPhaseEvent("download_pit");
+
+	PitCache pitCache(bridgeManager);
+	bool cacheMatched;
+	int devicePitFileSize = bridgeManager->ReceivePitFile(pitBuffer, cachedPit, cachedPitSize, &cacheMatched);
+
+	if (usedCache)
+		*usedCache = cacheMatched;
+
+	if (!*pitBuffer)
+	{
+		Interface::PrintError("Failed to download PIT file!\n");
+
+		return (-1);
+	}
+
+	if (cacheMatched)
+	{
+		Interface::Print("Using cached PIT file for device %s\n\n", pitCache.GetKey().c_str());
+		return (devicePitFileSize);
+	}
+
+	Interface::Print("PIT file download sucessful\n\n");
+
+	// Keep the cache up to date whenever we pay for a download.
+	pitCache.Store(*pitBuffer, devicePitFileSize);
+
+	return (devicePitFileSize);
+}
+
+int loadPitFile(BridgeManager *bridgeManager, unsigned char **pitBuffer, bool refreshPit, bool *usedCache)
+{
+	PitCache pitCache(bridgeManager);
+
+	unsigned char *cachedPit = nullptr;
+	int cachedPitFileSize = 0;
+
+	if (!refreshPit && pitCache.IsAvailable())
+		cachedPitFileSize = pitCache.Load(&cachedPit);
+
+	// The device is still asked for its PIT, the cached copy is only used if it matches (see ReceivePitFile).
+	int pitFileSize = downloadPitFile(bridgeManager, pitBuffer, cachedPit, cachedPitFileSize, usedCache);
+
+	delete [] cachedPit;
+	return (pitFileSize);
+}
+
+bool flashFile(BridgeManager *bridgeManager, unsigned int partitionIndex, const PartitionNameFilePair& partitionNameFilePair,
+	bool expandSparse, TransferObserver *transferObserver = nullptr, FlashProgress *progress = nullptr)
+{
+	const char *partitionName = partitionNameFilePair.partitionName.c_str();
+
+	// PIT files need to be handled differently, try determine if the partition we're flashing to is a PIT partition.
+	bool isPit = false;
+
+	for (unsigned int i = 0; i < knownPartitionNames[kKnownPartitionPit].size(); i++)
+	{
+		if (strcmp(partitionName, knownPartitionNames[kKnownPartitionPit][i]) == 0)
+		{
+			isPit = true;
+			break;
+		}
+	}
+
+	if (isPit)
+	{
+		Interface::Print("Uploading %s\n", partitionName);
+
+		if (bridgeManager->SendPitFile(partitionNameFilePair.file))
+		{
+			Interface::Print("%s upload successful\n", partitionName);
+			return (true);
+		}
+		else
+		{
+			Interface::Print("%s upload failed!\n", partitionName);
+			return (false);
+		}
+	}
+	else
+	{
+		FileRegionSource source(partitionNameFilePair.file, partitionNameFilePair.fileOffset, partitionNameFilePair.fileSize);
+		FileSource *transferSource = &source;
+
+		// Pipes are read ahead in a thread of their own, they're only read once the partition is flashed.
+		StreamSource *streamSource = nullptr;
+
+		if (FileSource::IsStream(partitionNameFilePair.file))
+		{
+			if (expandSparse)
+				Interface::Print("WARNING: %s is read from a pipe, it's sent as is even if it's a sparse image\n", partitionName);
+
+			streamSource = new StreamSource(partitionNameFilePair.file, partitionNameFilePair.fileSize);
+			transferSource = streamSource;
+		}
+
+		// Sparse images are sent as they are unless asked to expand them, bootloaders that flash Odin packages expand them
+		// themselves. The header is read through a region of its own, the file is sent from the start if it isn't sparse.
+		FileRegionSource sparseImage(partitionNameFilePair.file, partitionNameFilePair.fileOffset, partitionNameFilePair.fileSize);
+		SparseFileSource sparseSource(&sparseImage);
+
+		int sparseResult = (streamSource) ? static_cast<int>(SparseFileSource::kOpenErrorNotSparse) : sparseSource.Open();
+
+		if (sparseResult == SparseFileSource::kOpenSucceeded)
+		{
+			char sizeText[32];
+			char expandedSizeText[32];
+
+			if (expandSparse)
+			{
+				transferSource = &sparseSource;
+				Interface::Print("Expanding %s sparse image, reading %s and transferring %s\n", partitionName,
+					formatSize(partitionNameFilePair.fileSize, sizeText), formatSize(sparseSource.GetSize(), expandedSizeText));
+			}
+			else
+			{
+				Interface::Print("Sending %s sparse image as is, transferring %s rather than %s expanded\n", partitionName,
+					formatSize(partitionNameFilePair.fileSize, sizeText), formatSize(sparseSource.GetSize(), expandedSizeText));
+			}
+		}
+		else if (expandSparse && sparseResult != SparseFileSource::kOpenErrorNotSparse)
+		{
+			Interface::PrintError("Failed to expand %s: %s\n", partitionName, SparseFileSource::GetOpenErrorMessage(sparseResult));
+			return (false);
+		}
+
+		// Modems need to be handled differently, try determine if the partition we're flashing to is a modem partition.
+		bool isModem = false;
+
+		for (unsigned int i = 0; i < knownPartitionNames[kKnownPartitionModem].size(); i++)
+		{
+			if (strcmp(partitionName, knownPartitionNames[kKnownPartitionModem][i]) == 0)
+			{
+				isModem = true;
+				break;
+			}
+		}
+
+		Interface::Print("Uploading %s\n", partitionName);
+
+		if (progress)
+			progress->BeginPartition(partitionName, partitionNameFilePair.fileSize, transferSource->GetSize());
+
+		bool success;
+
+		if (isModem)
+		{
+			//success = bridgeManager->SendFile(file, EndPhoneFileTransferPacket::kDestinationPhone,    // <-- Kies method. WARNING: Doesn't work on Galaxy Tab!
+			//	EndPhoneFileTransferPacket::kFileModem);
+			success = bridgeManager->SendFile(transferSource, EndModemFileTransferPacket::kDestinationModem, -1, transferObserver,
+				progress);  // <-- Odin method
+		}
+		else
+		{
+			// We're uploading to a phone partition
+			success = bridgeManager->SendFile(transferSource, EndPhoneFileTransferPacket::kDestinationPhone, partitionIndex,
+				transferObserver, progress);
+		}
+
+		if (progress)
+			progress->EndPartition(success);
+
+		if (streamSource && streamSource->IsOverlong())
+			Interface::PrintError("%s stream is longer than its declared size of %lld bytes!\n", partitionName, partitionNameFilePair.fileSize);
+
+		delete streamSource;
+
+		if (success)
+		{
+			Interface::Print("%s upload successful\n", partitionName);
+			return (true);
+		}
+		else
+		{
+			Interface::Print("%s upload failed!\n", partitionName);
+			return (false);
+		}
+	}
+
+	return (true);
+}
+
+// Returns nullptr if the image wasn't hashed or MD5 wasn't requested.
+const unsigned char *getMd5Digest(const ImageHasher *imageHasher, const PartitionNameFilePair& partitionNameFilePair)
+{
+	if (!imageHasher)
+		return (nullptr);
+
+	int imageIndex = imageHasher->FindImage(partitionNameFilePair.file, partitionNameFilePair.fileOffset);
+	return ((imageIndex >= 0) ? imageHasher->GetMd5Digest(imageIndex) : nullptr);
+}
+
+// Flashes a partition and keeps the ledger and journal in step with it. Partitions are only skipped if their image was
+// hashed and matches the ledger, anything flashed without a hash is dropped from the ledger as it can no longer be vouched
+// for. When resuming, partitions the journal shows were completely flashed from the same image (by MD5) are skipped too.
+bool flashPartition(BridgeManager *bridgeManager, unsigned int partitionIndex, const PartitionNameFilePair& partitionNameFilePair,
+	bool expandSparse, FlashLedger *flashLedger, const ImageHasher *ledgerHasher, FlashJournal *flashJournal,
+	const ImageHasher *journalHasher, FlashProgress *progress)
+{
+	const char *partitionName = partitionNameFilePair.partitionName.c_str();
+
+	const unsigned char *digest = getMd5Digest(ledgerHasher, partitionNameFilePair);
+
+	if (digest && flashLedger->Matches(partitionIndex, partitionNameFilePair.fileSize, digest))
+	{
+		Interface::Print("Skipping %s, unchanged since it was last flashed\n", partitionName);
+		progress->SkipPartition(partitionName, partitionNameFilePair.fileSize);
+		return (true);
+	}
+
+	// Pipes can't be read again, so they're never journalled.
+	bool isJournalled = flashJournal->IsAvailable() && !FileSource::IsStream(partitionNameFilePair.file);
+
+	JournalImage journalImage;
+	journalImage.size = partitionNameFilePair.fileSize;
+	journalImage.offset = partitionNameFilePair.fileOffset;
+	journalImage.modificationTime = (isJournalled) ? FileSource::GetModificationTime(partitionNameFilePair.file) : -1;
+
+	const unsigned char *journalDigest = getMd5Digest(journalHasher, partitionNameFilePair);
+	journalImage.hasDigest = journalDigest != nullptr;
+
+	if (journalDigest)
+		memcpy(journalImage.digest, journalDigest, Md5::kDigestSize);
+
+	unsigned int completedSequences;
+	unsigned int sequenceCount;
+
+	if (isJournalled && flashJournal->GetProgress(partitionIndex, journalImage, &completedSequences, &sequenceCount))
+	{
+		if (sequenceCount > 0 && completedSequences == sequenceCount)
+		{
+			Interface::Print("Skipping %s, it was flashed before the interruption\n", partitionName);
+			progress->SkipPartition(partitionName, partitionNameFilePair.fileSize);
+			return (true);
+		}
+
+		// Sequences are addressed from the start of the file being transferred, there's no known way to tell the
+		// bootloader to continue part way through a partition.
+		if (completedSequences > 0)
+		{
+			Interface::Print("%u of %u sequences of %s were flashed before the interruption, flashing it again from the start\n",
+				completedSequences, sequenceCount, partitionName);
+		}
+	}
+
+	flashLedger->Forget(partitionIndex);
+
+	if (isJournalled)
+		flashJournal->BeginPartition(partitionIndex, journalImage);
+
+	bool success = flashFile(bridgeManager, partitionIndex, partitionNameFilePair, expandSparse,
+		(isJournalled) ? flashJournal : nullptr, progress);
+
+	flashJournal->EndPartition();
+
+	if (!success)
+		return (false);
+
+	if (digest)
+		flashLedger->Record(partitionIndex, partitionNameFilePair.fileSize, digest);
+
+	return (true);
+}
+
+bool verifyPackage(TarPackage *package)
+{
+	if (!package->HasChecksum())
+		return (true);
+
+	Interface::Print("Verifying MD5 of %s\n", package->GetPath().c_str());
+
+	switch (package->WaitForVerification())
+	{
+		case TarPackage::kVerificationPassed:
+			Interface::Print("MD5 verified\n\n");
+			return (true);
+
+		case TarPackage::kVerificationFailed:
+			Interface::PrintError("MD5 of %s doesn't match, the package is corrupt!\n", package->GetPath().c_str());
+			return (false);
+
+		default:
+			Interface::PrintError("Failed to read %s to verify its MD5!\n", package->GetPath().c_str());
+			return (false);
+	}
+}
+
+// Checks every image about to be flashed against the manifest, nothing has been written at this point.
+bool verifyImages(const map<unsigned int, PartitionNameFilePair>& partitionFileMap, const ImageHasher *imageHasher,
+	const ImageManifest *manifest)
+{
+	bool success = true;
+	unsigned int verifiedCount = 0;
+
+	for (map<unsigned int, PartitionNameFilePair>::const_iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	{
+		int imageIndex = imageHasher->FindImage(it->second.file, it->second.fileOffset);
+
+		// Only streams aren't hashed.
+		if (imageIndex < 0)
+		{
+			Interface::PrintError("The %s image is read from a pipe and can't be checked against the manifest!\n",
+				it->second.partitionName.c_str());
+			success = false;
+			continue;
+		}
+
+		const string& imageName = imageHasher->GetImageName(imageIndex);
+
+		if (!imageHasher->IsImageHashed(imageIndex))
+		{
+			Interface::PrintError("Failed to read %s to check it against the manifest!\n", imageName.c_str());
+			success = false;
+			continue;
+		}
+
+		switch (manifest->Check(imageName, imageHasher->GetMd5Digest(imageIndex), imageHasher->GetSha256Digest(imageIndex)))
+		{
+			case ImageManifest::kCheckMatched:
+				verifiedCount++;
+				break;
+
+			case ImageManifest::kCheckMismatched:
+				Interface::PrintError("%s (%s) doesn't match the manifest!\n", imageName.c_str(), it->second.partitionName.c_str());
+				success = false;
+				break;
+
+			default:
+				Interface::Print("WARNING: %s (%s) isn't listed in the manifest\n", imageName.c_str(), it->second.partitionName.c_str());
+				break;
+		}
+	}
+
+	if (!success)
+	{
+		Interface::PrintError("Flash aborted, nothing has been written.\n");
+		return (false);
+	}
+
+	Interface::Print("%u image(s) match the manifest\n\n", verifiedCount);
+	return (true);
+}
+
+bool attemptFlash(BridgeManager *bridgeManager, FlashInputs& flashInputs, bool repartition, bool refreshPit, bool checkCapacity,
+	bool expandSparse, bool skipUnchanged, bool resume)
+{
+	bool success;
+
+	map<string, FILE *>& argumentFileMap = flashInputs.argumentFileMap;
+	TarPackage *package = flashInputs.package;
+	ImageHasher *imageHasher = flashInputs.imageHasher;
+
+	// ------------- SEND TOTAL BYTES TO BE TRANSFERRED -------------
+
+	long long totalBytes = 0;
+	for (map<string, FILE *>::const_iterator it = argumentFileMap.begin(); it != argumentFileMap.end(); it++)
+	{
+		if (repartition || it->first != Interface::GetPitArgument())
+			totalBytes += flashInputs.argumentSizeMap[it->first];
+	}
+
+	// Members that turn out not to have a partition are counted too, the device only uses this for its progress bar.
+	if (package)
+	{
+		for (unsigned int i = 0; i < package->GetMemberCount(); i++)
+			totalBytes += package->GetMember(i).size;
+	}
+
+	// Sent as two 32-bit halves, bootloaders that only read the first still get the right total below 4 GiB.
+	SetupSessionPacket *deviceInfoPacket = new SetupSessionPacket(SetupSessionPacket::kTotalBytes,
+		static_cast<unsigned int>(totalBytes & 0xFFFFFFFF), static_cast<unsigned int>(totalBytes >> 32));
+	success = bridgeManager->SendPacket(deviceInfoPacket);
+	delete deviceInfoPacket;
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to send total bytes device info packet!\n");
+		return (false);
+	}
+
+	SetupSessionResponse *deviceInfoResponse = new SetupSessionResponse();
+	success = bridgeManager->ReceivePacket(deviceInfoResponse);
+	int deviceInfoResult = deviceInfoResponse->GetUnknown();
+	delete deviceInfoResponse;
+
+	if (!success)
+	{
+		Interface::PrintError("Failed to receive device info response!\n");
+		return (false);
+	}
+
+	if (deviceInfoResult != 0)
+	{
+		Interface::PrintError("Unexpected device info response!\nExpected: 0\nReceived:%d\n", deviceInfoResult);
+		return (false);
+	}
+
+	// -----------------------------------------------------
+
+	PitData *pitData;
+	PitData *localPitData = nullptr;
+
+	FILE *localPitFile = nullptr;
+
+	// If a PIT file was passed as an argument then we must unpack it.
+	map<string, FILE *>::iterator it = argumentFileMap.find(Interface::actions[Interface::kActionFlash].valueArguments[Interface::kFlashValueArgPit]);
+
+	if (it != argumentFileMap.end())
+	{
+		localPitFile = it->second;
+		localPitData = new PitData();
+
+		if (!readLocalPitFile(localPitFile, localPitData))
+		{
+			delete localPitData;
+			return (false);
+		}
+
+		if (repartition)
+		{
+			// The device's PIT is about to be replaced, so whatever we have cached for it is stale.
+			PitCache pitCache(bridgeManager);
+			pitCache.Invalidate();
+		}
+	}
+	
+	if (repartition)
+	{
+		// Use the local PIT file data.
+		pitData = localPitData;
+	}
+	else
+	{
+		// If we're not repartitioning then we need to retrieve the device's PIT file and unpack it.
+		unsigned char *pitFileBuffer;
+		bool usedCache;
+
+		int pitFileSize = loadPitFile(bridgeManager, &pitFileBuffer, refreshPit, &usedCache);
+
+		if (pitFileSize <= 0)
+		{
+			delete localPitData;
+			return (false);
+		}
+
+		pitData = new PitData();
+		int unpackResult = pitData->Unpack(pitFileBuffer, pitFileSize);
+
+		delete [] pitFileBuffer;
+
+		if (unpackResult != PitData::kUnpackSucceeded && usedCache)
+		{
+			Interface::Print("WARNING: Cached PIT file is invalid (%s), downloading it again\n", PitData::GetUnpackErrorMessage(unpackResult));
+
+			PitCache pitCache(bridgeManager);
+			pitCache.Invalidate();
+
+			pitFileSize = downloadPitFile(bridgeManager, &pitFileBuffer);
+
+			if (pitFileSize <= 0)
+			{
+				delete pitData;
+				delete localPitData;
+				return (false);
+			}
+
+			delete pitData;
+			pitData = new PitData();
+			unpackResult = pitData->Unpack(pitFileBuffer, pitFileSize);
+
+			delete [] pitFileBuffer;
+		}
+
+		if (unpackResult != PitData::kUnpackSucceeded)
+		{
+			Interface::PrintError("Invalid device PIT file: %s\n", PitData::GetUnpackErrorMessage(unpackResult));
+
+			delete pitData;
+			delete localPitData;
+			return (false);
+		}
+
+		if (localPitData != nullptr)
+		{
+			// The user has specified a PIT without repartitioning, we should verify the local and device PIT data match!
+			PitDiff pitDiff;
+
+			if (!pitDiff.Compute(pitData, localPitData))
+			{
+				Interface::Print("Local and device PIT files don't match and repartition wasn't specified!\n\n");
+				Interface::PrintPitDiff(&pitDiff, "device", "local");
+				Interface::Print("\n");
+				Interface::PrintError("Flash aborted!\n");
+
+				delete localPitData;
+				delete pitData;
+				return (false);
+			}
+
+			delete localPitData;
+		}
+	}
+
+	map<unsigned int, PartitionNameFilePair> partitionFileMap;
+
+	// Map the files being flashed to partitions stored in the PIT file.
+	if (!mapFilesToPartitions(argumentFileMap, flashInputs.argumentSizeMap, pitData, partitionFileMap))
+	{
+		delete pitData;
+		return (false);
+	}
+
+	if (package)
+		mapPackageToPartitions(package, pitData, localPitFile == nullptr, partitionFileMap);
+
+	// With a local PIT the plan was printed before the session began, so just check it again against the PIT in effect.
+	if (!checkFlashPlan(partitionFileMap, pitData, localPitFile == nullptr, checkCapacity, expandSparse))
+	{
+		delete pitData;
+		return (false);
+	}
+
+	delete pitData;
+
+	// Usually finished already, hashing ran while the device was initialised and the session was set up.
+	if (imageHasher)
+		imageHasher->Wait();
+
+	if (flashInputs.manifest)
+	{
+		Interface::PrintPhaseEvent("verify");
+
+		if (!verifyImages(partitionFileMap, imageHasher, flashInputs.manifest))
+			return (false);
+	}
+
+	FlashLedger flashLedger(bridgeManager);
+
+	if (repartition)
+		flashLedger.Clear();
+
+	// Without --skip-unchanged the ledger is only kept up to date, nothing is skipped.
+	const ImageHasher *ledgerHasher = (skipUnchanged) ? imageHasher : nullptr;
+
+	if (skipUnchanged && !flashLedger.IsAvailable())
+	{
+		Interface::Print("WARNING: Device has no serial number to identify it by, flashing every partition\n");
+		ledgerHasher = nullptr;
+	}
+
+	FlashJournal flashJournal(bridgeManager);
+
+	// Repartitioning can move everything, so what was flashed before can't be resumed.
+	if (resume && repartition)
+		Interface::Print("WARNING: Can't resume when repartitioning, flashing every partition\n");
+	else if (resume && !flashJournal.IsAvailable())
+		Interface::Print("WARNING: Device has no serial number to identify it by, flashing every partition\n");
+
+	if (!resume || repartition)
+		flashJournal.Clear();
+
+	// The PIT is tiny and sent separately, so progress only covers the partitions.
+	long long progressBytes = 0;
+
+	for (map<unsigned int, PartitionNameFilePair>::const_iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	{
+		if (!isKnownPartition(it->second.partitionName.c_str(), kKnownPartitionPit))
+			progressBytes += it->second.fileSize;
+	}
+
+	FlashProgress flashProgress(progressBytes, bridgeManager->IsVerbose());
+
+	Interface::PrintPhaseEvent("flash");
+
+	// If we're repartitioning then we need to flash the PIT file first.
+	if (repartition)
+	{
+		for (map<unsigned int, PartitionNameFilePair>::iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+		{
+			if (it->second.file == localPitFile)
+			{
+				if (!flashFile(bridgeManager, it->first, it->second, expandSparse))
+					return (false);
+
+				break;
+			}
+		}
+	}
+
+	// Flash partitions not involved in the boot process second.
+	for (map<unsigned int, PartitionNameFilePair>::iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	{
+		if (!isKnownPartition(it->second.partitionName.c_str(), kKnownPartitionPit) && !isKnownBootPartition(it->second.partitionName.c_str()))
+		{
+			if (!flashPartition(bridgeManager, it->first, it->second, expandSparse, &flashLedger, ledgerHasher, &flashJournal,
+				imageHasher, &flashProgress))
+			{
+				flashProgress.PrintSummary();
+				return (false);
+			}
+		}
+	}
+
+	// The package's MD5 is verified while everything else is flashed, but a corrupt bootloader must never be written.
+	if (package && !verifyPackage(package))
+	{
+		flashProgress.PrintSummary();
+		return (false);
+	}
+
+	// Flash boot partitions last.
+	for (map<unsigned int, PartitionNameFilePair>::iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	{
+		if (isKnownBootPartition(it->second.partitionName.c_str()))
+		{
+			if (!flashPartition(bridgeManager, it->first, it->second, expandSparse, &flashLedger, ledgerHasher, &flashJournal,
+				imageHasher, &flashProgress))
+			{
+				flashProgress.PrintSummary();
+				return (false);
+			}
+		}
+	}
+
+	// Everything was flashed, there's nothing left to resume.
+	flashJournal.Clear();
+
+	flashProgress.PrintSummary();
+
+	return (true);
+}
+
+// Parses a size in bytes, optionally ending in K, M or G. Returns -1 if it isn't one.
+long long parseBenchmarkSize(const string& text)
+{
+	long long size = 0;
+	string::size_type length = text.length();
+
+	long long multiplier = 1;
+
+	if (length > 0)
+	{
+		switch (toupper(static_cast<unsigned char>(text[length - 1])))
+		{
+			case 'K':
+				multiplier = 1024;
+				break;
+
+			case 'M':
+				multiplier = 1024 * 1024;
+				break;
+
+			case 'G':
+				multiplier = 1024 * 1024 * 1024;
+				break;
+		}
+
+		if (multiplier != 1)
+			length--;
+	}
+
+	if (length == 0)
+		return (-1);
+
+	for (string::size_type i = 0; i < length; i++)
+	{
+		if (!isdigit(static_cast<unsigned char>(text[i])) || size > (0x7FFFFFFFFFFFFFFFLL - 9) / 10)
+			return (-1);
+
+		size = size * 10 + (text[i] - '0');
+	}
+
+	if (size > 0x7FFFFFFFFFFFFFFFLL / multiplier)
+		return (-1);
+
+	return (size * multiplier);
+}
+
+// Returns the value of a benchmark argument, or defaultValue if it wasn't given. Sizes are clamped to [minimum, maximum].
+bool getBenchmarkArgument(const map<string, string>& argumentMap, int argument, long long defaultValue, long long minimum,
+	long long maximum, long long *value)
+{
+	const string& argumentName = Interface::actions[Interface::kActionBenchmark].valueArguments[argument];
+	map<string, string>::const_iterator it = argumentMap.find(argumentName);
+
+	if (it == argumentMap.end())
+	{
+		*value = defaultValue;
+		return (true);
+	}
+
+	*value = parseBenchmarkSize(it->second);
+
+	if (*value < minimum || *value > maximum)
+	{
+		Interface::PrintError("Invalid -%s \"%s\", expected a value from %lld to %lld\n", argumentName.c_str(),
+			it->second.c_str(), minimum, maximum);
+		return (false);
+	}
 
 	return (true);
 }
 
-void closeFiles(map<string, FILE *> argumentfileMap)
+// Checks what the simulated device was told against the images, this is all the coverage the encoding of sizes beyond
+// 4 GiB has. The total announced with kTotalBytes, the number of sequences and the size each file's end of sequence
+// packets add up to (the last part of each file included) must all be exact.
+bool verifyBenchmarkTransfer(const SimulatedDevice *simulatedDevice, vector<long long> imageSizes, long long partSize,
+	long long sequenceLength)
 {
-	for (map<string, FILE *>::iterator it = argumentfileMap.begin(); it != argumentfileMap.end(); it++)
-		fclose(it->second);
+	long long totalBytes = 0;
+	int sequenceCount = 0;
 
-	argumentfileMap.clear();
-}
+	for (unsigned int i = 0; i < imageSizes.size(); i++)
+	{
+		long long partCount = (imageSizes[i] + partSize - 1) / partSize;
 
-int downloadPitFile(BridgeManager *bridgeManager, unsigned char **pitBuffer)
-{
-	Interface::Print("Downloading device's PIT file...\n");
+		totalBytes += imageSizes[i];
+		sequenceCount += static_cast<int>((partCount + sequenceLength - 1) / sequenceLength);
+	}
 
-	int devicePitFileSize = bridgeManager->ReceivePitFile(pitBuffer);
+	bool valid = true;
 
-	if (!*pitBuffer)
+	if (simulatedDevice->GetAnnouncedTotalBytes() != totalBytes)
 	{
-		Interface::PrintError("Failed to download PIT file!\n");
+		Interface::PrintError("Device was told to expect %lld bytes rather than %lld!\n", simulatedDevice->GetAnnouncedTotalBytes(),
+			totalBytes);
+		valid = false;
+	}
 
-		return (-1);
+	if (simulatedDevice->GetSequenceCount() != sequenceCount)
+	{
+		Interface::PrintError("Device was sent %d file transfer sequences rather than %d!\n", simulatedDevice->GetSequenceCount(),
+			sequenceCount);
+		valid = false;
 	}
 
-	Interface::Print("PIT file download sucessful\n\n");
-	return (devicePitFileSize);
+	// Images aren't necessarily flashed in the order they're given.
+	vector<long long> fileSizes = simulatedDevice->GetFileSizes();
+
+	sort(fileSizes.begin(), fileSizes.end());
+	sort(imageSizes.begin(), imageSizes.end());
+
+	if (fileSizes != imageSizes)
+	{
+		Interface::PrintError("File sizes described to the device don't match the images!\n");
+
+		for (unsigned int i = 0; i < fileSizes.size(); i++)
+			Interface::PrintError("  Device received a %lld byte file\n", fileSizes[i]);
+
+		valid = false;
+	}
+
+	return (valid);
 }
 
-bool flashFile(BridgeManager *bridgeManager, unsigned int partitionIndex, const char *partitionName, FILE *file)
+// Flashes generated images to a simulated device, everything but USB itself is exercised. The images are sparse
+// temporary files, so beyond the first pass they're read from the page cache and the figures reflect the host alone.
+int runBenchmark(const map<string, string>& argumentMap, bool verbose)
 {
-	// PIT files need to be handled differently, try determine if the partition we're flashing to is a PIT partition.
-	bool isPit = false;
-
-	for (unsigned int i = 0; i < knownPartitionNames[kKnownPartitionPit].size(); i++)
+	long long partSize;
+	long long sequenceLength;
+	long long latency;
+
+	if (!getBenchmarkArgument(argumentMap, Interface::kBenchmarkValueArgPartSize, SendFilePartPacket::kDefaultPacketSize, 512,
+			SendFilePartPacket::kDefaultPacketSize, &partSize)
+		|| !getBenchmarkArgument(argumentMap, Interface::kBenchmarkValueArgSequenceLength, 800, 1, 0x7FFFFFFF / partSize,
+			&sequenceLength)
+		|| !getBenchmarkArgument(argumentMap, Interface::kBenchmarkValueArgLatency, 0, 0, 1000000, &latency))
 	{
-		if (strcmp(partitionName, knownPartitionNames[kKnownPartitionPit][i]) == 0)
-		{
-			isPit = true;
-			break;
-		}
+		return (-1);
 	}
 
-	if (isPit)
+	vector<long long> imageSizes;
+
+	map<string, string>::const_iterator imagesArgument = argumentMap.find(
+		Interface::actions[Interface::kActionBenchmark].valueArguments[Interface::kBenchmarkValueArgImages]);
+	string imagesText = (imagesArgument != argumentMap.end()) ? imagesArgument->second : "256M";
+
+	string::size_type start = 0;
+
+	while (start <= imagesText.length())
 	{
-		Interface::Print("Uploading %s\n", partitionName);
+		string::size_type end = imagesText.find(',', start);
 
-		if (bridgeManager->SendPitFile(file))
-		{
-			Interface::Print("%s upload successful\n", partitionName);
-			return (true);
-		}
-		else
+		if (end == string::npos)
+			end = imagesText.length();
+
+		// Partition capacities are a count of 512 byte blocks.
+		long long imageSize = parseBenchmarkSize(imagesText.substr(start, end - start));
+
+		if (imageSize <= 0 || imageSize / SimulatedDevice::kPartitionBlockSize >= 0xFFFFFFFFLL)
 		{
-			Interface::Print("%s upload failed!\n", partitionName);
-			return (false);
+			Interface::PrintError("Invalid --images \"%s\", expected <bytes>[,...]\n", imagesText.c_str());
+			return (-1);
 		}
+
+		imageSizes.push_back(imageSize);
+		start = end + 1;
 	}
-	else
+
+	FlashInputs flashInputs;
+	long long totalBytes = 0;
+
+	for (unsigned int i = 0; i < imageSizes.size(); i++)
 	{
-		// Modems need to be handled differently, try determine if the partition we're flashing to is a modem partition.
-		bool isModem = false;
+		// Only the last byte is written, the rest of the image is a hole.
+		FILE *image = tmpfile();
 
-		for (unsigned int i = 0; i < knownPartitionNames[kKnownPartitionModem].size(); i++)
+		if (!image || !FileSource::Seek(image, imageSizes[i] - 1) || fputc(0, image) == EOF || fflush(image) != 0)
 		{
-			if (strcmp(partitionName, knownPartitionNames[kKnownPartitionModem][i]) == 0)
-			{
-				isModem = true;
-				break;
-			}
-		}
+			Interface::PrintError("Failed to create a %lld byte benchmark image!\n", imageSizes[i]);
 
-		if (isModem)
-		{			
-			Interface::Print("Uploading %s\n", partitionName);
+			if (image)
+				fclose(image);
 
-			//if (bridgeManager->SendFile(file, EndPhoneFileTransferPacket::kDestinationPhone,    // <-- Kies method. WARNING: Doesn't work on Galaxy Tab!
-			//	EndPhoneFileTransferPacket::kFileModem))
-			if (bridgeManager->SendFile(file, EndModemFileTransferPacket::kDestinationModem))     // <-- Odin method
-			{
-				Interface::Print("%s upload successful\n", partitionName);
-				return (true);
-			}
-			else
-			{
-				Interface::Print("%s upload failed!\n", partitionName);
-				return (false);
-			}
+			closeFlashInputs(&flashInputs);
+			return (-1);
 		}
-		else
-		{
-			// We're uploading to a phone partition
-			Interface::Print("Uploading %s\n", partitionName);
 
-			if (bridgeManager->SendFile(file, EndPhoneFileTransferPacket::kDestinationPhone, partitionIndex))
-			{
-				Interface::Print("%s upload successful\n", partitionName);
-				return (true);
-			}
-			else
-			{
-				Interface::Print("%s upload failed!\n", partitionName);
-				return (false);
-			}
-		}
+		char argumentName[16];
+		sprintf(argumentName, "-%u", i + 1);
+
+		flashInputs.argumentFileMap[argumentName] = image;
+		flashInputs.argumentSizeMap[argumentName] = imageSizes[i];
+
+		totalBytes += imageSizes[i];
 	}
 
-	return (true);
-}
+	SimulatedDevice *simulatedDevice = new SimulatedDevice(imageSizes, static_cast<int>(latency));
 
-bool attemptFlash(BridgeManager *bridgeManager, map<string, FILE *> argumentFileMap, bool repartition)
-{
-	bool success;
+	BridgeManager *bridgeManager = new BridgeManager(verbose, 0);
+	bridgeManager->SetSimulatedDevice(simulatedDevice);
+	bridgeManager->SetFileTransferGeometry(static_cast<int>(partSize), static_cast<int>(sequenceLength));
 
-	// ------------- SEND TOTAL BYTES TO BE TRANSFERRED -------------
+	char sizeText[32];
+	Interface::Print("Benchmarking %u image(s), %s in %lld byte parts, %lld parts per sequence, %lld us latency\n\n",
+		static_cast<unsigned int>(imageSizes.size()), formatSize(totalBytes, sizeText), partSize, sequenceLength, latency);
 
-	int totalBytes = 0;
-	for (map<string, FILE *>::const_iterator it = argumentFileMap.begin(); it != argumentFileMap.end(); it++)
+	bool success = bridgeManager->Initialise() == BridgeManager::kInitialiseSucceeded && bridgeManager->BeginSession();
+
+	HostUsage before;
+	HostUsage after;
+
+	if (success)
 	{
-		if (repartition || it->first != Interface::GetPitArgument())
-		{
-			fseek(it->second, 0, SEEK_END);
-			totalBytes += ftell(it->second);
-			rewind(it->second);
-		}
+		before.Capture();
+		success = attemptFlash(bridgeManager, flashInputs, false, true, true, false, false, false);
+		after.Capture();
+
+		success = bridgeManager->EndSession(false) && success;
 	}
-	
-	SetupSessionPacket *deviceInfoPacket = new SetupSessionPacket(SetupSessionPacket::kTotalBytes, totalBytes);
-	success = bridgeManager->SendPacket(deviceInfoPacket);
-	delete deviceInfoPacket;
+
+	if (success)
+		success = verifyBenchmarkTransfer(simulatedDevice, imageSizes, partSize, sequenceLength);
+
+	delete bridgeManager;
+	delete simulatedDevice;
+
+	closeFlashInputs(&flashInputs);
+
+	FlashMetrics::EndJob(success);
 
 	if (!success)
 	{
-		Interface::PrintError("Failed to send total bytes device info packet!\n");
-		return (false);
+		Interface::PrintError("Benchmark failed!\n");
+		return (-1);
 	}
 
-	SetupSessionResponse *deviceInfoResponse = new SetupSessionResponse();
-	success = bridgeManager->ReceivePacket(deviceInfoResponse);
-	int deviceInfoResult = deviceInfoResponse->GetUnknown();
-	delete deviceInfoResponse;
+	double seconds = (after.wallTime - before.wallTime) / 1000000.0;
+	double gibibytes = totalBytes / (1024.0 * 1024.0 * 1024.0);
 
-	if (!success)
+	Interface::Print("\nBenchmark results\n");
+	Interface::Print("  Transferred:  %s in %.3f s\n", formatSize(totalBytes, sizeText), seconds);
+
+	if (seconds > 0.0)
+		Interface::Print("  Throughput:   %.1f MiB/s\n", totalBytes / (1024.0 * 1024.0) / seconds);
+
+	if (before.cpuTime >= 0 && after.cpuTime >= 0)
+		Interface::Print("  CPU time:     %.3f s, %.3f s per GiB\n", (after.cpuTime - before.cpuTime) / 1000000.0,
+			(after.cpuTime - before.cpuTime) / 1000000.0 / gibibytes);
+
+	if (before.allocationCount >= 0 && after.allocationCount >= 0)
 	{
-		Interface::PrintError("Failed to receive device info response!\n");
-		return (false);
+		Interface::Print("  Allocations:  %lld, %.1f per GiB\n", after.allocationCount - before.allocationCount,
+			(after.allocationCount - before.allocationCount) / gibibytes);
 	}
 
-	if (deviceInfoResult != 0)
+	if (before.readCalls >= 0 && after.readCalls >= 0)
 	{
-		Interface::PrintError("Unexpected device info response!\nExpected: 0\nReceived:%d\n", deviceInfoResult);
-		return (false);
+		Interface::Print("  System calls: %lld reads, %lld writes\n", after.readCalls - before.readCalls,
+			after.writeCalls - before.writeCalls);
 	}
 
-	// -----------------------------------------------------
-
-	PitData *pitData;
-	PitData *localPitData = nullptr;
+	return (0);
+}
 
-	FILE *localPitFile = nullptr;
+// Opens every image in the job, they're read from the same files for each device.
+bool openJobImages(const map<string, string>& imageMap, FlashInputs *flashInputs)
+{
+	for (map<string, string>::const_iterator it = imageMap.begin(); it != imageMap.end(); it++)
+	{
+		FILE *file = fopen(it->second.c_str(), "rb");
 
-	// If a PIT file was passed as an argument then we must unpack it.
-	map<string, FILE *>::iterator it = argumentFileMap.find(Interface::actions[Interface::kActionFlash].valueArguments[Interface::kFlashValueArgPit]);
+		if (!file)
+		{
+			Interface::PrintError("Failed to open file \"%s\"\n", it->second.c_str());
+			return (false);
+		}
 
-	if (it != argumentFileMap.end())
-	{
-		localPitFile = it->second;
+		flashInputs->argumentFileMap[it->first] = file;
 
-		// Load the local pit file into memory.
-		unsigned char *pitFileBuffer = new unsigned char[4096];
-		memset(pitFileBuffer, 0, 4096);
+		if (FileSource::IsStream(file))
+		{
+			Interface::PrintError("\"%s\" is a pipe, batch jobs can only flash files\n", it->second.c_str());
+			return (false);
+		}
 
-		fseek(localPitFile, 0, SEEK_END);
-		long localPitFileSize = ftell(localPitFile);
-		rewind(localPitFile);
+		flashInputs->argumentSizeMap[it->first] = FileSource::GetFileSize(file);
+	}
 
-		// dataRead is discarded, it's here to remove warnings.
-		int dataRead = fread(pitFileBuffer, 1, localPitFileSize, localPitFile);
-		rewind(localPitFile);
+	return (true);
+}
 
-		localPitData = new PitData();
-		localPitData->Unpack(pitFileBuffer);
+// Checks the images against the digests in the job before any device is touched, rather than once per device.
+bool verifyJobImages(const FlashInputs& flashInputs)
+{
+	map<unsigned int, PartitionNameFilePair> imageMap;
 
-		delete [] pitFileBuffer;
-	}
-	
-	if (repartition)
+	for (map<string, FILE *>::const_iterator it = flashInputs.argumentFileMap.begin(); it != flashInputs.argumentFileMap.end(); it++)
 	{
-		// Use the local PIT file data.
-		pitData = localPitData;
+		string partition = (it->first[0] == '-') ? it->first.substr(1) : it->first;
+		PartitionNameFilePair partitionNameFilePair(partition.c_str(), it->second, 0, flashInputs.argumentSizeMap.find(it->first)->second);
+
+		imageMap.insert(pair<unsigned int, PartitionNameFilePair>(imageMap.size(), partitionNameFilePair));
 	}
-	else
-	{
-		// If we're not repartitioning then we need to retrieve the device's PIT file and unpack it.
-		unsigned char *pitFileBuffer;
-		downloadPitFile(bridgeManager, &pitFileBuffer);
 
-		pitData = new PitData();
-		pitData->Unpack(pitFileBuffer);
+	flashInputs.imageHasher->Wait();
 
-		delete [] pitFileBuffer;
+	return (verifyImages(imageMap, flashInputs.imageHasher, flashInputs.manifest));
+}
 
-		if (localPitData != nullptr)
-		{
-			// The user has specified a PIT without repartitioning, we should verify the local and device PIT data match!
-			bool pitsMatch = pitData->Matches(localPitData);
-			delete localPitData;
+// Flashes the job to each of its devices in turn. Everything that doesn't depend on the device, opening, hashing and
+// checking the images and planning against a local PIT, is done once up front. A device that fails doesn't stop the
+// rest being flashed.
+int runBatch(const map<string, string>& argumentMap, bool verbose, bool reboot, int communicationDelay)
+{
+	const Action& flashAction = Interface::actions[Interface::kActionFlash];
+	const string& jobPath = argumentMap.find(Interface::actions[Interface::kActionBatch].valueArguments[Interface::kBatchValueArgJob])->second;
 
-			if (!pitsMatch)
-			{
-				Interface::Print("Local and device PIT files don't match and repartition wasn't specified!\n");
-				Interface::PrintError("Flash aborted!\n");
-				
-				delete pitData;
-				return (false);
-			}
-		}
-	}
+	BatchJob batchJob;
 
-	map<unsigned int, PartitionNameFilePair> partitionFileMap;
+	if (!batchJob.Load(jobPath.c_str()))
+		return (-1);
 
-	// Map the files being flashed to partitions stored in the PIT file.
-	if (!mapFilesToPartitions(argumentFileMap, pitData, partitionFileMap))
+	bool repartition = batchJob.HasOption(flashAction.valuelessArguments[Interface::kFlashValuelessArgRepartition]);
+	bool refreshPit = batchJob.HasOption(flashAction.valuelessArguments[Interface::kFlashValuelessArgRefreshPit]);
+	bool checkCapacity = !batchJob.HasOption(flashAction.valuelessArguments[Interface::kFlashValuelessArgSkipSizeCheck]);
+	bool expandSparse = batchJob.HasOption(flashAction.valuelessArguments[Interface::kFlashValuelessArgExpandSparse]);
+	bool skipUnchanged = batchJob.HasOption(flashAction.valuelessArguments[Interface::kFlashValuelessArgSkipUnchanged]);
+	bool resume = batchJob.HasOption(flashAction.valuelessArguments[Interface::kFlashValuelessArgResume]);
+
+	reboot = reboot && !batchJob.HasOption(Interface::commonValuelessArguments[Interface::kCommonValuelessArgNoReboot]);
+
+	FlashInputs flashInputs;
+
+	if (!openJobImages(batchJob.GetImageMap(), &flashInputs))
 	{
-		delete pitData;
-		return (false);
+		closeFlashInputs(&flashInputs);
+		return (-1);
 	}
 
-	delete pitData;
+	// The ledger and journal only record MD5s.
+	int hashAlgorithms = batchJob.GetManifest().GetAlgorithms() | ((skipUnchanged || resume) ? ImageHasher::kAlgorithmMd5 : 0);
 
-	// If we're repartitioning then we need to flash the PIT file first.
-	if (repartition)
+	if (hashAlgorithms != 0)
 	{
-		for (map<unsigned int, PartitionNameFilePair>::iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
-		{
-			if (it->second.file == localPitFile)
-			{
-				if (!flashFile(bridgeManager, it->first, it->second.partitionName.c_str(), it->second.file))
-					return (false);
+		flashInputs.imageHasher = new ImageHasher(hashAlgorithms);
+		addImagesToHasher(flashInputs.imageHasher, batchJob.GetImageMap(), flashInputs.argumentFileMap, nullptr);
+		flashInputs.imageHasher->Start();
+	}
 
-				break;
-			}
-		}
+	if (!planFlashWithLocalPit(flashInputs, checkCapacity, expandSparse))
+	{
+		closeFlashInputs(&flashInputs);
+		return (-1);
 	}
 
-	// Flash partitions not involved in the boot process second.
-	for (map<unsigned int, PartitionNameFilePair>::iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	Interface::PrintReleaseInfo();
+	Sleep(1000);
+
+	if (batchJob.GetManifest().GetAlgorithms() != 0)
 	{
-		if (!isKnownPartition(it->second.partitionName.c_str(), kKnownPartitionPit) && !isKnownBootPartition(it->second.partitionName.c_str()))
+		flashInputs.manifest = new ImageManifest(batchJob.GetManifest());
+
+		Interface::PrintPhaseEvent("verify");
+
+		if (!verifyJobImages(flashInputs))
 		{
-			if (!flashFile(bridgeManager, it->first, it->second.partitionName.c_str(), it->second.file))
-				return (false);
+			closeFlashInputs(&flashInputs);
+			return (-1);
 		}
+
+		// Verified, there's no need to do it again for each device.
+		delete flashInputs.manifest;
+		flashInputs.manifest = nullptr;
 	}
 
-	// Flash boot partitions last.
-	for (map<unsigned int, PartitionNameFilePair>::iterator it = partitionFileMap.begin(); it != partitionFileMap.end(); it++)
+	const vector<BatchDevice>& devices = batchJob.GetDevices();
+	unsigned int failedCount = 0;
+
+	for (unsigned int i = 0; i < devices.size(); i++)
 	{
-		if (isKnownBootPartition(it->second.partitionName.c_str()))
+		const BatchDevice& device = devices[i];
+
+		if (device.busNumber >= 0)
+			Interface::Print("Flashing device %u of %u, on bus %d, port %d\n\n", i + 1, static_cast<unsigned int>(devices.size()),
+				device.busNumber, device.portNumber);
+
+		JsonEvent deviceStartEvent("device_start");
+		deviceStartEvent.Add("bus", static_cast<long long>(device.busNumber));
+		deviceStartEvent.Add("port", static_cast<long long>(device.portNumber));
+		deviceStartEvent.Emit();
+
+		BridgeManager *bridgeManager = new BridgeManager(verbose, communicationDelay);
+		bridgeManager->SetDeviceLocation(device.busNumber, device.portNumber);
+
+		bool success = bridgeManager->Initialise() == BridgeManager::kInitialiseSucceeded && bridgeManager->BeginSession();
+
+		if (success)
 		{
-			if (!flashFile(bridgeManager, it->first, it->second.partitionName.c_str(), it->second.file))
-				return (false);
+			success = attemptFlash(bridgeManager, flashInputs, repartition, refreshPit, checkCapacity, expandSparse, skipUnchanged,
+				resume);
+
+			success = bridgeManager->EndSession(reboot) && success;
 		}
+
+		delete bridgeManager;
+
+		// Written after every device, so stations see each one as it finishes.
+		FlashMetrics::EndJob(success);
+
+		if (!success)
+			failedCount++;
+
+		JsonEvent deviceEndEvent("device_end");
+		deviceEndEvent.Add("bus", static_cast<long long>(device.busNumber));
+		deviceEndEvent.Add("port", static_cast<long long>(device.portNumber));
+		deviceEndEvent.Add("success", success);
+		deviceEndEvent.Emit();
 	}
 
-	return (true);
+	closeFlashInputs(&flashInputs);
+
+	if (devices.size() > 1)
+		Interface::Print("\n%u of %u devices flashed\n", static_cast<unsigned int>(devices.size()) - failedCount,
+			static_cast<unsigned int>(devices.size()));
+
+	JsonEvent resultEvent("result");
+	resultEvent.Add("success", failedCount == 0);
+	resultEvent.Emit();
+
+	return ((failedCount == 0) ? 0 : -1);
 }
 
 int main(int argc, char **argv)
@@ -526,6 +1844,16 @@ int main(int argc, char **argv)
 
 			break;
 
+		case Interface::kActionBatch:
+			if (argumentMap.find(Interface::actions[Interface::kActionBatch].valueArguments[Interface::kBatchValueArgJob]) == argumentMap.end())
+			{
+				Interface::Print("Job file was not specified.\n\n");
+				Interface::PrintUsage();
+				return (0);
+			}
+
+			break;
+
 		case Interface::kActionDownloadPit:
 			if (argumentMap.find(Interface::actions[Interface::kActionDownloadPit].valueArguments[Interface::kDownloadPitValueArgOutput]) == argumentMap.end())
 			{
@@ -595,12 +1923,29 @@ int main(int argc, char **argv)
 	bool reboot = argumentMap.find(Interface::commonValuelessArguments[Interface::kCommonValuelessArgNoReboot]) == argumentMap.end();
 
 	Interface::SetStdoutErrors(argumentMap.find(Interface::commonValuelessArguments[Interface::kCommonValuelessArgStdoutErrors]) != argumentMap.end());
+	Interface::SetJsonOutput(argumentMap.find(Interface::commonValuelessArguments[Interface::kCommonValuelessArgJson]) != argumentMap.end());
+
+	// Output no longer holds up the device from here on.
+	Interface::StartLogWriter();
+
+	map<string, string>::const_iterator metricsArgument = argumentMap.find(Interface::commonValueArguments[Interface::kCommonValueArgMetrics]);
+
+	if (metricsArgument != argumentMap.end())
+		FlashMetrics::Start(metricsArgument->second.c_str(), Interface::actions[actionIndex].name.c_str());
 
 	int communicationDelay = BridgeManager::kCommunicationDelayDefault;
 
 	if (argumentMap.find(Interface::commonValueArguments[Interface::kCommonValueArgDelay]) != argumentMap.end())
 		communicationDelay = atoi(argumentMap.find(Interface::commonValueArguments[Interface::kCommonValueArgDelay])->second.c_str());
 
+	// The benchmark brings its own simulated device.
+	if (actionIndex == Interface::kActionBenchmark)
+		return (runBenchmark(argumentMap, verbose));
+
+	// Each device in the job gets its own bridge.
+	if (actionIndex == Interface::kActionBatch)
+		return (runBatch(argumentMap, verbose, reboot, communicationDelay));
+
 	BridgeManager *bridgeManager = new BridgeManager(verbose, communicationDelay);
 
 	if (actionIndex == Interface::kActionDetect)
@@ -611,6 +1956,29 @@ int main(int argc, char **argv)
 		return ((detected) ? 0 : 1);
 	}
 
+	FlashInputs flashInputs;
+
+	if (actionIndex == Interface::kActionFlash)
+	{
+		// We open the files before doing anything else to ensure they exist. Hashing starts here too, so that it overlaps
+		// with initialising the device as well as setting up the session.
+		if (!openFiles(argumentMap, flashInputs.argumentFileMap, flashInputs.argumentSizeMap))
+		{
+			closeFlashInputs(&flashInputs);
+			delete bridgeManager;
+
+			return (0);
+		}
+
+		if (!openFlashInputs(argumentMap, &flashInputs))
+		{
+			closeFlashInputs(&flashInputs);
+			delete bridgeManager;
+
+			return (-1);
+		}
+	}
+
 	Interface::PrintReleaseInfo();
 	Sleep(1000);
 
@@ -618,7 +1986,9 @@ int main(int argc, char **argv)
 
 	if (initialiseResult != 0)
 	{
+		closeFlashInputs(&flashInputs);
 		delete bridgeManager;
+
 		return ((initialiseResult == BridgeManager::kInitialiseDeviceNotDetected) ? 1 : 0);
 	}
 
@@ -628,31 +1998,36 @@ int main(int argc, char **argv)
 	{
 		case Interface::kActionFlash:
 		{
-			map<string, FILE *> argumentFileMap;
-
-			// We open the files before doing anything else to ensure they exist.
-			if (!openFiles(argumentMap, argumentFileMap))
+			bool repartition = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgRepartition]) != argumentMap.end();
+			bool refreshPit = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgRefreshPit]) != argumentMap.end();
+			bool checkCapacity = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgSkipSizeCheck]) == argumentMap.end();
+			bool expandSparse = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgExpandSparse]) != argumentMap.end();
+			bool skipUnchanged = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgSkipUnchanged]) != argumentMap.end();
+			bool resume = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgResume]) != argumentMap.end();
+
+			// Fail before touching the device if we already know the images won't fit.
+			if (!planFlashWithLocalPit(flashInputs, checkCapacity, expandSparse))
 			{
-				closeFiles(argumentFileMap);
+				closeFlashInputs(&flashInputs);
 				delete bridgeManager;
 
-				return (0);
+				return (-1);
 			}
 
 			if (!bridgeManager->BeginSession())
 			{
-				closeFiles(argumentFileMap);
+				closeFlashInputs(&flashInputs);
 				delete bridgeManager;
 
 				return (-1);
 			}
 
-			bool repartition = argumentMap.find(Interface::actions[Interface::kActionFlash].valuelessArguments[Interface::kFlashValuelessArgRepartition]) != argumentMap.end();
-			success = attemptFlash(bridgeManager, argumentFileMap, repartition);
+			success = attemptFlash(bridgeManager, flashInputs, repartition, refreshPit, checkCapacity, expandSparse, skipUnchanged,
+				resume);
 
 			success = bridgeManager->EndSession(reboot) && success;
 
-			closeFiles(argumentFileMap);
+			closeFlashInputs(&flashInputs);
 
 			break;
 		}
@@ -763,8 +2138,9 @@ int main(int argc, char **argv)
 			}
 
 			unsigned char *devicePit;
+			int devicePitSize = downloadPitFile(bridgeManager, &devicePit);
 
-			if (downloadPitFile(bridgeManager, &devicePit) < -1)
+			if (devicePitSize < 0)
 			{
 				bridgeManager->EndSession(reboot);
 
@@ -772,11 +2148,12 @@ int main(int argc, char **argv)
 				return (-1);
 			}
 
-			PitData *pitData = new PitData();
+			// The PIT is only printed, so inspect it in place rather than unpacking it.
+			PitView pitView;
 
-			if (pitData->Unpack(devicePit))
+			if (pitView.Load(devicePit, devicePitSize))
 			{
-				Interface::PrintPit(pitData);
+				Interface::PrintPit(&pitView);
 				success = true;
 			}
 			else
@@ -786,7 +2163,6 @@ int main(int argc, char **argv)
 			}
 			
 			delete [] devicePit;
-			delete pitData;
 
 			success = bridgeManager->EndSession(reboot) && success;
 
@@ -796,5 +2172,11 @@ int main(int argc, char **argv)
 
 	delete bridgeManager;
 
+	FlashMetrics::EndJob(success);
+
+	JsonEvent resultEvent("result");
+	resultEvent.Add("success", success);
+	resultEvent.Emit();
+
 	return ((success) ? 0 : -1);
 }
@@ -0,0 +1,169 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+#ifndef WIREFORMAT_H
+#define WIREFORMAT_H
+
+// C Standard Library
+#include <string.h>
+
+// Compile time assertion. Declares an array type with a negative size, and hence fails to compile, if the condition
+// doesn't hold. The name only exists so the resulting error points at the check that failed.
+#define WIRE_STATIC_ASSERT(condition, name) typedef char name[(condition) ? 1 : -1]
+
+#if defined(WORDS_BIGENDIAN) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define WIRE_BIG_ENDIAN 1
+#endif
+
+namespace libpit
+{
+	WIRE_STATIC_ASSERT(sizeof(unsigned int) == 4, WireIntegerIsFourBytes);
+	WIRE_STATIC_ASSERT(sizeof(unsigned short) == 2, WireShortIsTwoBytes);
+
+	// Converts between host and wire byte order. Everything on the wire is little endian, so this is a no-op unless the
+	// host is big endian. Only the types that appear on the wire are specialised.
+	template <typename Type>
+	class WireByteOrder;
+
+	template <>
+	class WireByteOrder<unsigned int>
+	{
+		public:
+
+			static unsigned int Convert(unsigned int value)
+			{
+#ifdef WIRE_BIG_ENDIAN
+				return ((value >> 24) | ((value >> 8) & 0x0000FF00) | ((value << 8) & 0x00FF0000) | (value << 24));
+#else
+				return (value);
+#endif
+			}
+	};
+
+	template <>
+	class WireByteOrder<unsigned short>
+	{
+		public:
+
+			static unsigned short Convert(unsigned short value)
+			{
+#ifdef WIRE_BIG_ENDIAN
+				return (static_cast<unsigned short>((value >> 8) | (value << 8)));
+#else
+				return (value);
+#endif
+			}
+	};
+
+	// An integer field at a fixed offset within a wire structure. Loads and stores are done with memcpy() so they
+	// compile down to a single unaligned move. Layouts chain fields together through kEnd, e.g.
+	//
+	//     typedef WireField<0, unsigned int> Identifier;
+	//     typedef WireField<Identifier::kEnd, unsigned short> Flags;
+	//
+	// so every offset follows from the declaration order and none are written by hand.
+	template <unsigned int Offset, typename Type>
+	class WireField
+	{
+		public:
+
+			typedef Type ValueType;
+
+			enum
+			{
+				kOffset = Offset,
+				kSize = sizeof(Type),
+				kEnd = Offset + sizeof(Type)
+			};
+
+			static Type Unpack(const unsigned char *data)
+			{
+				Type value;
+				memcpy(&value, data + Offset, sizeof(Type));
+
+				return (WireByteOrder<Type>::Convert(value));
+			}
+
+			static void Pack(unsigned char *data, Type value)
+			{
+				value = WireByteOrder<Type>::Convert(value);
+				memcpy(data + Offset, &value, sizeof(Type));
+			}
+	};
+
+	// A fixed length, NUL padded string field. The final byte is always a terminator once packed or unpacked.
+	template <unsigned int Offset, unsigned int Length>
+	class WireString
+	{
+		public:
+
+			enum
+			{
+				kOffset = Offset,
+				kSize = Length,
+				kEnd = Offset + Length
+			};
+
+			// Points directly into the buffer, the string isn't necessarily terminated. Use GetLength() to bound it.
+			static const char *Get(const unsigned char *data)
+			{
+				return (reinterpret_cast<const char *>(data + Offset));
+			}
+
+			// Length of the string as Unpack() would copy it, at most Length - 1 characters.
+			static unsigned int GetLength(const unsigned char *data)
+			{
+				const char *value = Get(data);
+				unsigned int length = 0;
+
+				while (length < Length - 1 && value[length] != '\0')
+					length++;
+
+				return (length);
+			}
+
+			// value must have room for Length characters.
+			static void Unpack(const unsigned char *data, char *value)
+			{
+				Copy(value, reinterpret_cast<const char *>(data + Offset));
+			}
+
+			static void Pack(unsigned char *data, const char *value)
+			{
+				Copy(reinterpret_cast<char *>(data + Offset), value);
+			}
+
+		private:
+
+			// Copies at most Length - 1 characters and zero fills the remainder of the field.
+			static void Copy(char *destination, const char *source)
+			{
+				unsigned int length = 0;
+
+				while (length < Length - 1 && source[length] != '\0')
+					length++;
+
+				memcpy(destination, source, length);
+				memset(destination + length, 0, Length - length);
+			}
+	};
+}
+
+#endif
@@ -18,11 +18,19 @@
  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  THE SOFTWARE.*/
 
+// C Standard Library
+#include <ctype.h>
+
 // libpit
 #include "libpit.h"
 
 using namespace libpit;
 
+// The layouts must agree with the sizes the rest of libpit (and the protocol) assume.
+WIRE_STATIC_ASSERT(static_cast<int>(PitHeaderLayout::kSize) == static_cast<int>(PitData::kHeaderDataSize), PitHeaderLayoutMatchesHeaderSize);
+WIRE_STATIC_ASSERT(static_cast<int>(PitEntryLayout::kSize) == static_cast<int>(PitEntry::kDataSize), PitEntryLayoutMatchesEntrySize);
+WIRE_STATIC_ASSERT(PitEntryLayout::PartitionName::kOffset == 36, PitEntryNameOffsetIs36);
+
 PitEntry::PitEntry()
 {
 	unused = false;
@@ -37,6 +45,8 @@ PitEntry::PitEntry()
 
 	memset(partitionName, 0, 32);
 	memset(filename, 0, 64);
+
+	owner = nullptr;
 }
 
 PitEntry::~PitEntry()
@@ -75,6 +85,8 @@ PitData::PitData()
 
 	unknown7 = 0;
 	unknown8 = 0;
+
+	BuildIndexes();
 }
 
 PitData::~PitData()
@@ -85,117 +97,151 @@ PitData::~PitData()
 
 bool PitData::Unpack(const unsigned char *data)
 {
-	if (PitData::UnpackInteger(data, 0) != PitData::kFileIdentifier)
-		return (false);
+	// Without a size all we can do is trust the header. An absurd entry count wraps around and is then rejected.
+	unsigned int entryCount = PitHeaderLayout::EntryCount::Unpack(data);
 
-	// Remove existing entries
-	for (unsigned int i = 0; i < entries.size(); i++)
-		delete entries[i];
+	return (Unpack(data, PitData::kHeaderDataSize + entryCount * PitEntry::kDataSize) == kUnpackSucceeded);
+}
 
-	entryCount = PitData::UnpackInteger(data, 4);
+int PitData::Unpack(const unsigned char *data, unsigned int size)
+{
+	if (!data)
+		return (kUnpackErrorNoData);
 
-	entries.resize(entryCount);
+	if (size < PitData::kHeaderDataSize)
+		return (kUnpackErrorTruncatedHeader);
 
-	unknown1 = PitData::UnpackInteger(data, 8);
-	unknown2 = PitData::UnpackInteger(data, 12);
+	if (PitHeaderLayout::FileIdentifier::Unpack(data) != PitData::kFileIdentifier)
+		return (kUnpackErrorBadIdentifier);
 
-	unknown3 = PitData::UnpackShort(data, 16);
-	unknown4 = PitData::UnpackShort(data, 18);
+	unsigned int newEntryCount = PitHeaderLayout::EntryCount::Unpack(data);
 
-	unknown5 = PitData::UnpackShort(data, 20);
-	unknown6 = PitData::UnpackShort(data, 22);
+	// Written as a division so a hostile entry count can't overflow the size calculation.
+	if (newEntryCount > (size - PitData::kHeaderDataSize) / PitEntry::kDataSize)
+		return (kUnpackErrorTruncatedEntries);
 
-	unknown7 = PitData::UnpackShort(data, 24);
-	unknown8 = PitData::UnpackShort(data, 26);
+	// Everything that will be read is now known to be in bounds. Reuse existing entries where we can.
+	for (unsigned int i = newEntryCount; i < entries.size(); i++)
+		delete entries[i];
 
-	unsigned int integerValue;
-	unsigned int entryOffset;
+	unsigned int reusableCount = (entries.size() < newEntryCount) ? entries.size() : newEntryCount;
+	entries.resize(newEntryCount);
 
-	for (unsigned int i = 0; i < entryCount; i++)
+	for (unsigned int i = reusableCount; i < newEntryCount; i++)
 	{
-		entryOffset = PitData::kHeaderDataSize + i * PitEntry::kDataSize;
-
 		entries[i] = new PitEntry();
+		entries[i]->owner = this;
+	}
 
-		integerValue = PitData::UnpackInteger(data, entryOffset);
-		entries[i]->SetUnused((integerValue != 0) ? true : false);
+	entryCount = newEntryCount;
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 4);
-		entries[i]->SetPartitionType(integerValue);
+	unknown1 = PitHeaderLayout::Unknown1::Unpack(data);
+	unknown2 = PitHeaderLayout::Unknown2::Unpack(data);
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 8);
-		entries[i]->SetPartitionIdentifier(integerValue);
+	unknown3 = PitHeaderLayout::Unknown3::Unpack(data);
+	unknown4 = PitHeaderLayout::Unknown4::Unpack(data);
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 12);
-		entries[i]->SetPartitionFlags(integerValue);
+	unknown5 = PitHeaderLayout::Unknown5::Unpack(data);
+	unknown6 = PitHeaderLayout::Unknown6::Unpack(data);
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 16);
-		entries[i]->SetUnknown1(integerValue);
+	unknown7 = PitHeaderLayout::Unknown7::Unpack(data);
+	unknown8 = PitHeaderLayout::Unknown8::Unpack(data);
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 20);
-		entries[i]->SetPartitionBlockSize(integerValue);
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		const unsigned char *entryData = data + PitData::kHeaderDataSize + i * PitEntry::kDataSize;
+		PitEntry *entry = entries[i];
+
+		entry->unused = PitEntryLayout::Unused::Unpack(entryData) != 0;
+		entry->partitionType = PitEntryLayout::PartitionType::Unpack(entryData);
+		entry->partitionIdentifier = PitEntryLayout::PartitionIdentifier::Unpack(entryData);
+		entry->partitionFlags = PitEntryLayout::PartitionFlags::Unpack(entryData);
+		entry->unknown1 = PitEntryLayout::Unknown1::Unpack(entryData);
+		entry->partitionBlockSize = PitEntryLayout::PartitionBlockSize::Unpack(entryData);
+		entry->partitionBlockCount = PitEntryLayout::PartitionBlockCount::Unpack(entryData);
+		entry->unknown2 = PitEntryLayout::Unknown2::Unpack(entryData);
+		entry->unknown3 = PitEntryLayout::Unknown3::Unpack(entryData);
+
+		// Never reads past the field, and the final byte is always a terminator.
+		PitEntryLayout::PartitionName::Unpack(entryData, entry->partitionName);
+		PitEntryLayout::Filename::Unpack(entryData, entry->filename);
+	}
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 24);
-		entries[i]->SetPartitionBlockCount(integerValue);
+	BuildIndexes();
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 28);
-		entries[i]->SetUnknown2(integerValue);
+	return (kUnpackSucceeded);
+}
 
-		integerValue = PitData::UnpackInteger(data, entryOffset + 32);
-		entries[i]->SetUnknown3(integerValue);
+const char *PitData::GetUnpackErrorMessage(int result)
+{
+	switch (result)
+	{
+		case kUnpackSucceeded:
+			return ("Success");
 
-		entries[i]->SetPartitionName((const char *)data + entryOffset + 36);
-		entries[i]->SetFilename((const char *)data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength);
-	}
+		case kUnpackErrorNoData:
+			return ("No PIT data");
 
-	return (true);
+		case kUnpackErrorTruncatedHeader:
+			return ("PIT data is smaller than the PIT header");
+
+		case kUnpackErrorBadIdentifier:
+			return ("PIT data does not begin with the PIT file identifier");
+
+		case kUnpackErrorTruncatedEntries:
+			return ("PIT header declares more entries than the PIT data contains");
+
+		default:
+			return ("Unknown error");
+	}
 }
 
 void PitData::Pack(unsigned char *data) const
 {
-	PitData::PackInteger(data, 0, PitData::kFileIdentifier);
-
-	PitData::PackInteger(data, 4, entryCount);
+	PitHeaderLayout::FileIdentifier::Pack(data, PitData::kFileIdentifier);
 
-	PitData::PackInteger(data, 8, unknown1);
-	PitData::PackInteger(data, 12, unknown2);
+	PitHeaderLayout::EntryCount::Pack(data, entryCount);
 
-	PitData::PackShort(data, 16, unknown3);
-	PitData::PackShort(data, 18, unknown4);
+	PitHeaderLayout::Unknown1::Pack(data, unknown1);
+	PitHeaderLayout::Unknown2::Pack(data, unknown2);
 
-	PitData::PackShort(data, 20, unknown5);
-	PitData::PackShort(data, 22, unknown6);
+	PitHeaderLayout::Unknown3::Pack(data, unknown3);
+	PitHeaderLayout::Unknown4::Pack(data, unknown4);
 
-	PitData::PackShort(data, 24, unknown7);
-	PitData::PackShort(data, 26, unknown8);
+	PitHeaderLayout::Unknown5::Pack(data, unknown5);
+	PitHeaderLayout::Unknown6::Pack(data, unknown6);
 
-	int entryOffset;
+	PitHeaderLayout::Unknown7::Pack(data, unknown7);
+	PitHeaderLayout::Unknown8::Pack(data, unknown8);
 
 	for (unsigned int i = 0; i < entryCount; i++)
 	{
-		entryOffset = PitData::kHeaderDataSize + i * PitEntry::kDataSize;
+		unsigned char *entryData = data + PitData::kHeaderDataSize + i * PitEntry::kDataSize;
+		const PitEntry *entry = entries[i];
 
-		PitData::PackInteger(data, entryOffset, (entries[i]->GetUnused()) ? 1 : 0);
+		PitEntryLayout::Unused::Pack(entryData, (entry->unused) ? 1 : 0);
 
-		PitData::PackInteger(data, entryOffset + 4, entries[i]->GetPartitionType());
-		PitData::PackInteger(data, entryOffset + 8, entries[i]->GetPartitionIdentifier());
-		PitData::PackInteger(data, entryOffset + 12, entries[i]->GetPartitionFlags());
+		PitEntryLayout::PartitionType::Pack(entryData, entry->partitionType);
+		PitEntryLayout::PartitionIdentifier::Pack(entryData, entry->partitionIdentifier);
+		PitEntryLayout::PartitionFlags::Pack(entryData, entry->partitionFlags);
 
-		PitData::PackInteger(data, entryOffset + 16, entries[i]->GetUnknown1());
+		PitEntryLayout::Unknown1::Pack(entryData, entry->unknown1);
 
-		PitData::PackInteger(data, entryOffset + 20, entries[i]->GetPartitionBlockSize());
-		PitData::PackInteger(data, entryOffset + 24, entries[i]->GetPartitionBlockCount());
+		PitEntryLayout::PartitionBlockSize::Pack(entryData, entry->partitionBlockSize);
+		PitEntryLayout::PartitionBlockCount::Pack(entryData, entry->partitionBlockCount);
 
-		PitData::PackInteger(data, entryOffset + 28, entries[i]->GetUnknown2());
-		PitData::PackInteger(data, entryOffset + 32, entries[i]->GetUnknown3());
+		PitEntryLayout::Unknown2::Pack(entryData, entry->unknown2);
+		PitEntryLayout::Unknown3::Pack(entryData, entry->unknown3);
 
-		memcpy(data + entryOffset + 36, entries[i]->GetPartitionName(), PitEntry::kPartitionNameMaxLength);
-		memcpy(data + entryOffset + 36 + PitEntry::kPartitionNameMaxLength, entries[i]->GetPartitionName(), PitEntry::kFilenameMaxLength);
+		PitEntryLayout::PartitionName::Pack(entryData, entry->partitionName);
+		PitEntryLayout::Filename::Pack(entryData, entry->filename);
 	}
 }
 
 bool PitData::Matches(const PitData *otherPitData) const
 {
+	// Field by field, a digest comparison would only add two passes over both PITs. Digests are for classifying a PIT
+	// against many precomputed ones.
 	if (entryCount == otherPitData->entryCount && unknown1 == otherPitData->unknown1 && unknown2 == otherPitData->unknown2
 		&& unknown3 == otherPitData->unknown3 && unknown4 == otherPitData->unknown4 && unknown5 == otherPitData->unknown5
 		&& unknown6 == otherPitData->unknown6 && unknown7 == otherPitData->unknown7 && unknown8 == otherPitData->unknown8)
@@ -214,6 +260,40 @@ bool PitData::Matches(const PitData *otherPitData) const
 	}
 }
 
+unsigned long long PitData::GetDigest(void) const
+{
+	unsigned long long digest = 14695981039346656037ULL;
+
+	PitData::DigestInteger(&digest, entryCount);
+	PitData::DigestInteger(&digest, unknown1);
+	PitData::DigestInteger(&digest, unknown2);
+	PitData::DigestInteger(&digest, unknown3);
+	PitData::DigestInteger(&digest, unknown4);
+	PitData::DigestInteger(&digest, unknown5);
+	PitData::DigestInteger(&digest, unknown6);
+	PitData::DigestInteger(&digest, unknown7);
+	PitData::DigestInteger(&digest, unknown8);
+
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		const PitEntry *entry = entries[i];
+
+		PitData::DigestInteger(&digest, entry->unused ? 1 : 0);
+		PitData::DigestInteger(&digest, entry->partitionType);
+		PitData::DigestInteger(&digest, entry->partitionIdentifier);
+		PitData::DigestInteger(&digest, entry->partitionFlags);
+		PitData::DigestInteger(&digest, entry->unknown1);
+		PitData::DigestInteger(&digest, entry->partitionBlockSize);
+		PitData::DigestInteger(&digest, entry->partitionBlockCount);
+		PitData::DigestInteger(&digest, entry->unknown2);
+		PitData::DigestInteger(&digest, entry->unknown3);
+		PitData::DigestString(&digest, entry->partitionName);
+		PitData::DigestString(&digest, entry->filename);
+	}
+
+	return (digest);
+}
+
 void PitData::Clear(void)
 {
 	entryCount = 0;
@@ -234,6 +314,8 @@ void PitData::Clear(void)
 		delete entries[i];
 
 	entries.clear();
+
+	BuildIndexes();
 }
 
 PitEntry *PitData::GetEntry(unsigned int index)
@@ -246,46 +328,490 @@ const PitEntry *PitData::GetEntry(unsigned int index) const
 	return (entries[index]);
 }
 
-PitEntry *PitData::FindEntry(const char *partitionName)
+void PitData::DigestInteger(unsigned long long *digest, unsigned int value)
 {
-	for (unsigned int i = 0; i < entries.size(); i++)
+	// FNV-1a, one byte at a time in little endian order so the digest doesn't depend on the host.
+	for (int i = 0; i < 4; i++)
 	{
-		if (!entries[i]->GetUnused() && strcmp(entries[i]->GetPartitionName(), partitionName) == 0)
-			return (entries[i]);
+		*digest ^= (value >> (i * 8)) & 0xFF;
+		*digest *= 1099511628211ULL;
 	}
+}
 
-	return (nullptr);
+void PitData::DigestString(unsigned long long *digest, const char *value)
+{
+	DigestString(digest, value, strlen(value));
 }
 
-const PitEntry *PitData::FindEntry(const char *partitionName) const
+void PitData::DigestString(unsigned long long *digest, const char *value, unsigned int length)
 {
-	for (unsigned int i = 0; i < entries.size(); i++)
+	// A terminator is included so adjacent strings can't run together.
+	for (unsigned int i = 0; i <= length; i++)
 	{
-		if (!entries[i]->GetUnused() && strcmp(entries[i]->GetPartitionName(), partitionName) == 0)
-			return (entries[i]);
+		*digest ^= (i < length) ? static_cast<unsigned char>(value[i]) : 0;
+		*digest *= 1099511628211ULL;
 	}
+}
 
-	return (nullptr);
+unsigned int PitData::HashPartitionName(const char *partitionName)
+{
+	// FNV-1a over the case folded name, so names differing only in case share a probe sequence.
+	unsigned int hash = 2166136261U;
+
+	for (const char *c = partitionName; *c; c++)
+	{
+		hash ^= static_cast<unsigned char>(tolower(static_cast<unsigned char>(*c)));
+		hash *= 16777619U;
+	}
+
+	return (hash);
 }
 
-PitEntry *PitData::FindEntry(unsigned int partitionIdentifier)
+unsigned int PitData::HashPartitionIdentifier(unsigned int partitionIdentifier)
 {
+	return (partitionIdentifier * 2654435761U);
+}
+
+void PitData::BuildIndexes(void)
+{
+	// Open addressing with linear probing, kept at most half full. Entries are inserted in order so that when
+	// several share a key the first one is found first, just as with a linear search.
+	unsigned int capacity = 16;
+
+	while (capacity < 2 * entries.size())
+		capacity *= 2;
+
+	nameIndex.assign(capacity, 0);
+	identifierIndex.assign(capacity, 0);
+
+	unsigned int mask = capacity - 1;
+
 	for (unsigned int i = 0; i < entries.size(); i++)
 	{
-		if (!entries[i]->GetUnused() && entries[i]->GetPartitionIdentifier() == partitionIdentifier)
-			return (entries[i]);
+		if (entries[i]->GetUnused())
+			continue;
+
+		unsigned int slot = PitData::HashPartitionName(entries[i]->GetPartitionName()) & mask;
+
+		while (nameIndex[slot] != 0)
+			slot = (slot + 1) & mask;
+
+		nameIndex[slot] = i + 1;
+
+		slot = PitData::HashPartitionIdentifier(entries[i]->GetPartitionIdentifier()) & mask;
+
+		while (identifierIndex[slot] != 0)
+			slot = (slot + 1) & mask;
+
+		identifierIndex[slot] = i + 1;
 	}
+}
+
+int PitData::FindEntryIndex(const char *partitionName, bool ignoreCase) const
+{
+	unsigned int mask = nameIndex.size() - 1;
 
-	return (nullptr);
+	for (unsigned int slot = PitData::HashPartitionName(partitionName) & mask; nameIndex[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const char *entryName = entries[nameIndex[slot] - 1]->GetPartitionName();
+		bool matches = true;
+
+		for (unsigned int i = 0; matches; i++)
+		{
+			char a = entryName[i];
+			char b = partitionName[i];
+
+			if (ignoreCase)
+			{
+				a = tolower(static_cast<unsigned char>(a));
+				b = tolower(static_cast<unsigned char>(b));
+			}
+
+			if (a != b)
+				matches = false;
+			else if (a == '\0')
+				break;
+		}
+
+		if (matches)
+			return (nameIndex[slot] - 1);
+	}
+
+	return (-1);
+}
+
+int PitData::FindEntryIndex(unsigned int partitionIdentifier) const
+{
+	unsigned int mask = identifierIndex.size() - 1;
+
+	for (unsigned int slot = PitData::HashPartitionIdentifier(partitionIdentifier) & mask; identifierIndex[slot] != 0; slot = (slot + 1) & mask)
+	{
+		if (entries[identifierIndex[slot] - 1]->GetPartitionIdentifier() == partitionIdentifier)
+			return (identifierIndex[slot] - 1);
+	}
+
+	return (-1);
+}
+
+PitEntry *PitData::FindEntry(const char *partitionName, bool ignoreCase)
+{
+	int index = FindEntryIndex(partitionName, ignoreCase);
+	return ((index >= 0) ? entries[index] : nullptr);
+}
+
+const PitEntry *PitData::FindEntry(const char *partitionName, bool ignoreCase) const
+{
+	int index = FindEntryIndex(partitionName, ignoreCase);
+	return ((index >= 0) ? entries[index] : nullptr);
+}
+
+PitEntry *PitData::FindEntry(unsigned int partitionIdentifier)
+{
+	int index = FindEntryIndex(partitionIdentifier);
+	return ((index >= 0) ? entries[index] : nullptr);
 }
 
 const PitEntry *PitData::FindEntry(unsigned int partitionIdentifier) const
 {
-	for (unsigned int i = 0; i < entries.size(); i++)
+	int index = FindEntryIndex(partitionIdentifier);
+	return ((index >= 0) ? entries[index] : nullptr);
+}
+
+
+
+bool PitEntryView::Matches(const PitEntry *pitEntry) const
+{
+	if (GetUnused() == pitEntry->GetUnused() && GetPartitionType() == pitEntry->GetPartitionType()
+		&& GetPartitionIdentifier() == pitEntry->GetPartitionIdentifier() && GetPartitionFlags() == pitEntry->GetPartitionFlags()
+		&& GetUnknown1() == pitEntry->GetUnknown1() && GetPartitionBlockSize() == pitEntry->GetPartitionBlockSize()
+		&& GetPartitionBlockCount() == pitEntry->GetPartitionBlockCount() && GetUnknown2() == pitEntry->GetUnknown2()
+		&& GetUnknown3() == pitEntry->GetUnknown3() && HasPartitionName(pitEntry->GetPartitionName())
+		&& GetFilenameLength() == strlen(pitEntry->GetFilename())
+		&& memcmp(GetFilename(), pitEntry->GetFilename(), GetFilenameLength()) == 0)
+	{
+		return (true);
+	}
+	else
 	{
-		if (!entries[i]->GetUnused() && entries[i]->GetPartitionIdentifier() == partitionIdentifier)
-			return (entries[i]);
+		return (false);
 	}
+}
+
+bool PitEntryView::HasPartitionName(const char *partitionName) const
+{
+	unsigned int length = GetPartitionNameLength();
+	return (strncmp(GetPartitionName(), partitionName, length) == 0 && partitionName[length] == '\0');
+}
 
-	return (nullptr);
+
+
+PitView::PitView()
+{
+	data = nullptr;
+	entryCount = 0;
+}
+
+bool PitView::Load(const unsigned char *data, unsigned int size)
+{
+	Clear();
+
+	if (!data || size < PitData::kHeaderDataSize)
+		return (false);
+
+	if (PitHeaderLayout::FileIdentifier::Unpack(data) != PitData::kFileIdentifier)
+		return (false);
+
+	unsigned int entryCount = PitHeaderLayout::EntryCount::Unpack(data);
+
+	if (entryCount > (size - PitData::kHeaderDataSize) / PitEntry::kDataSize)
+		return (false);
+
+	// Names needn't be terminated, entry views bound them by length.
+	this->data = data;
+	this->entryCount = entryCount;
+
+	return (true);
+}
+
+void PitView::Clear(void)
+{
+	data = nullptr;
+	entryCount = 0;
+}
+
+bool PitView::Matches(const PitData *pitData) const
+{
+	if (entryCount != pitData->GetEntryCount() || GetUnknown1() != pitData->GetUnknown1() || GetUnknown2() != pitData->GetUnknown2()
+		|| GetUnknown3() != pitData->GetUnknown3() || GetUnknown4() != pitData->GetUnknown4() || GetUnknown5() != pitData->GetUnknown5()
+		|| GetUnknown6() != pitData->GetUnknown6() || GetUnknown7() != pitData->GetUnknown7() || GetUnknown8() != pitData->GetUnknown8())
+	{
+		return (false);
+	}
+
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		if (!GetEntry(i).Matches(pitData->GetEntry(i)))
+			return (false);
+	}
+
+	return (true);
+}
+
+unsigned long long PitView::GetDigest(void) const
+{
+	unsigned long long digest = 14695981039346656037ULL;
+
+	PitData::DigestInteger(&digest, entryCount);
+	PitData::DigestInteger(&digest, GetUnknown1());
+	PitData::DigestInteger(&digest, GetUnknown2());
+	PitData::DigestInteger(&digest, GetUnknown3());
+	PitData::DigestInteger(&digest, GetUnknown4());
+	PitData::DigestInteger(&digest, GetUnknown5());
+	PitData::DigestInteger(&digest, GetUnknown6());
+	PitData::DigestInteger(&digest, GetUnknown7());
+	PitData::DigestInteger(&digest, GetUnknown8());
+
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		PitEntryView entry = GetEntry(i);
+
+		PitData::DigestInteger(&digest, entry.GetUnused() ? 1 : 0);
+		PitData::DigestInteger(&digest, entry.GetPartitionType());
+		PitData::DigestInteger(&digest, entry.GetPartitionIdentifier());
+		PitData::DigestInteger(&digest, entry.GetPartitionFlags());
+		PitData::DigestInteger(&digest, entry.GetUnknown1());
+		PitData::DigestInteger(&digest, entry.GetPartitionBlockSize());
+		PitData::DigestInteger(&digest, entry.GetPartitionBlockCount());
+		PitData::DigestInteger(&digest, entry.GetUnknown2());
+		PitData::DigestInteger(&digest, entry.GetUnknown3());
+		PitData::DigestString(&digest, entry.GetPartitionName(), entry.GetPartitionNameLength());
+		PitData::DigestString(&digest, entry.GetFilename(), entry.GetFilenameLength());
+	}
+
+	return (digest);
+}
+
+PitEntryView PitView::FindEntry(const char *partitionName) const
+{
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		PitEntryView entry = GetEntry(i);
+
+		if (!entry.GetUnused() && entry.HasPartitionName(partitionName))
+			return (entry);
+	}
+
+	return (PitEntryView());
+}
+
+PitEntryView PitView::FindEntry(unsigned int partitionIdentifier) const
+{
+	for (unsigned int i = 0; i < entryCount; i++)
+	{
+		PitEntryView entry = GetEntry(i);
+
+		if (!entry.GetUnused() && entry.GetPartitionIdentifier() == partitionIdentifier)
+			return (entry);
+	}
+
+	return (PitEntryView());
+}
+
+
+
+PitDiff::PitDiff()
+{
+	pitData = nullptr;
+	otherPitData = nullptr;
+}
+
+void PitDiff::AddDifference(int field, int entryIndex, int otherEntryIndex, unsigned int value, unsigned int otherValue)
+{
+	PitDifference difference;
+
+	difference.field = field;
+	difference.entryIndex = entryIndex;
+	difference.otherEntryIndex = otherEntryIndex;
+	difference.value = value;
+	difference.otherValue = otherValue;
+
+	differences.push_back(difference);
+}
+
+void PitDiff::CompareHeaders(void)
+{
+	if (pitData->entryCount != otherPitData->entryCount)
+		AddDifference(kFieldEntryCount, -1, -1, pitData->entryCount, otherPitData->entryCount);
+
+	if (pitData->unknown1 != otherPitData->unknown1)
+		AddDifference(kFieldHeaderUnknown1, -1, -1, pitData->unknown1, otherPitData->unknown1);
+
+	if (pitData->unknown2 != otherPitData->unknown2)
+		AddDifference(kFieldHeaderUnknown2, -1, -1, pitData->unknown2, otherPitData->unknown2);
+
+	if (pitData->unknown3 != otherPitData->unknown3)
+		AddDifference(kFieldHeaderUnknown3, -1, -1, pitData->unknown3, otherPitData->unknown3);
+
+	if (pitData->unknown4 != otherPitData->unknown4)
+		AddDifference(kFieldHeaderUnknown4, -1, -1, pitData->unknown4, otherPitData->unknown4);
+
+	if (pitData->unknown5 != otherPitData->unknown5)
+		AddDifference(kFieldHeaderUnknown5, -1, -1, pitData->unknown5, otherPitData->unknown5);
+
+	if (pitData->unknown6 != otherPitData->unknown6)
+		AddDifference(kFieldHeaderUnknown6, -1, -1, pitData->unknown6, otherPitData->unknown6);
+
+	if (pitData->unknown7 != otherPitData->unknown7)
+		AddDifference(kFieldHeaderUnknown7, -1, -1, pitData->unknown7, otherPitData->unknown7);
+
+	if (pitData->unknown8 != otherPitData->unknown8)
+		AddDifference(kFieldHeaderUnknown8, -1, -1, pitData->unknown8, otherPitData->unknown8);
+}
+
+void PitDiff::CompareEntries(unsigned int entryIndex, unsigned int otherEntryIndex)
+{
+	const PitEntry *entry = pitData->entries[entryIndex];
+	const PitEntry *otherEntry = otherPitData->entries[otherEntryIndex];
+
+	if (entry->unused != otherEntry->unused)
+		AddDifference(kFieldUnused, entryIndex, otherEntryIndex, entry->unused, otherEntry->unused);
+
+	if (entry->partitionType != otherEntry->partitionType)
+		AddDifference(kFieldPartitionType, entryIndex, otherEntryIndex, entry->partitionType, otherEntry->partitionType);
+
+	if (entry->partitionFlags != otherEntry->partitionFlags)
+		AddDifference(kFieldPartitionFlags, entryIndex, otherEntryIndex, entry->partitionFlags, otherEntry->partitionFlags);
+
+	if (entry->unknown1 != otherEntry->unknown1)
+		AddDifference(kFieldUnknown1, entryIndex, otherEntryIndex, entry->unknown1, otherEntry->unknown1);
+
+	if (entry->partitionBlockSize != otherEntry->partitionBlockSize)
+	{
+		AddDifference(kFieldPartitionBlockSize, entryIndex, otherEntryIndex, entry->partitionBlockSize,
+			otherEntry->partitionBlockSize);
+	}
+
+	if (entry->partitionBlockCount != otherEntry->partitionBlockCount)
+	{
+		AddDifference(kFieldPartitionBlockCount, entryIndex, otherEntryIndex, entry->partitionBlockCount,
+			otherEntry->partitionBlockCount);
+	}
+
+	if (entry->unknown2 != otherEntry->unknown2)
+		AddDifference(kFieldUnknown2, entryIndex, otherEntryIndex, entry->unknown2, otherEntry->unknown2);
+
+	if (entry->unknown3 != otherEntry->unknown3)
+		AddDifference(kFieldUnknown3, entryIndex, otherEntryIndex, entry->unknown3, otherEntry->unknown3);
+
+	if (strcmp(entry->partitionName, otherEntry->partitionName) != 0)
+		AddDifference(kFieldPartitionName, entryIndex, otherEntryIndex);
+
+	if (strcmp(entry->filename, otherEntry->filename) != 0)
+		AddDifference(kFieldFilename, entryIndex, otherEntryIndex);
+}
+
+bool PitDiff::Compute(const PitData *pitData, const PitData *otherPitData)
+{
+	Clear();
+
+	this->pitData = pitData;
+	this->otherPitData = otherPitData;
+
+	// Fast path, the common case is that the PITs are identical.
+	if (pitData->Matches(otherPitData))
+		return (true);
+
+	CompareHeaders();
+
+	std::vector<bool> otherEntryMatched(otherPitData->entryCount, false);
+	int lastOtherIndex = -1;
+
+	for (unsigned int i = 0; i < pitData->entryCount; i++)
+	{
+		unsigned int partitionIdentifier = pitData->entries[i]->partitionIdentifier;
+		int otherIndex = otherPitData->FindEntryIndex(partitionIdentifier);
+
+		// Unused entries aren't indexed, and an index hit may already be taken if identifiers are repeated. Fall back
+		// to the first unmatched entry with the same identifier.
+		if (otherIndex < 0 || otherEntryMatched[otherIndex])
+		{
+			otherIndex = -1;
+
+			for (unsigned int j = 0; j < otherPitData->entryCount; j++)
+			{
+				if (!otherEntryMatched[j] && otherPitData->entries[j]->partitionIdentifier == partitionIdentifier)
+				{
+					otherIndex = j;
+					break;
+				}
+			}
+		}
+
+		if (otherIndex < 0)
+		{
+			AddDifference(kFieldEntry, i, -1);
+		}
+		else
+		{
+			otherEntryMatched[otherIndex] = true;
+
+			// Only report entries that are out of order, not every entry shifted by an insertion or removal.
+			if (otherIndex < lastOtherIndex)
+				AddDifference(kFieldEntryPosition, i, otherIndex, i, otherIndex);
+			else
+				lastOtherIndex = otherIndex;
+
+			CompareEntries(i, otherIndex);
+		}
+	}
+
+	for (unsigned int j = 0; j < otherPitData->entryCount; j++)
+	{
+		if (!otherEntryMatched[j])
+			AddDifference(kFieldEntry, -1, j);
+	}
+
+	return (differences.empty());
+}
+
+void PitDiff::Clear(void)
+{
+	pitData = nullptr;
+	otherPitData = nullptr;
+
+	differences.clear();
+}
+
+const char *PitDiff::GetFieldName(int field)
+{
+	static const char *fieldNames[kFieldCount] =
+	{
+		"Entry Count",
+		"Unknown 1",
+		"Unknown 2",
+		"Unknown 3",
+		"Unknown 4",
+		"Unknown 5",
+		"Unknown 6",
+		"Unknown 7",
+		"Unknown 8",
+
+		"Entry",
+		"Position",
+		"Unused",
+		"Partition Type",
+		"Partition Flags",
+		"Unknown 1",
+		"Partition Block Size",
+		"Partition Block Count",
+		"Unknown 2",
+		"Unknown 3",
+		"Partition Name",
+		"Filename"
+	};
+
+	if (field < 0 || field >= kFieldCount)
+		return ("Unknown");
+
+	return (fieldNames[field]);
 }
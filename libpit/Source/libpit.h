@@ -33,8 +33,14 @@
 #include <string.h>
 #include <vector>
 
+// libpit
+#include "WireFormat.h"
+
 namespace libpit
 {
+	class PitData;
+	class PitDiff;
+
 	class PitEntry
 	{
 		public:
@@ -77,6 +83,12 @@ namespace libpit
 			char partitionName[kPartitionNameMaxLength];
 			char filename[kFilenameMaxLength];
 
+			// The PitData this entry belongs to (if any), whose lookup indexes must be rebuilt when we change.
+			PitData *owner;
+
+			friend class PitData;
+			friend class PitDiff;
+
 		public:
 
 			PitEntry();
@@ -89,10 +101,7 @@ namespace libpit
 				return unused;
 			}
 
-			void SetUnused(bool unused)
-			{
-				this->unused = unused;
-			}
+			void SetUnused(bool unused);
 
 			unsigned int GetPartitionType(void) const
 			{
@@ -109,10 +118,7 @@ namespace libpit
 				return partitionIdentifier;
 			}
 
-			void SetPartitionIdentifier(unsigned int partitionIdentifier)
-			{
-				this->partitionIdentifier = partitionIdentifier;
-			}
+			void SetPartitionIdentifier(unsigned int partitionIdentifier);
 
 			unsigned int GetPartitionFlags(void) const
 			{
@@ -179,16 +185,7 @@ namespace libpit
 				return partitionName;
 			}
 
-			void SetPartitionName(const char *partitionName)
-			{
-				// This isn't strictly necessary but ensures no junk is left in our PIT file.
-				memset(this->partitionName, 0, 64);
-
-				if (strlen(partitionName) < 64)
-					strcpy(this->partitionName, partitionName);
-				else
-					memcpy(this->partitionName, partitionName, 63);
-			}
+			void SetPartitionName(const char *partitionName);
 
 			const char *GetFilename(void) const
 			{
@@ -198,15 +195,59 @@ namespace libpit
 			void SetFilename(const char *filename)
 			{
 				// This isn't strictly necessary but ensures no junk is left in our PIT file.
-				memset(this->filename, 0, 32);
+				memset(this->filename, 0, kFilenameMaxLength);
 
-				if (strlen(partitionName) < 32)
+				if (strlen(filename) < kFilenameMaxLength)
 					strcpy(this->filename, filename);
 				else
-					memcpy(this->filename, filename, 31);
+					memcpy(this->filename, filename, kFilenameMaxLength - 1);
 			}
 	};
 
+	// Wire layouts of the PIT header and entries. All multi-byte values are little endian.
+	class PitHeaderLayout
+	{
+		public:
+
+			typedef WireField<0, unsigned int> FileIdentifier;
+			typedef WireField<FileIdentifier::kEnd, unsigned int> EntryCount;
+			typedef WireField<EntryCount::kEnd, unsigned int> Unknown1;
+			typedef WireField<Unknown1::kEnd, unsigned int> Unknown2;
+			typedef WireField<Unknown2::kEnd, unsigned short> Unknown3;
+			typedef WireField<Unknown3::kEnd, unsigned short> Unknown4;
+			typedef WireField<Unknown4::kEnd, unsigned short> Unknown5;
+			typedef WireField<Unknown5::kEnd, unsigned short> Unknown6;
+			typedef WireField<Unknown6::kEnd, unsigned short> Unknown7;
+			typedef WireField<Unknown7::kEnd, unsigned short> Unknown8;
+
+			enum
+			{
+				kSize = Unknown8::kEnd
+			};
+	};
+
+	class PitEntryLayout
+	{
+		public:
+
+			typedef WireField<0, unsigned int> Unused;
+			typedef WireField<Unused::kEnd, unsigned int> PartitionType;
+			typedef WireField<PartitionType::kEnd, unsigned int> PartitionIdentifier;
+			typedef WireField<PartitionIdentifier::kEnd, unsigned int> PartitionFlags;
+			typedef WireField<PartitionFlags::kEnd, unsigned int> Unknown1;
+			typedef WireField<Unknown1::kEnd, unsigned int> PartitionBlockSize;
+			typedef WireField<PartitionBlockSize::kEnd, unsigned int> PartitionBlockCount;
+			typedef WireField<PartitionBlockCount::kEnd, unsigned int> Unknown2;
+			typedef WireField<Unknown2::kEnd, unsigned int> Unknown3;
+			typedef WireString<Unknown3::kEnd, PitEntry::kPartitionNameMaxLength> PartitionName;
+			typedef WireString<PartitionName::kEnd, PitEntry::kFilenameMaxLength> Filename;
+
+			enum
+			{
+				kSize = Filename::kEnd
+			};
+	};
+
 	class PitData
 	{
 		public:
@@ -217,6 +258,15 @@ namespace libpit
 				kHeaderDataSize = 28
 			};
 
+			enum
+			{
+				kUnpackSucceeded = 0,
+				kUnpackErrorNoData,
+				kUnpackErrorTruncatedHeader,
+				kUnpackErrorBadIdentifier,
+				kUnpackErrorTruncatedEntries
+			};
+
 		private:
 
 			unsigned int entryCount; // 0x04
@@ -235,75 +285,58 @@ namespace libpit
 			// Entries start at 0x1C
 			std::vector<PitEntry *> entries;
 
-			static int UnpackInteger(const unsigned char *data, unsigned int offset)
-			{
-#ifdef WORDS_BIGENDIAN
-				int value = (data[offset] << 24) | (data[offset + 1] << 16) |
-					(data[offset + 2] << 8) | data[offset + 3];
-#else
-				// Flip endianness
-				int value = data[offset] | (data[offset + 1] << 8) |
-					(data[offset + 2] << 16) | (data[offset + 3] << 24);
-#endif
-				return (value);
-			}
+			// Lookup indexes, rebuilt whenever the entries or their names, identifiers or unused flags change, so lookups
+			// never modify anything. Each slot holds an entry index + 1, or 0 if the slot is empty.
+			std::vector<unsigned int> nameIndex;
+			std::vector<unsigned int> identifierIndex;
 
-			static int UnpackShort(const unsigned char *data, unsigned int offset)
-			{
-#ifdef WORDS_BIGENDIAN
-				short value = (data[offset] << 8) | data[offset + 1];
-#else
-				// Flip endianness
-				short value = data[offset] | (data[offset + 1] << 8);
-#endif
-				return (value);
-			}
-
-			static void PackInteger(unsigned char *data, unsigned int offset, unsigned int value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF000000) >> 24;
-				data[offset + 1] = (value & 0x00FF0000) >> 16;
-				data[offset + 2] = (value & 0x0000FF00) >> 8;
-				data[offset + 3] = value & 0x000000FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x000000FF;
-				data[offset + 1] = (value & 0x0000FF00) >> 8;
-				data[offset + 2] = (value & 0x00FF0000) >> 16;
-				data[offset + 3] = (value & 0xFF000000) >> 24;
-#endif
-			}
+			friend class PitEntry;
+			friend class PitEntryView;
+			friend class PitView;
+			friend class PitDiff;
 
-			static void PackShort(unsigned char *data, unsigned int offset, unsigned short value)
-			{
-#ifdef WORDS_BIGENDIAN
-				data[offset] = (value & 0xFF00) >> 8;
-				data[offset + 1] = value & 0x00FF;
-#else
-				// Flip endianness
-				data[offset] = value & 0x00FF;
-				data[offset + 1] = (value & 0xFF00) >> 8;
-#endif
-			}
+			static void DigestInteger(unsigned long long *digest, unsigned int value);
+			static void DigestString(unsigned long long *digest, const char *value);
+			static void DigestString(unsigned long long *digest, const char *value, unsigned int length);
+
+			static unsigned int HashPartitionName(const char *partitionName);
+			static unsigned int HashPartitionIdentifier(unsigned int partitionIdentifier);
+
+			void BuildIndexes(void);
+			int FindEntryIndex(const char *partitionName, bool ignoreCase) const;
+			int FindEntryIndex(unsigned int partitionIdentifier) const;
 
 		public:
 
 			PitData();
 			~PitData();
 
+			// Unpacks a PIT of unknown size, trusting the entry count in its header. Prefer the sized overload.
 			bool Unpack(const unsigned char *data);
+
+			// Validates the PIT against the size of the buffer before anything is read, and returns kUnpackSucceeded or
+			// one of the kUnpackError values. On failure the existing contents are left untouched.
+			int Unpack(const unsigned char *data, unsigned int size);
+
+			static const char *GetUnpackErrorMessage(int result);
+
 			void Pack(unsigned char *data) const;
 
 			bool Matches(const PitData *otherPitData) const;
 
+			// 64-bit digest of every field, ignoring padding after names. Equal PITs always have equal digests, so
+			// comparing precomputed digests is a cheap way to classify a PIT against a set of known layouts.
+			unsigned long long GetDigest(void) const;
+
 			void Clear(void);
 
 			PitEntry *GetEntry(unsigned int index);
 			const PitEntry *GetEntry(unsigned int index) const;
 
-			PitEntry *FindEntry(const char *partitionName);
-			const PitEntry *FindEntry(const char *partitionName) const;
+			// Lookups are backed by hash indexes so they're O(1), and const lookups are safe from several threads at once.
+			// Partition names can optionally be matched without regard to (ASCII) case.
+			PitEntry *FindEntry(const char *partitionName, bool ignoreCase = false);
+			const PitEntry *FindEntry(const char *partitionName, bool ignoreCase = false) const;
 
 			PitEntry *FindEntry(unsigned int partitionIdentifier);
 			const PitEntry *FindEntry(unsigned int partitionIdentifier) const;
@@ -353,6 +386,351 @@ namespace libpit
 				return unknown8;
 			}
 	};
+
+	inline void PitEntry::SetUnused(bool unused)
+	{
+		this->unused = unused;
+
+		if (owner)
+			owner->BuildIndexes();
+	}
+
+	inline void PitEntry::SetPartitionIdentifier(unsigned int partitionIdentifier)
+	{
+		this->partitionIdentifier = partitionIdentifier;
+
+		if (owner)
+			owner->BuildIndexes();
+	}
+
+	inline void PitEntry::SetPartitionName(const char *partitionName)
+	{
+		// This isn't strictly necessary but ensures no junk is left in our PIT file.
+		memset(this->partitionName, 0, kPartitionNameMaxLength);
+
+		if (strlen(partitionName) < kPartitionNameMaxLength)
+			strcpy(this->partitionName, partitionName);
+		else
+			memcpy(this->partitionName, partitionName, kPartitionNameMaxLength - 1);
+
+		if (owner)
+			owner->BuildIndexes();
+	}
+
+	// Read-only view of a single entry within a raw PIT buffer. Fields are decoded in place when requested.
+	class PitEntryView
+	{
+		private:
+
+			const unsigned char *data;
+
+		public:
+
+			PitEntryView(const unsigned char *data = nullptr)
+			{
+				this->data = data;
+			}
+
+			bool IsValid(void) const
+			{
+				return data != nullptr;
+			}
+
+			bool Matches(const PitEntry *pitEntry) const;
+
+			bool GetUnused(void) const
+			{
+				return PitEntryLayout::Unused::Unpack(data) != 0;
+			}
+
+			unsigned int GetPartitionType(void) const
+			{
+				return PitEntryLayout::PartitionType::Unpack(data);
+			}
+
+			unsigned int GetPartitionIdentifier(void) const
+			{
+				return PitEntryLayout::PartitionIdentifier::Unpack(data);
+			}
+
+			unsigned int GetPartitionFlags(void) const
+			{
+				return PitEntryLayout::PartitionFlags::Unpack(data);
+			}
+
+			unsigned int GetUnknown1(void) const
+			{
+				return PitEntryLayout::Unknown1::Unpack(data);
+			}
+
+			unsigned int GetPartitionBlockSize(void) const
+			{
+				return PitEntryLayout::PartitionBlockSize::Unpack(data);
+			}
+
+			unsigned int GetPartitionBlockCount(void) const
+			{
+				return PitEntryLayout::PartitionBlockCount::Unpack(data);
+			}
+
+			unsigned int GetUnknown2(void) const
+			{
+				return PitEntryLayout::Unknown2::Unpack(data);
+			}
+
+			unsigned int GetUnknown3(void) const
+			{
+				return PitEntryLayout::Unknown3::Unpack(data);
+			}
+
+			// Names point into the PIT and aren't necessarily terminated, they're bounded by their lengths instead (print
+			// them with "%.*s"). A name that fills its field is cut short by a character, just as PitData::Unpack() does.
+			const char *GetPartitionName(void) const
+			{
+				return PitEntryLayout::PartitionName::Get(data);
+			}
+
+			unsigned int GetPartitionNameLength(void) const
+			{
+				return PitEntryLayout::PartitionName::GetLength(data);
+			}
+
+			const char *GetFilename(void) const
+			{
+				return PitEntryLayout::Filename::Get(data);
+			}
+
+			unsigned int GetFilenameLength(void) const
+			{
+				return PitEntryLayout::Filename::GetLength(data);
+			}
+
+			// True if the partition name is exactly partitionName.
+			bool HasPartitionName(const char *partitionName) const;
+	};
+
+	// Read-only, non-owning view of a raw PIT buffer. The buffer is validated once by Load() and must outlive the
+	// view. Nothing is copied or allocated, so it's the cheaper choice whenever a PIT only needs to be inspected.
+	class PitView
+	{
+		private:
+
+			const unsigned char *data;
+			unsigned int entryCount;
+
+		public:
+
+			PitView();
+
+			bool Load(const unsigned char *data, unsigned int size);
+			void Clear(void);
+
+			bool Matches(const PitData *pitData) const;
+
+			// Identical to PitData::GetDigest() for the same PIT, without unpacking it.
+			unsigned long long GetDigest(void) const;
+
+			// Returns an invalid view if no matching (used) entry exists.
+			PitEntryView FindEntry(const char *partitionName) const;
+			PitEntryView FindEntry(unsigned int partitionIdentifier) const;
+
+			bool IsValid(void) const
+			{
+				return data != nullptr;
+			}
+
+			const unsigned char *GetData(void) const
+			{
+				return data;
+			}
+
+			// The number of bytes covered by the header and entries, which may be less than the buffer size.
+			unsigned int GetDataSize(void) const
+			{
+				return PitData::kHeaderDataSize + entryCount * PitEntry::kDataSize;
+			}
+
+			PitEntryView GetEntry(unsigned int index) const
+			{
+				return PitEntryView(data + PitData::kHeaderDataSize + index * PitEntry::kDataSize);
+			}
+
+			unsigned int GetEntryCount(void) const
+			{
+				return entryCount;
+			}
+
+			unsigned int GetUnknown1(void) const
+			{
+				return PitHeaderLayout::Unknown1::Unpack(data);
+			}
+
+			unsigned int GetUnknown2(void) const
+			{
+				return PitHeaderLayout::Unknown2::Unpack(data);
+			}
+
+			unsigned short GetUnknown3(void) const
+			{
+				return PitHeaderLayout::Unknown3::Unpack(data);
+			}
+
+			unsigned short GetUnknown4(void) const
+			{
+				return PitHeaderLayout::Unknown4::Unpack(data);
+			}
+
+			unsigned short GetUnknown5(void) const
+			{
+				return PitHeaderLayout::Unknown5::Unpack(data);
+			}
+
+			unsigned short GetUnknown6(void) const
+			{
+				return PitHeaderLayout::Unknown6::Unpack(data);
+			}
+
+			unsigned short GetUnknown7(void) const
+			{
+				return PitHeaderLayout::Unknown7::Unpack(data);
+			}
+
+			unsigned short GetUnknown8(void) const
+			{
+				return PitHeaderLayout::Unknown8::Unpack(data);
+			}
+	};
+
+	// A single difference found by PitDiff. Entry indexes are -1 where the field is a header field, or where the entry
+	// doesn't exist on that side at all (kFieldEntry).
+	class PitDifference
+	{
+		private:
+
+			int field;
+
+			int entryIndex;
+			int otherEntryIndex;
+
+			unsigned int value;
+			unsigned int otherValue;
+
+			friend class PitDiff;
+
+		public:
+
+			int GetField(void) const
+			{
+				return field;
+			}
+
+			int GetEntryIndex(void) const
+			{
+				return entryIndex;
+			}
+
+			int GetOtherEntryIndex(void) const
+			{
+				return otherEntryIndex;
+			}
+
+			// Integer field values. String fields must be read from the entries themselves.
+			unsigned int GetValue(void) const
+			{
+				return value;
+			}
+
+			unsigned int GetOtherValue(void) const
+			{
+				return otherValue;
+			}
+	};
+
+	// Computes the per-field differences between two PITs. Entries are aligned by partition identifier rather than
+	// position, so an inserted or removed partition shows up as exactly that instead of a mismatch for every entry
+	// after it. Both PITs must outlive the diff.
+	class PitDiff
+	{
+		public:
+
+			enum
+			{
+				// Header
+				kFieldEntryCount = 0,
+				kFieldHeaderUnknown1,
+				kFieldHeaderUnknown2,
+				kFieldHeaderUnknown3,
+				kFieldHeaderUnknown4,
+				kFieldHeaderUnknown5,
+				kFieldHeaderUnknown6,
+				kFieldHeaderUnknown7,
+				kFieldHeaderUnknown8,
+
+				// Entries
+				kFieldEntry,
+				kFieldEntryPosition,
+				kFieldUnused,
+				kFieldPartitionType,
+				kFieldPartitionFlags,
+				kFieldUnknown1,
+				kFieldPartitionBlockSize,
+				kFieldPartitionBlockCount,
+				kFieldUnknown2,
+				kFieldUnknown3,
+				kFieldPartitionName,
+				kFieldFilename,
+
+				kFieldCount
+			};
+
+		private:
+
+			const PitData *pitData;
+			const PitData *otherPitData;
+
+			std::vector<PitDifference> differences;
+
+			void AddDifference(int field, int entryIndex, int otherEntryIndex, unsigned int value = 0, unsigned int otherValue = 0);
+
+			void CompareHeaders(void);
+			void CompareEntries(unsigned int entryIndex, unsigned int otherEntryIndex);
+
+		public:
+
+			PitDiff();
+
+			// Returns true if the PITs are identical. Identical PITs are detected by Matches() without building a diff.
+			bool Compute(const PitData *pitData, const PitData *otherPitData);
+
+			void Clear(void);
+
+			static const char *GetFieldName(int field);
+
+			bool IsIdentical(void) const
+			{
+				return differences.empty();
+			}
+
+			const PitData *GetPitData(void) const
+			{
+				return pitData;
+			}
+
+			const PitData *GetOtherPitData(void) const
+			{
+				return otherPitData;
+			}
+
+			unsigned int GetDifferenceCount(void) const
+			{
+				return differences.size();
+			}
+
+			const PitDifference& GetDifference(unsigned int index) const
+			{
+				return differences[index];
+			}
+	};
 }
 
 #endif
@@ -0,0 +1,138 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// Measures how long PIT files take to parse, both unpacked into a PitData and loaded as a PitView. Build and run with
+// e.g.
+//
+//   g++ -std=gnu++98 -O2 -ISource fuzz/UnpackBenchmark.cpp Source/libpit.cpp -o UnpackBenchmark
+//   ./UnpackBenchmark [--iterations <count>] corpus/*.pit
+
+// C Standard Library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// C/C++ Standard Library
+#include <vector>
+
+// libpit
+#include "libpit.h"
+
+using namespace libpit;
+using namespace std;
+
+static bool readFile(const char *filename, vector<unsigned char> *contents)
+{
+	FILE *file = fopen(filename, "rb");
+
+	if (!file)
+		return (false);
+
+	unsigned char buffer[4096];
+	size_t bytesRead;
+
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		contents->insert(contents->end(), buffer, buffer + bytesRead);
+
+	bool success = ferror(file) == 0;
+	fclose(file);
+
+	return (success);
+}
+
+static double microsecondsPerParse(clock_t start, clock_t end, unsigned long parses)
+{
+	return ((end - start) * 1000000.0 / CLOCKS_PER_SEC / parses);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long iterations = 10000;
+	int firstFile = 1;
+
+	if (argc > 2 && strcmp(argv[1], "--iterations") == 0)
+	{
+		iterations = strtoul(argv[2], nullptr, 10);
+		firstFile = 3;
+	}
+
+	if (firstFile >= argc || iterations == 0)
+	{
+		fprintf(stderr, "Usage: %s [--iterations <count>] <PIT file> [...]\n", argv[0]);
+		return (1);
+	}
+
+	vector< vector<unsigned char> > corpus;
+
+	for (int i = firstFile; i < argc; i++)
+	{
+		vector<unsigned char> contents;
+
+		if (!readFile(argv[i], &contents) || contents.empty())
+		{
+			fprintf(stderr, "Failed to read %s\n", argv[i]);
+			return (1);
+		}
+
+		corpus.push_back(contents);
+	}
+
+	unsigned long parses = iterations * corpus.size();
+	unsigned long unpacked = 0;
+	unsigned long loaded = 0;
+
+	clock_t start = clock();
+
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (unsigned int j = 0; j < corpus.size(); j++)
+		{
+			PitData pitData;
+
+			if (pitData.Unpack(&corpus[j][0], static_cast<unsigned int>(corpus[j].size())) == PitData::kUnpackSucceeded)
+				unpacked++;
+		}
+	}
+
+	clock_t unpackEnd = clock();
+
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (unsigned int j = 0; j < corpus.size(); j++)
+		{
+			PitView pitView;
+
+			if (pitView.Load(&corpus[j][0], static_cast<unsigned int>(corpus[j].size())))
+				loaded++;
+		}
+	}
+
+	clock_t loadEnd = clock();
+
+	printf("%u file(s), %lu iterations\n", static_cast<unsigned int>(corpus.size()), iterations);
+	printf("  PitData::Unpack: %.3f us per PIT, %lu of %lu succeeded\n", microsecondsPerParse(start, unpackEnd, parses),
+		unpacked, parses);
+	printf("  PitView::Load:   %.3f us per PIT, %lu of %lu succeeded\n", microsecondsPerParse(unpackEnd, loadEnd, parses),
+		loaded, parses);
+
+	return (0);
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2010-2011 Benjamin Dobell, Glass Echidna
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.*/
+
+
+// Fuzz target for PitData::Unpack(), built with libFuzzer e.g.
+//
+//   clang++ -std=gnu++98 -g -O1 -fsanitize=fuzzer,address,undefined -ISource fuzz/UnpackFuzzer.cpp Source/libpit.cpp -o UnpackFuzzer
+//   ./UnpackFuzzer corpus/
+//
+// Any PIT files make a good seed corpus. PITs that unpack are also looked up by name and identifier and loaded as a
+// PitView, so the code that trusts the result of a successful Unpack() is covered too.
+
+// C Standard Library
+#include <stddef.h>
+#include <stdint.h>
+
+// libpit
+#include "libpit.h"
+
+using namespace libpit;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	if (size > 0xFFFFFFFF)
+		return (0);
+
+	PitData pitData;
+
+	if (pitData.Unpack(data, static_cast<unsigned int>(size)) != PitData::kUnpackSucceeded)
+		return (0);
+
+	for (unsigned int i = 0; i < pitData.GetEntryCount(); i++)
+	{
+		const PitEntry *entry = pitData.GetEntry(i);
+
+		pitData.FindEntry(entry->GetPartitionName());
+		pitData.FindEntry(entry->GetPartitionName(), true);
+		pitData.FindEntry(entry->GetPartitionIdentifier());
+	}
+
+	pitData.GetDigest();
+
+	PitView pitView;
+
+	if (pitView.Load(data, static_cast<unsigned int>(size)))
+		pitView.Matches(&pitData);
+
+	return (0);
+}